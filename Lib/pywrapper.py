@@ -646,10 +646,16 @@ def zfactor(zaxis_id, zfactor_name, units="", axis_ids=None,
 
 
 def write(var_id, data, ntimes_passed=None, file_suffix="",
-          time_vals=None, time_bnds=None, store_with=None):
+          time_vals=None, time_bnds=None, store_with=None,
+          asynchronous=False, start=None):
     """ write data to a cmor variable
     Usage:
-    ierr = write(var_id,data,ntimes_passed=None,file_suffix="",time_vals=None,time_bnds=None,store_with=None
+    ierr = write(var_id,data,ntimes_passed=None,file_suffix="",time_vals=None,time_bnds=None,store_with=None,asynchronous=False,start=None
+    With asynchronous=True the netCDF write runs in the background once
+    data has been converted, see cmor.wait and cmor.flush
+    With start, data is a block of the variable beginning at these
+    indices, one per axis in the order passed to cmor.variable; on the
+    time axis start is the index of the first time step in the file
     """
     if not isinstance(var_id, (int, numpy.int, numpy.int32)):
         raise Exception("error var_id must be an integer")
@@ -713,6 +719,16 @@ def write(var_id, data, ntimes_passed=None, file_suffix="",
         raise Exception("error ntimes_passed must be an integer")
     ntimes_passed = int(ntimes_passed)
 
+    if start is not None:
+        if store_with is not None or asynchronous:
+            raise Exception(
+                "error start cannot be used with store_with or asynchronous")
+        start = numpy.ascontiguousarray(start, dtype="i")
+        count = numpy.ascontiguousarray(data.shape, dtype="i")
+        if len(start) != len(count):
+            raise Exception(
+                "error start must have one index per dimension of data")
+
     # At that ponit we check that shapes matches!
     goodshape = _cmor.get_original_shape(var_id, 1)
     osh = data.shape
@@ -731,7 +747,23 @@ def write(var_id, data, ntimes_passed=None, file_suffix="",
         else:  # assume time==1 was removed
             goodshape.remove(0)
 
+    if start is not None:
+        if len(count) != len(ogoodshape):
+            raise Exception(
+                "error with start, data must have one dimension per axis "
+                "of the variable, your data shape (%s), variable shape (%s)" %
+                (str(osh), str(ogoodshape)))
+        for i in range(len(count)):
+            if start[i] < 0 or (ogoodshape[i] > 0 and
+                                start[i] + count[i] > ogoodshape[i]):
+                raise Exception(
+                    "error block of shape %s starting at %s does not fit "
+                    "in the variable shape (%s)" %
+                    (str(osh), str(list(start)), str(ogoodshape)))
+
     for i in range(len(goodshape)):
+        if start is not None:
+            break
         if sh[j] != goodshape[i]:
             if goodshape[i] != 1:
                 msg = "Error: your data shape (%s) does not match the expected variable shape (%s)\nCheck your variable dimensions before caling cmor_write" % (str(osh), str(ogoodshape))
@@ -796,8 +828,49 @@ def write(var_id, data, ntimes_passed=None, file_suffix="",
         raise Exception(
             "Error data type must one of: 'f','d','i','l', please convert first")
 
+    if start is not None:
+        return _cmor.write_region(var_id, data, type, file_suffix, start,
+                                  count, time_vals, time_bnds)
+
     return _cmor.write(var_id, data, type, file_suffix, ntimes_passed,
-                       time_vals, time_bnds, store_with)
+                       time_vals, time_bnds, store_with, int(asynchronous))
+
+
+def preallocate(var_id, ntimes=1):
+    """Size the staging buffers of a cmor variable for writes of ntimes
+    time steps, so they are not grown while writing
+    Usage:
+      cmor.preallocate(var_id, ntimes=1)
+    Where:
+      var_id: is cmor variable id
+      ntimes: number of time steps passed to each cmor.write
+    """
+    if not isinstance(var_id, (int, numpy.int, numpy.int32)):
+        raise Exception("error var_id must be an integer")
+
+    return _cmor.preallocate(int(var_id), int(ntimes))
+
+
+def wait(var_id):
+    """Wait until the asynchronous writes of a cmor variable are done
+    Usage:
+      cmor.wait(var_id)
+    Where:
+      var_id: is cmor variable id
+    """
+    if not isinstance(var_id, (int, numpy.int, numpy.int32)):
+        raise Exception("error var_id must be an integer")
+
+    return _cmor.wait(int(var_id))
+
+
+def flush():
+    """Wait until all asynchronous writes are done and sync open files
+    Usage:
+      cmor.flush()
+    """
+
+    return _cmor.flush()
 
 
 def _check_time_bounds_contiguous(time_bnds):
@@ -821,7 +894,8 @@ def _flatten_time_bounds(time_bnds):
 
 
 def setup(inpath='.', netcdf_file_action=cmor_const.CMOR_PRESERVE, set_verbosity=cmor_const.CMOR_NORMAL,
-          exit_control=cmor_const.CMOR_NORMAL, logfile=None, create_subdirectories=1):
+          exit_control=cmor_const.CMOR_NORMAL, logfile=None, create_subdirectories=1,
+          chunk_cache=0):
     """
     Usage cmor_setup(inpath='.',netcdf_file_action=cmor.CMOR_PRESERVE,set_verbosity=cmor.CMOR_NORMAL,exit_control=cmor.CMOR_NORMAL)
     Where:
@@ -833,6 +907,9 @@ def setup(inpath='.', netcdf_file_action=cmor_const.CMOR_PRESERVE, set_verbosity
     set_verbosity:         CMOR_QUIET or CMOR_NORMAL
     exit_control:          CMOR_EXIT_ON_WARNING, CMOR_EXIT_ON_MAJOR, CMOR_NORMAL
     create_subdirectories: 1 to create subdirectories structure, 0 to dump files directly where cmor_dataset tells to
+    chunk_cache:           HDF5 chunk cache size in bytes for each netCDF-4 variable, 0 lets CMOR size it from the
+                           chunk shape and the number of time steps written at once. "_chunk_cache" in the dataset
+                           json takes precedence
 """
     if not isinstance(exit_control, int) or not exit_control in [
             cmor_const.CMOR_EXIT_ON_WARNING, cmor_const.CMOR_EXIT_ON_MAJOR, cmor_const.CMOR_NORMAL]:
@@ -855,8 +932,12 @@ def setup(inpath='.', netcdf_file_action=cmor_const.CMOR_PRESERVE, set_verbosity
 
     if not create_subdirectories in [0, 1]:
         raise Exception("create_subdirectories must be 0 or 1")
-    return _cmor.setup(inpath, netcdf_file_action, set_verbosity,
+    if not isinstance(chunk_cache, (int, long)) or chunk_cache < 0:
+        raise Exception("chunk_cache must be a positive number of bytes")
+    ierr = _cmor.setup(inpath, netcdf_file_action, set_verbosity,
                        exit_control, logfile, create_subdirectories)
+    _cmor.set_chunk_cache(chunk_cache)
+    return ierr
 
 
 def load_table(table):
@@ -995,6 +1076,54 @@ def set_deflate(var_id, shuffle, deflate, deflate_level):
     return _cmor.set_deflate(var_id, shuffle, deflate, deflate_level)
 
 
+def set_compression(var_id, fletcher32=False, filter_id=0, filter_params=[],
+                    significant_digits=0):
+    """Sets compression beyond shuffle/deflate on a cmor variable
+    Usage:
+      cmor.set_compression(var_id, fletcher32=False, filter_id=0,
+                           filter_params=[], significant_digits=0)
+    Where:
+      var_id: is cmor variable id
+      fletcher32: if true, store fletcher32 checksums with each chunk
+      filter_id: HDF5 filter plugin id (e.g. 32015 for zstd), 0 for none.
+                 The plugin must be in HDF5_PLUGIN_PATH when writing
+      filter_params: list of unsigned integer parameters of the filter
+      significant_digits: if non-zero, bit groom float/double values to
+                          keep this many significant decimal digits
+    """
+    if not isinstance(var_id, (int, numpy.int, numpy.int32)):
+        raise Exception("error var_id must be an integer")
+
+    return _cmor.set_compression(int(var_id), int(bool(fletcher32)),
+                                 int(filter_id),
+                                 numpy.array(filter_params, dtype=numpy.uint32),
+                                 int(significant_digits))
+
+
+def get_units_cache_hits(var_id):
+    """Number of cmor.write calls that reused the units converter cached
+    on a cmor variable
+    Usage:
+      cmor.get_units_cache_hits(var_id)
+    Where:
+      var_id: is cmor variable id
+    """
+
+    return _cmor.get_units_cache_hits(var_id)
+
+
+def get_chunk_cache(var_id):
+    """Size in bytes of the chunk cache chosen for a cmor variable, 0
+    until its file is created or for netCDF-3 files
+    Usage:
+      cmor.get_chunk_cache(var_id)
+    Where:
+      var_id: is cmor variable id
+    """
+
+    return _cmor.get_chunk_cache(var_id)
+
+
 def has_variable_attribute(var_id, name):
     """determines if the a cmor variable has an attribute
     Usage:
@@ -145,6 +145,154 @@ static PyObject *PyCMOR_set_deflate(PyObject * self, PyObject * args)
     return (Py_BuildValue("i", ierr));
 }
 
+/************************************************************************/
+/*                      PyCMOR_set_compression()                        */
+/************************************************************************/
+static PyObject *PyCMOR_set_compression(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int ierr, var_id, fletcher32, nparams, significant_digits;
+    unsigned int filter_id;
+    PyObject *params_obj = NULL;
+    PyArrayObject *params_array = NULL;
+
+    if (!PyArg_ParseTuple(args, "iiIOi", &var_id, &fletcher32, &filter_id,
+                          &params_obj, &significant_digits))
+        return NULL;
+
+    params_array =
+      (PyArrayObject *) PyArray_ContiguousFromObject(params_obj, NPY_UINT,
+                                                     1, 1);
+    if (params_array == NULL)
+        return NULL;
+    nparams = (int)PyArray_DIM(params_array, 0);
+
+    ierr = cmor_set_compression(var_id, fletcher32, filter_id, nparams,
+                                (unsigned int *)PyArray_DATA(params_array),
+                                significant_digits);
+    Py_DECREF(params_array);
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "set_compression");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
+/************************************************************************/
+/*                         PyCMOR_preallocate()                         */
+/************************************************************************/
+static PyObject *PyCMOR_preallocate(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int var_id, ntimes, ierr;
+
+    if (!PyArg_ParseTuple(args, "ii", &var_id, &ntimes))
+        return NULL;
+
+    ierr = cmor_preallocate(var_id, ntimes);
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "preallocate");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
+/************************************************************************/
+/*                            PyCMOR_wait()                             */
+/************************************************************************/
+static PyObject *PyCMOR_wait(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int var_id, ierr;
+
+    if (!PyArg_ParseTuple(args, "i", &var_id))
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    ierr = cmor_wait(var_id);
+    Py_END_ALLOW_THREADS
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "wait");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
+/************************************************************************/
+/*                            PyCMOR_flush()                            */
+/************************************************************************/
+static PyObject *PyCMOR_flush(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int ierr;
+
+    Py_BEGIN_ALLOW_THREADS
+    ierr = cmor_flush();
+    Py_END_ALLOW_THREADS
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "flush");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
+/************************************************************************/
+/*                   PyCMOR_get_units_cache_hits()                      */
+/************************************************************************/
+static PyObject *PyCMOR_get_units_cache_hits(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int var_id, hits;
+
+    if (!PyArg_ParseTuple(args, "i", &var_id))
+        return NULL;
+
+    cmor_get_units_cache_hits(&var_id, &hits);
+
+    if (raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "get_units_cache_hits");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", hits));
+}
+
+/************************************************************************/
+/*                      PyCMOR_get_chunk_cache()                        */
+/************************************************************************/
+static PyObject *PyCMOR_get_chunk_cache(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int var_id;
+    size_t size;
+
+    if (!PyArg_ParseTuple(args, "i", &var_id))
+        return NULL;
+
+    cmor_get_chunk_cache(&var_id, &size);
+
+    if (raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "get_chunk_cache");
+        return NULL;
+    }
+
+    return (Py_BuildValue("n", (Py_ssize_t) size));
+}
+
 /************************************************************************/
 /*                   PyCMOR_set_variable_attribute()                    */
 /************************************************************************/
@@ -272,6 +420,29 @@ static PyObject *PyCMOR_setup(PyObject * self, PyObject * args)
     return (Py_BuildValue("i", ierr));
 }
 
+/************************************************************************/
+/*                        PyCMOR_set_chunk_cache()                      */
+/************************************************************************/
+static PyObject *PyCMOR_set_chunk_cache(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int ierr;
+    unsigned long size;
+
+    if (!PyArg_ParseTuple(args, "k", &size))
+        return NULL;
+
+    ierr = cmor_set_chunk_cache((size_t) size);
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "set_chunk_cache");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
 /************************************************************************/
 /*                        PyCMOR_getincvalues()                         */
 /************************************************************************/
@@ -765,10 +936,11 @@ static PyObject *PyCMOR_write(PyObject * self, PyObject * args)
     PyObject *ref_obj;
     int *ref;
     int iref;
+    int async = 0;
 
     if (!PyArg_ParseTuple
-        (args, "iOssiOOO", &var_id, &data_obj, &itype, &suffix, &ntimes,
-         &times_obj, &times_bnds_obj, &ref_obj))
+        (args, "iOssiOOO|i", &var_id, &data_obj, &itype, &suffix, &ntimes,
+         &times_obj, &times_bnds_obj, &ref_obj, &async))
         return NULL;
 
     data_array =
@@ -805,8 +977,90 @@ static PyObject *PyCMOR_write(PyObject * self, PyObject * args)
     }
     type = itype[0];
     ierr = 0;
-    ierr = cmor_write(var_id, data, type, suffix, ntimes, times, times_bnds, ref);
+    Py_BEGIN_ALLOW_THREADS
+    if (async)
+        ierr = cmor_write_async(var_id, data, type, suffix, ntimes, times,
+                                times_bnds, ref);
+    else
+        ierr = cmor_write(var_id, data, type, suffix, ntimes, times,
+                          times_bnds, ref);
+    Py_END_ALLOW_THREADS
+    Py_DECREF(data_array);
+    if (times_array != NULL) {
+        Py_DECREF(times_array);
+    }
+    if (times_bnds_array != NULL) {
+        Py_DECREF(times_bnds_array);
+    }
+
+    if (ierr != 0 || raise_exception) {
+        raise_exception = 0;
+        PyErr_Format(CMORError, exception_message, "write");
+        return NULL;
+    }
+
+    return (Py_BuildValue("i", ierr));
+}
+
+/************************************************************************/
+/*                         PyCMOR_write_region()                        */
+/************************************************************************/
+
+static PyObject *PyCMOR_write_region(PyObject * self, PyObject * args)
+{
+    signal(signal_to_catch, signal_handler);
+    int ierr, var_id;
+    PyObject *data_obj = NULL;
+    PyArrayObject *data_array = NULL;
+    PyObject *start_obj = NULL;
+    PyArrayObject *start_array = NULL;
+    PyObject *count_obj = NULL;
+    PyArrayObject *count_array = NULL;
+    PyObject *times_obj = NULL;
+    PyArrayObject *times_array = NULL;
+    PyObject *times_bnds_obj = NULL;
+    PyArrayObject *times_bnds_array = NULL;
+    void *data;
+    double *times = NULL;
+    double *times_bnds = NULL;
+    char *suffix;
+    char *itype;
+
+    if (!PyArg_ParseTuple
+        (args, "iOssOOOO", &var_id, &data_obj, &itype, &suffix, &start_obj,
+         &count_obj, &times_obj, &times_bnds_obj))
+        return NULL;
+
+    data_array =
+      (PyArrayObject *) PyArray_ContiguousFromObject(data_obj,
+                                                     NPY_NOTYPE, 1, 0);
+    data = PyArray_DATA(data_array);
+    start_array =
+      (PyArrayObject *) PyArray_ContiguousFromObject(start_obj, NPY_INT, 1, 1);
+    count_array =
+      (PyArrayObject *) PyArray_ContiguousFromObject(count_obj, NPY_INT, 1, 1);
+
+    if (times_obj != Py_None) {
+        times_array = (PyArrayObject *)
+          PyArray_ContiguousFromObject(times_obj, NPY_DOUBLE, 1, 0);
+        times = (double *)PyArray_DATA(times_array);
+    }
+    if (times_bnds_obj != Py_None) {
+        times_bnds_array = (PyArrayObject *)
+          PyArray_ContiguousFromObject(times_bnds_obj, NPY_DOUBLE, 1, 0);
+        times_bnds = (double *)PyArray_DATA(times_bnds_array);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    ierr = cmor_write_region(var_id, data, itype[0], suffix,
+                             (int *)PyArray_DATA(start_array),
+                             (int *)PyArray_DATA(count_array), times,
+                             times_bnds);
+    Py_END_ALLOW_THREADS
+
     Py_DECREF(data_array);
+    Py_DECREF(start_array);
+    Py_DECREF(count_array);
     if (times_array != NULL) {
         Py_DECREF(times_array);
     }
@@ -851,6 +1105,7 @@ static PyObject *PyCMOR_close(PyObject * self, PyObject * args)
     } else {
         varid = (int)PyInt_AsLong(var);
 
+        Py_BEGIN_ALLOW_THREADS
         if (dopreserve == 1) {
             if (dofile == 1) {
                 ierr = cmor_close_variable(varid, &file_name[0], &preserved_id);
@@ -864,6 +1119,7 @@ static PyObject *PyCMOR_close(PyObject * self, PyObject * args)
                 ierr = cmor_close_variable(varid, NULL, NULL);
             }
         }
+        Py_END_ALLOW_THREADS
     }
 
     if (ierr != 0 || raise_exception) {
@@ -1035,6 +1291,7 @@ static PyObject *PyCMOR_grid(PyObject * self, PyObject * args)
 
 static PyMethodDef MyExtractMethods[] = {
     {"setup", PyCMOR_setup, METH_VARARGS},
+    {"set_chunk_cache", PyCMOR_set_chunk_cache, METH_VARARGS},
     {"dataset_json", PyCMOR_dataset_json, METH_VARARGS},
     {"load_table", PyCMOR_load_table, METH_VARARGS},
     {"axis", PyCMOR_axis, METH_VARARGS},
@@ -1064,6 +1321,13 @@ static PyMethodDef MyExtractMethods[] = {
     {"set_furtherinfourl", PyCMOR_set_furtherinfourl, METH_VARARGS},
     {"get_final_filename", PyCMOR_getFinalFilename, METH_VARARGS},
     {"set_deflate", PyCMOR_set_deflate, METH_VARARGS},
+    {"set_compression", PyCMOR_set_compression, METH_VARARGS},
+    {"get_units_cache_hits", PyCMOR_get_units_cache_hits, METH_VARARGS},
+    {"get_chunk_cache", PyCMOR_get_chunk_cache, METH_VARARGS},
+    {"preallocate", PyCMOR_preallocate, METH_VARARGS},
+    {"write_region", PyCMOR_write_region, METH_VARARGS},
+    {"wait", PyCMOR_wait, METH_VARARGS},
+    {"flush", PyCMOR_flush, METH_VARARGS},
     {NULL, NULL}                /*sentinel */
 };
 
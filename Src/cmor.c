@@ -21,6 +21,9 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 /* ==================================================================== */
 /*      this is defining NETCDF4 variable if we are                     */
@@ -82,9 +85,20 @@ FILE *output_logfile;
 /*      Variable related to cmor                                        */
 /* -------------------------------------------------------------------- */
 cmor_dataset_def cmor_current_dataset;
-cmor_table_t cmor_tables[CMOR_MAX_TABLES];
-cmor_var_t cmor_vars[CMOR_MAX_VARIABLES];
-cmor_axis_t cmor_axes[CMOR_MAX_AXES];
+/* -------------------------------------------------------------------- */
+/*      registries, grown on demand by cmor_grow_registry().  The       */
+/*      first *_allocated elements are set up, the capacity behind      */
+/*      them is only touched once an element is reserved.               */
+/* -------------------------------------------------------------------- */
+cmor_table_t *cmor_tables = NULL;
+cmor_var_t *cmor_vars = NULL;
+cmor_axis_t *cmor_axes = NULL;
+int cmor_tables_allocated = 0;
+int cmor_vars_allocated = 0;
+int cmor_axes_allocated = 0;
+static int cmor_tables_capacity = 0;
+static int cmor_vars_capacity = 0;
+static int cmor_axes_capacity = 0;
 cmor_grid_t cmor_grids[CMOR_MAX_GRIDS];
 
 int CMOR_MODE;
@@ -103,9 +117,24 @@ int cmor_nwarnings;
 int did_history = 0;
 
 int CMOR_CREATE_SUBDIRECTORIES = 1;
+size_t CMOR_CHUNK_CACHE_SIZE = 0;
 
 char cmor_input_path[CMOR_MAX_STRING];
-char cmor_traceback_info[CMOR_MAX_STRING];
+CMOR_THREAD_LOCAL const char *cmor_traceback_stack[CMOR_MAX_TRACEBACK];
+CMOR_THREAD_LOCAL int cmor_traceback_depth = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Concurrent writes: cmor_write_mutex guards every CMOR global    */
+/*      and every netCDF call, the workers only hold it while they      */
+/*      touch their queue or call nc_put_vara.  Entry points that       */
+/*      define or write take it through cmor_lock(), which nests, so    */
+/*      the registries are never grown under a worker's feet.           */
+/* -------------------------------------------------------------------- */
+pthread_mutex_t cmor_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cmor_write_done = PTHREAD_COND_INITIALIZER;
+cmor_write_worker_t cmor_write_workers[CMOR_MAX_WRITE_THREADS];
+int cmor_nwrite_threads = -1;
+CMOR_THREAD_LOCAL int cmor_lock_depth = 0;
 
 int bAppendMode = FALSE;
 
@@ -391,18 +420,16 @@ void cmor_is_setup(void)
 
 /************************************************************************/
 /*                         cmor_add_traceback()                         */
+/*                                                                      */
+/*      Function names must be string constants, only the pointer is    */
+/*      kept.  Frames deeper than CMOR_MAX_TRACEBACK are counted but    */
+/*      not recorded.                                                   */
 /************************************************************************/
-void cmor_add_traceback(char *name)
+void cmor_add_traceback(const char *name)
 {
-    char tmp[CMOR_MAX_STRING];
-
-    if (strlen(cmor_traceback_info) == 0) {
-        sprintf(cmor_traceback_info, "%s\n! ", name);
-    } else {
-        sprintf(tmp, "%s\n! called from: %s", name, cmor_traceback_info);
-        strncpy(cmor_traceback_info, tmp, CMOR_MAX_STRING);
-    }
-    return;
+    if (cmor_traceback_depth < CMOR_MAX_TRACEBACK)
+        cmor_traceback_stack[cmor_traceback_depth] = name;
+    cmor_traceback_depth++;
 }
 
 /************************************************************************/
@@ -410,18 +437,29 @@ void cmor_add_traceback(char *name)
 /************************************************************************/
 void cmor_pop_traceback(void)
 {
-    int i;
-    char tmp[CMOR_MAX_STRING];
+    if (cmor_traceback_depth > 0)
+        cmor_traceback_depth--;
+}
 
-    strcpy(tmp, "");
-    for (i = 0; i < strlen(cmor_traceback_info); i++) {
-        if (strncmp(&cmor_traceback_info[i], "called from: ", 13) == 0) {
-            strcpy(tmp, &cmor_traceback_info[i + 13]);
-            break;
-        }
+/************************************************************************/
+/*                         cmor_get_traceback()                         */
+/*                                                                      */
+/*      Formats the current call stack, innermost function first.       */
+/************************************************************************/
+void cmor_get_traceback(char *traceback, int size)
+{
+    int i, n;
+
+    n = 0;
+    traceback[0] = '\0';
+    i = cmor_traceback_depth - 1;
+    if (i >= CMOR_MAX_TRACEBACK)
+        i = CMOR_MAX_TRACEBACK - 1;
+    for (; (i >= 0) && (n < size); i--) {
+        n += snprintf(traceback + n, size - n, "%s%s\n! ",
+                      (n == 0) ? "" : "called from: ",
+                      cmor_traceback_stack[i]);
     }
-    strcpy(cmor_traceback_info, tmp);
-    return;
 }
 
 /************************************************************************/
@@ -432,7 +470,7 @@ int cmor_have_NetCDF4(void)
     char version[50];
     int major;
 
-    cmor_pop_traceback();
+    cmor_add_traceback("cmor_have_NetCDF4");
     strncpy(version, nc_inq_libvers(), 50);
     sscanf(version, "%1d%*s", &major);
     if (major != 4) {
@@ -542,6 +580,7 @@ void cmor_handle_error(char error_msg[CMOR_MAX_STRING], int level)
 {
     int i;
     char msg[CMOR_MAX_STRING];
+    char traceback[CMOR_MAX_STRING];
     extern FILE *output_logfile;
 
     if (output_logfile == NULL)
@@ -552,15 +591,16 @@ void cmor_handle_error(char error_msg[CMOR_MAX_STRING], int level)
         fprintf(output_logfile, "\n");
     }
     if (level == CMOR_WARNING) {
-        cmor_nwarnings++;
+        CMOR_ATOMIC_INC(cmor_nwarnings);
         if (CMOR_VERBOSITY != CMOR_QUIET) {
 
 #ifdef COLOREDOUTPUT
             fprintf(output_logfile, "%c[%d;%d;%dm", 0X1B, 2, 34, 47);
 #endif
 
+            cmor_get_traceback(traceback, CMOR_MAX_STRING);
             fprintf(output_logfile, "C Traceback:\nIn function: %s",
-                    cmor_traceback_info);
+                    traceback);
 
 #ifdef COLOREDOUTPUT
             fprintf(output_logfile, "%c[%dm", 0X1B, 0);
@@ -575,14 +615,15 @@ void cmor_handle_error(char error_msg[CMOR_MAX_STRING], int level)
             snprintf(msg, CMOR_MAX_STRING, "! Warning: %s", error_msg);
         }
     } else {
-        cmor_nerrors++;
+        CMOR_ATOMIC_INC(cmor_nerrors);
 
 #ifdef COLOREDOUTPUT
         fprintf(output_logfile, "%c[%d;%d;%dm", 0X1B, 2, 31, 47);
 #endif
 
+        cmor_get_traceback(traceback, CMOR_MAX_STRING);
         fprintf(output_logfile, "C Traceback:\n! In function: %s",
-                cmor_traceback_info);
+                traceback);
 
 #ifdef COLOREDOUTPUT
         fprintf(output_logfile, "%c[%dm", 0X1B, 0);
@@ -633,12 +674,171 @@ void cmor_handle_error_var(char error_msg[CMOR_MAX_STRING], int level,
     cmor_handle_error(error_msg, level);
 }
 
+/************************************************************************/
+/*                           cmor_reset_axis()                          */
+/************************************************************************/
+void cmor_reset_axis(int axis_id)
+{
+    int j;
+
+    cmor_axes[axis_id].ref_table_id = -1;
+    cmor_axes[axis_id].ref_axis_id = -1;
+    cmor_axes[axis_id].isgridaxis = -1;
+    cmor_axes[axis_id].axis = '\0';
+    cmor_axes[axis_id].iunits[0] = '\0';
+    cmor_axes[axis_id].id[0] = '\0';
+
+    if (cmor_axes[axis_id].values != NULL)
+        free(cmor_axes[axis_id].values);
+
+    cmor_axes[axis_id].values = NULL;
+
+    if (cmor_axes[axis_id].bounds != NULL)
+        free(cmor_axes[axis_id].bounds);
+
+    cmor_axes[axis_id].bounds = NULL;
+
+    if (cmor_axes[axis_id].cvalues != NULL) {
+        for (j = 0; j < cmor_axes[axis_id].length; j++) {
+            if (cmor_axes[axis_id].cvalues[j] != NULL) {
+                free(cmor_axes[axis_id].cvalues[j]);
+                cmor_axes[axis_id].cvalues[j] = NULL;
+            }
+        }
+        free(cmor_axes[axis_id].cvalues);
+    }
+
+    cmor_axes[axis_id].cvalues = NULL;
+    cmor_axes[axis_id].length = 0;
+    cmor_axes[axis_id].revert = 1;        /* 1 means no reverse -1 means reverse */
+    cmor_axes[axis_id].offset = 0;
+    cmor_axes[axis_id].type = '\0';
+
+    cmor_axes[axis_id].nattributes = 0;
+    cmor_axes[axis_id].hybrid_in = 0;
+    cmor_axes[axis_id].hybrid_out = 0;
+    cmor_axes[axis_id].store_in_netcdf = 1;
+    cmor_axes[axis_id].wrapping = NULL;
+    cmor_set_axis_attribute(axis_id, "units", 'c', "");
+    cmor_set_axis_attribute(axis_id, "interval", 'c', "");
+}
+
+/************************************************************************/
+/*                         cmor_grow_registry()                         */
+/*                                                                      */
+/*      Makes room for element n in a registry of elements of size      */
+/*      bytes that currently holds *allocated of them, adding           */
+/*      increment elements at a time (doubling if increment is 0).      */
+/*      New elements are left as they come from realloc, callers set    */
+/*      up each element as they hand it out.  The registry may move,    */
+/*      so callers must not keep pointers into it across a call that    */
+/*      can create new entries.                                         */
+/************************************************************************/
+void *cmor_grow_registry(void *registry, int *allocated, int n, size_t size,
+                         int increment)
+{
+    int nalloc;
+    void *tmp;
+    char msg[CMOR_MAX_STRING];
+
+    if (n < *allocated)
+        return (registry);
+
+    nalloc = *allocated;
+    while (nalloc <= n) {
+        if (increment > 0)
+            nalloc += increment;
+        else
+            nalloc = (nalloc < 4) ? 4 : 2 * nalloc;
+    }
+
+    tmp = realloc(registry, (size_t) nalloc * size);
+    if (tmp == NULL) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "cannot allocate memory for %i registry elements", nalloc);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        return (registry);
+    }
+    *allocated = nalloc;
+    return (tmp);
+}
+
+/************************************************************************/
+/*                        cmor_reserve_variable()                       */
+/*                                                                      */
+/*      Makes sure cmor_vars has a slot var_id, setting up the slots    */
+/*      up to it.                                                       */
+/************************************************************************/
+int cmor_reserve_variable(int var_id)
+{
+    cmor_vars = cmor_grow_registry(cmor_vars, &cmor_vars_capacity, var_id,
+                                   sizeof(cmor_var_t), 0);
+    if (var_id >= cmor_vars_capacity)
+        return (1);
+    while (cmor_vars_allocated <= var_id) {
+        memset(&cmor_vars[cmor_vars_allocated], 0, sizeof(cmor_var_t));
+        cmor_reset_variable(cmor_vars_allocated++);
+    }
+    return (0);
+}
+
+/************************************************************************/
+/*                          cmor_reserve_axis()                         */
+/************************************************************************/
+int cmor_reserve_axis(int axis_id)
+{
+    cmor_axes = cmor_grow_registry(cmor_axes, &cmor_axes_capacity, axis_id,
+                                   sizeof(cmor_axis_t), 0);
+    if (axis_id >= cmor_axes_capacity)
+        return (1);
+    while (cmor_axes_allocated <= axis_id) {
+        memset(&cmor_axes[cmor_axes_allocated], 0, sizeof(cmor_axis_t));
+        cmor_reset_axis(cmor_axes_allocated++);
+    }
+    return (0);
+}
+
+/************************************************************************/
+/*                          cmor_reserve_table()                        */
+/*                                                                      */
+/*      Tables are initialized by cmor_init_table() when loaded.        */
+/************************************************************************/
+int cmor_reserve_table(int table_id)
+{
+    cmor_tables = cmor_grow_registry(cmor_tables, &cmor_tables_capacity,
+                                     table_id, sizeof(cmor_table_t), 0);
+    if (table_id >= cmor_tables_capacity)
+        return (1);
+    while (cmor_tables_allocated <= table_id)
+        memset(&cmor_tables[cmor_tables_allocated++], 0,
+               sizeof(cmor_table_t));
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_get_free_variable()                       */
+/*                                                                      */
+/*      Returns the first unused variable id, growing cmor_vars if      */
+/*      they are all taken, -1 if we ran out of memory.                 */
+/************************************************************************/
+int cmor_get_free_variable(void)
+{
+    int i;
+
+    for (i = 0; i < cmor_vars_allocated; i++) {
+        if (cmor_vars[i].self == -1)
+            return (i);
+    }
+    if (cmor_reserve_variable(i) != 0)
+        return (-1);
+    return (i);
+}
+
 /************************************************************************/
 /*                        cmor_reset_variable()                         */
 /************************************************************************/
 void cmor_reset_variable(int var_id)
 {
-    extern cmor_var_t cmor_vars[];
     int j;
 
     cmor_vars[var_id].self = -1;
@@ -650,12 +850,9 @@ void cmor_reset_variable(int var_id)
     cmor_vars[var_id].initialized = -1;
     cmor_vars[var_id].error = 0;
     cmor_vars[var_id].closed = 0;
+    cmor_vars[var_id].tracking_id_pending = 0;
     cmor_vars[var_id].nc_var_id = -999;
 
-    for (j = 0; j < CMOR_MAX_VARIABLES; j++) {
-        cmor_vars[var_id].nc_zfactors[j] = -999;
-    }
-
     cmor_vars[var_id].nzfactor = 0;
     cmor_vars[var_id].ntimes_written = 0;
 
@@ -680,13 +877,6 @@ void cmor_reset_variable(int var_id)
 
     }
 
-    for (j = 0; j < CMOR_MAX_ATTRIBUTES; j++) {
-        cmor_vars[var_id].attributes_values_char[j][0] = '\0';
-        cmor_vars[var_id].attributes_values_num[j] = -999.;
-        cmor_vars[var_id].attributes_type[j] = '\0';
-        cmor_vars[var_id].attributes[j][0] = '\0';
-    }
-
     cmor_vars[var_id].nattributes = 0;
     cmor_vars[var_id].type = '\0';
     cmor_vars[var_id].itype = 'N';
@@ -700,6 +890,12 @@ void cmor_reset_variable(int var_id)
     cmor_vars[var_id].shuffle = 0;
     cmor_vars[var_id].deflate = 1;
     cmor_vars[var_id].deflate_level = 1;
+    cmor_vars[var_id].write_error = 0;
+    cmor_vars[var_id].async = 0;
+    cmor_vars[var_id].fletcher32 = 0;
+    cmor_vars[var_id].filter_id = 0;
+    cmor_vars[var_id].filter_nparams = 0;
+    cmor_vars[var_id].significant_digits = 0;
     cmor_vars[var_id].nomissing = 1;
     cmor_vars[var_id].iunits[0] = '\0';
     cmor_vars[var_id].ounits[0] = '\0';
@@ -721,6 +917,13 @@ void cmor_reset_variable(int var_id)
     cmor_vars[var_id].suffix[0] = '\0';
     cmor_vars[var_id].suffix_has_date = 0;
     cmor_vars[var_id].frequency[0] = '\0';
+    cmor_free_units_cache(&cmor_vars[var_id]);
+    cmor_vars[var_id].units_cache_hits = 0;
+    cmor_vars[var_id].chunk_cache = 0;
+    cmor_free_staging(&cmor_vars[var_id]);
+    cmor_free_written(&cmor_vars[var_id]);
+    cmor_vars[var_id].units_scale = 1.;
+    cmor_vars[var_id].units_offset = 0.;
 }
 
 /************************************************************************/
@@ -732,7 +935,6 @@ int cmor_setup(char *path,
                int *mode, char *logfile, int *create_subdirectories)
 {
 
-    extern cmor_axis_t cmor_axes[];
     extern int CMOR_TABLE, cmor_ntables;
     extern ut_system *ut_read;
     extern cmor_dataset_def cmor_current_dataset;
@@ -759,7 +961,7 @@ int cmor_setup(char *path,
     action.sa_handler = terminate;
     sigaction(SIGTERM, &action, NULL);
 
-    strcpy(cmor_traceback_info, "");
+    cmor_traceback_depth = 0;
     cmor_add_traceback("cmor_setup");
 
 /* -------------------------------------------------------------------- */
@@ -906,58 +1108,12 @@ int cmor_setup(char *path,
         strncpytrim(cmor_input_path, path, CMOR_MAX_STRING);
     }
 
-    for (i = 0; i < CMOR_MAX_VARIABLES; i++) {
+    for (i = 0; i < cmor_vars_allocated; i++) {
         cmor_reset_variable(i);
     }
 
-    for (i = 0; i < CMOR_MAX_AXES; i++) {
-        cmor_axes[i].ref_table_id = -1;
-        cmor_axes[i].ref_axis_id = -1;
-        cmor_axes[i].isgridaxis = -1;
-        cmor_axes[i].axis = '\0';
-        cmor_axes[i].iunits[0] = '\0';
-        cmor_axes[i].id[0] = '\0';
-
-        if (cmor_axes[i].values != NULL)
-            free(cmor_axes[i].values);
-
-        cmor_axes[i].values = NULL;
-
-        if (cmor_axes[i].bounds != NULL)
-            free(cmor_axes[i].bounds);
-
-        cmor_axes[i].bounds = NULL;
-
-        if (cmor_axes[i].cvalues != NULL) {
-            for (j = 0; j < cmor_axes[i].length; j++) {
-                if (cmor_axes[i].cvalues[j] != NULL) {
-                    free(cmor_axes[i].cvalues[j]);
-                    cmor_axes[i].cvalues[j] = NULL;
-                }
-            }
-            free(cmor_axes[i].cvalues);
-        }
-
-        cmor_axes[i].cvalues = NULL;
-        cmor_axes[i].length = 0;
-        cmor_axes[i].revert = 1;        /* 1 means no reverse -1 means reverse */
-        cmor_axes[i].offset = 0;
-        cmor_axes[i].type = '\0';
-
-        for (j = 0; j < CMOR_MAX_ATTRIBUTES; j++) {
-            cmor_axes[i].attributes_values_char[j][0] = '\0';
-            cmor_axes[i].attributes_values_num[j] = -999.;
-            cmor_axes[i].attributes_type[j] = '\0';
-            cmor_axes[i].attributes[j][0] = '\0';
-        }
-
-        cmor_axes[i].nattributes = 0;
-        cmor_axes[i].hybrid_in = 0;
-        cmor_axes[i].hybrid_out = 0;
-        cmor_axes[i].store_in_netcdf = 1;
-        cmor_axes[i].wrapping = NULL;
-        cmor_set_axis_attribute(i, "units", 'c', "");
-        cmor_set_axis_attribute(i, "interval", 'c', "");
+    for (i = 0; i < cmor_axes_allocated; i++) {
+        cmor_reset_axis(i);
     }
 
     if (create_subdirectories != NULL) {
@@ -970,6 +1126,7 @@ int cmor_setup(char *path,
                  "cmor_setup: create_subdirectories must be 0 or 1");
         cmor_handle_error(msg, CMOR_CRITICAL);
     }
+    CMOR_CHUNK_CACHE_SIZE = 0;
 
 /* -------------------------------------------------------------------- */
 /*      initialize the udunits                                          */
@@ -1818,7 +1975,7 @@ int cmor_define_zfactors_vars(int var_id, int ncid, int *nc_dim,
     char msg[CMOR_MAX_STRING];
     char ctmp[CMOR_MAX_STRING];
     int ierr = 0, l, m, k, n, j, m2, found, nelts, *int_list = NULL;
-    int dim_holder[CMOR_MAX_VARIABLES];
+    int dim_holder[CMOR_MAX_DIMENSIONS + 1];
     int lnzfactors;
     int ics, icd, icdl, ia;
     cmor_add_traceback("cmor_define_zfactors_vars");
@@ -2013,10 +2170,12 @@ int cmor_define_zfactors_vars(int var_id, int ncid, int *nc_dim,
                     && (CMOR_NETCDF_MODE != CMOR_APPEND_3)) {
                     if (cmor_vars[l].ndims > 0) {
                         int nTableID = cmor_vars[l].ref_table_id;
-                        ics = cmor_tables[nTableID].vars[nTableID].shuffle;
-                        icd = cmor_tables[nTableID].vars[nTableID].deflate;
-                        icdl =
-                          cmor_tables[nTableID].vars[nTableID].deflate_level;
+                        cmor_var_def_t *pVarDef =
+                          cmor_get_var_def(nTableID,
+                                           cmor_vars[l].ref_var_id);
+                        ics = pVarDef->shuffle;
+                        icd = pVarDef->deflate;
+                        icdl = pVarDef->deflate_level;
                         ierr = nc_def_var_deflate(ncid, nc_zfactors[lnzfactors],
                                                   ics, icd, icdl);
 
@@ -2225,8 +2384,6 @@ void cmor_flip_hybrid(int var_id, int i, char *a, char *b, char *abnds,
 {
     int doflip, j, k, l = 0;
     double tmp;
-    extern cmor_var_t cmor_vars[CMOR_MAX_VARIABLES];
-    extern cmor_axis_t cmor_axes[CMOR_MAX_AXES];
 
     cmor_add_traceback("cmor_flip_hybrid");
 
@@ -2442,19 +2599,25 @@ void cmor_checkMissing(int varid, int var_id, char type)
 /************************************************************************/
 int copyfile(const char *to, const char *from) {
     int fd_to, fd_from;
-    char buf[4096];
+    char *buf;
     ssize_t nread;
     int saved_errno;
 
+    buf = malloc(CMOR_COPY_BUFFER);
+    if (buf == NULL)
+        return (-1);
+
     fd_from = open(from, O_RDONLY);
-    if (fd_from < 0)
+    if (fd_from < 0) {
+        free(buf);
         return (-1);
+    }
 
     fd_to = open(to, O_WRONLY | O_CREAT | O_EXCL, 0666);
     if (fd_to < 0)
         goto out_error;
 
-    while (nread = read(fd_from, buf, sizeof buf), nread > 0) {
+    while (nread = read(fd_from, buf, CMOR_COPY_BUFFER), nread > 0) {
         char *out_ptr = buf;
         ssize_t nwritten;
 
@@ -2476,6 +2639,7 @@ int copyfile(const char *to, const char *from) {
             goto out_error;
         }
         close(fd_from);
+        free(buf);
 
         /* Success! */
         unlink(from);
@@ -2488,11 +2652,106 @@ int copyfile(const char *to, const char *from) {
     close(fd_from);
     if (fd_to >= 0)
         close(fd_to);
+    free(buf);
 
     errno = saved_errno;
     return (-1);
 }
 
+/************************************************************************/
+/*                         copyfile_range()                             */
+/*                                                                      */
+/*      Same as copyfile() but the kernel copies the data, sharing the  */
+/*      extents or copying on the server where the filesystems can.     */
+/*      Returns 1 when the kernel cannot do it and nothing was written. */
+/************************************************************************/
+int copyfile_range(const char *to, const char *from)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+    int fd_to, fd_from;
+    struct stat st;
+    off_t left;
+    ssize_t ncopied;
+    int saved_errno;
+
+    fd_from = open(from, O_RDONLY);
+    if (fd_from < 0)
+        return (-1);
+    if (fstat(fd_from, &st) != 0) {
+        close(fd_from);
+        return (-1);
+    }
+
+    fd_to = open(to, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd_to < 0) {
+        saved_errno = errno;
+        close(fd_from);
+        errno = saved_errno;
+        return (-1);
+    }
+
+    left = st.st_size;
+    while (left > 0) {
+        ncopied = syscall(SYS_copy_file_range, fd_from, NULL, fd_to, NULL,
+                          (size_t) left, 0);
+        if (ncopied <= 0) {
+            break;
+        }
+        left -= ncopied;
+    }
+    saved_errno = errno;
+    close(fd_from);
+    if ((close(fd_to) == 0) && (left == 0)) {
+        unlink(from);
+        return (0);
+    }
+    unlink(to);
+/* -------------------------------------------------------------------- */
+/*      not supported between these files, let copyfile() do it        */
+/* -------------------------------------------------------------------- */
+    if ((left == st.st_size) && ((saved_errno == ENOSYS)
+                                 || (saved_errno == EXDEV)
+                                 || (saved_errno == EINVAL)
+                                 || (saved_errno == EOPNOTSUPP))) {
+        return (1);
+    }
+    errno = saved_errno;
+    return (-1);
+#else
+    return (1);
+#endif
+}
+
+/************************************************************************/
+/*                          cmor_move_file()                            */
+/*                                                                      */
+/*      Moves the file an append reopens to its temporary name, with    */
+/*      the cheapest of rename(), copy_file_range() and copyfile() that */
+/*      works.  Returns the CMOR_MOVE_* used, -1 with errno on failure. */
+/************************************************************************/
+int cmor_move_file(const char *to, const char *from)
+{
+    int ierr;
+
+    if (rename(from, to) == 0) {
+        return (CMOR_MOVE_RENAME);
+    }
+    if (errno != EXDEV) {
+        return (-1);
+    }
+    ierr = copyfile_range(to, from);
+    if (ierr == 0) {
+        return (CMOR_MOVE_COPY_RANGE);
+    }
+    if (ierr < 0) {
+        return (-1);
+    }
+    if (copyfile(to, from) != 0) {
+        return (-1);
+    }
+    return (CMOR_MOVE_COPY);
+}
+
 /************************************************************************/
 /*                    cmor_validateFilename()                           */
 /************************************************************************/
@@ -2506,8 +2765,9 @@ int cmor_validateFilename(char *outname, char *file_suffix, int var_id)
     size_t starts[2];
     size_t nctmp;
     int ncid;
-    int i;
+    int i, append;
     cmor_add_traceback("cmor_validateFilename");
+    append = 0;
     ncid = -1;
     ierr = 0;
     if (USE_NETCDF_4 == 1) {
@@ -2559,9 +2819,27 @@ int cmor_validateFilename(char *outname, char *file_suffix, int var_id)
 
         } else {                /*ok it was there already */
             bAppendMode = TRUE;
+            append = 1;
             ierr = fclose(fperr);
             fperr = NULL;
-            copyfile(outname, file_suffix);
+/* -------------------------------------------------------------------- */
+/*      take the file over, copying it only across filesystems          */
+/* -------------------------------------------------------------------- */
+            ierr = cmor_move_file(outname, file_suffix);
+            if (ierr < 0) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "Could not move file: %s to %s for appending (%s)",
+                         file_suffix, outname, strerror(errno));
+                cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+            } else if (CMOR_VERBOSITY != CMOR_QUIET) {
+                if (output_logfile == NULL)
+                    output_logfile = stderr;
+                fprintf(output_logfile, "! Appending to %s (%s)\n",
+                        file_suffix,
+                        (ierr == CMOR_MOVE_RENAME) ? "renamed" :
+                        (ierr == CMOR_MOVE_COPY_RANGE) ?
+                        "copied by the kernel" : "copied");
+            }
             ierr = nc_open(outname, NC_WRITE, &ncid);
 
             if (ierr != NC_NOERR) {
@@ -2674,11 +2952,238 @@ int cmor_validateFilename(char *outname, char *file_suffix, int var_id)
                  "NetCDF Error (%i: %s) creating file: %s", ierr,
                  nc_strerror(ierr), outname);
         cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+    } else {
+        cmor_set_nofill(var_id, ncid, append);
     }
     cmor_pop_traceback();
     return (ncid);
 }
 
+/************************************************************************/
+/*                           cmor_set_nofill()                          */
+/*                                                                      */
+/*      A new file first written by cmor_write(), whole slabs at a      */
+/*      time, is not pre-filled with _FillValue only for it to be       */
+/*      overwritten.  Files appended to or written by                   */
+/*      cmor_write_region() keep the fill so that blocks left out read  */
+/*      as missing.  "_nofill" set to "0" keeps the fill for every      */
+/*      file, any other value drops it for every file.                  */
+/*      cmor_close_variable() checks that every time step was written.  */
+/************************************************************************/
+void cmor_set_nofill(int var_id, int ncid, int append)
+{
+    char value[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    int ierr, old;
+
+    cmor_add_traceback("cmor_set_nofill");
+    cmor_vars[var_id].nofill = ((append == 0)
+                                && (cmor_vars[var_id].region == 0));
+    if (cmor_has_cur_dataset_attribute(CMOR_NOFILL) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_NOFILL, value);
+        cmor_vars[var_id].nofill = (strcmp(value, "0") != 0);
+    }
+    if (cmor_vars[var_id].nofill == 1) {
+        ierr = nc_set_fill(ncid, NC_NOFILL, &old);
+        if (ierr != NC_NOERR) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "NetCDF Error (%i: %s) setting no fill mode for "
+                     "variable %s", ierr, nc_strerror(ierr),
+                     cmor_vars[var_id].id);
+            cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+            cmor_vars[var_id].nofill = 0;
+        }
+    }
+    cmor_pop_traceback();
+}
+
+/************************************************************************/
+/*                        cmor_set_chunk_cache()                        */
+/*                                                                      */
+/*      Setup wide chunk cache size in bytes for every netCDF-4         */
+/*      variable CMOR creates, 0 to let CMOR size it per variable.      */
+/*      Call after cmor_setup(), which resets it.  The "_chunk_cache"   */
+/*      dataset attribute takes precedence.                             */
+/************************************************************************/
+int cmor_set_chunk_cache(size_t size)
+{
+    cmor_add_traceback("cmor_set_chunk_cache");
+    CMOR_CHUNK_CACHE_SIZE = size;
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_size_chunk_cache()                        */
+/*                                                                      */
+/*      A variable written ntimes_passed steps at a time into chunks    */
+/*      that span more steps keeps a whole row of chunks half written   */
+/*      between calls; the HDF5 cache must hold that row or each call   */
+/*      decompresses and recompresses it.  The cache is only grown.     */
+/*      The size chosen is kept in the variable's chunk_cache.          */
+/************************************************************************/
+void cmor_size_chunk_cache(int var_id, int ncid, size_t * chunk,
+                           int ntimes_passed)
+{
+    char value[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    char axis[CMOR_MAX_DIMENSIONS];
+    char *end;
+    size_t length[CMOR_MAX_DIMENSIONS];
+    size_t size, nelems, nchunks, need;
+    float preemption;
+    cmor_var_t *pVar = &cmor_vars[var_id];
+    long lvalue;
+    int i, ierr;
+
+    cmor_add_traceback("cmor_size_chunk_cache");
+    ierr = nc_get_var_chunk_cache(ncid, pVar->nc_var_id, &size, &nelems,
+                                  &preemption);
+    if (ierr != NC_NOERR) {
+        cmor_pop_traceback();
+        return;
+    }
+    pVar->chunk_cache = size;
+
+    need = 0;
+    nchunks = 0;
+    if (cmor_has_cur_dataset_attribute(CMOR_CHUNK_CACHE) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_CHUNK_CACHE, value);
+        lvalue = strtol(value, &end, 10);
+        if ((end != value) && (*end == '\0') && (lvalue > 0)) {
+            need = lvalue;
+        } else {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "%s must be a positive number of bytes, you passed "
+                     "%s, sizing the chunk cache of variable %s from its "
+                     "chunks", CMOR_CHUNK_CACHE, value, pVar->id);
+            cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+        }
+    }
+    if ((need == 0) && (CMOR_CHUNK_CACHE_SIZE > 0)) {
+        need = CMOR_CHUNK_CACHE_SIZE;
+    } else if (need == 0) {
+        for (i = 0; i < pVar->ndims; i++) {
+            axis[i] = cmor_axes[pVar->axes_ids[i]].axis;
+            length[i] = cmor_axes[pVar->axes_ids[i]].length;
+        }
+        need = cmor_chunk_cache_size(pVar->ndims, length, axis, chunk,
+                                     (pVar->type == 'd') ? 8 : 4,
+                                     ntimes_passed, &nchunks);
+        if (need > CMOR_MAX_CHUNK_CACHE) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "variable %s needs a %lu bytes chunk cache for "
+                     "writes of %i time steps, using %lu; set %s or "
+                     "write more time steps at once",
+                     pVar->id, (unsigned long)need, ntimes_passed,
+                     (unsigned long)CMOR_MAX_CHUNK_CACHE, CMOR_CHUNK_CACHE);
+            cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+            need = CMOR_MAX_CHUNK_CACHE;
+        }
+        if (need <= size) {
+            cmor_pop_traceback();
+            return;
+        }
+    }
+    if (need == 0) {
+        cmor_pop_traceback();
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      HDF5 wants a prime number of hash slots, well above the number  */
+/*      of chunks held                                                  */
+/* -------------------------------------------------------------------- */
+    if (nelems < 10 * nchunks) {
+        nelems = 10 * nchunks + 1;
+        for (;; nelems += 2) {
+            for (i = 3; (size_t) i * i <= nelems; i += 2)
+                if (nelems % i == 0)
+                    break;
+            if ((size_t) i * i > nelems)
+                break;
+        }
+    }
+    ierr = nc_set_var_chunk_cache(ncid, pVar->nc_var_id, need, nelems,
+                                  preemption);
+    if (ierr != NC_NOERR) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "NetCDF Error (%i: %s) setting a %lu bytes chunk cache "
+                 "for variable %s", ierr, nc_strerror(ierr),
+                 (unsigned long)need, pVar->id);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+    } else {
+        pVar->chunk_cache = need;
+    }
+    cmor_pop_traceback();
+}
+
+/************************************************************************/
+/*                             cmor_enddef()                            */
+/*                                                                      */
+/*      Leaves define mode.  netCDF-3 files keep free space after the   */
+/*      header so that attributes rewritten later (tracking_id at       */
+/*      close, history appended by other tools) do not move the whole   */
+/*      data section.  By default the pad is CMOR_DEFAULT_HEADER_PAD    */
+/*      plus room for these attributes to double, "_header_pad" sets    */
+/*      it in bytes and "_var_align" aligns the start of the data.      */
+/************************************************************************/
+int cmor_enddef(int ncid)
+{
+    char value[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    char *rewritten[] = { GLOBAL_ATT_TRACKING_ID, GLOBAL_ATT_HISTORY,
+        GLOBAL_ATT_CREATION_DATE
+    };
+    char *end;
+    size_t h_minfree, v_align;
+    long lvalue;
+    int i, ierr;
+
+    if ((CMOR_NETCDF_MODE != CMOR_REPLACE_3)
+        && (CMOR_NETCDF_MODE != CMOR_PRESERVE_3)
+        && (CMOR_NETCDF_MODE != CMOR_APPEND_3))
+        return (nc_enddef(ncid));
+
+    cmor_add_traceback("cmor_enddef");
+    h_minfree = CMOR_DEFAULT_HEADER_PAD;
+    for (i = 0; i < 3; i++) {
+        if (cmor_has_cur_dataset_attribute(rewritten[i]) == 0) {
+            cmor_get_cur_dataset_attribute(rewritten[i], value);
+            h_minfree += strlen(value);
+        }
+    }
+    if (cmor_has_cur_dataset_attribute(CMOR_HEADER_PAD) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_HEADER_PAD, value);
+        lvalue = strtol(value, &end, 10);
+        if ((end != value) && (*end == '\0') && (lvalue >= 0)) {
+            h_minfree = lvalue;
+        } else {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "%s must be a number of bytes, you passed %s, "
+                     "using %lu", CMOR_HEADER_PAD, value,
+                     (unsigned long)h_minfree);
+            cmor_handle_error(msg, CMOR_WARNING);
+        }
+    }
+    v_align = 4;
+    if (cmor_has_cur_dataset_attribute(CMOR_VAR_ALIGN) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_VAR_ALIGN, value);
+        lvalue = strtol(value, &end, 10);
+        if ((end != value) && (*end == '\0') && (lvalue > 0)) {
+            v_align = lvalue;
+        } else {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "%s must be a positive number of bytes, you passed "
+                     "%s, using 4", CMOR_VAR_ALIGN, value);
+            cmor_handle_error(msg, CMOR_WARNING);
+        }
+    }
+    ierr = nc__enddef(ncid, h_minfree, v_align, 0, 4);
+    cmor_pop_traceback();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                      cmor_setGblAttr()                               */
 /************************************************************************/
@@ -2702,12 +3207,14 @@ int cmor_setGblAttr(int var_id)
     int numchar;
     int nVarRefTblID;
     int ref_var_id;
+    cmor_var_def_t *pVarDef;
     int rc;
     int ierr = 0;
 
     cmor_add_traceback("cmor_setGblAttr");
     nVarRefTblID = cmor_vars[var_id].ref_table_id;
     ref_var_id = cmor_vars[var_id].ref_var_id;
+    pVarDef = cmor_get_var_def(nVarRefTblID, ref_var_id);
 
     if (cmor_has_cur_dataset_attribute(GLOBAL_ATT_FORCING) == 0) {
         cmor_get_cur_dataset_attribute(GLOBAL_ATT_FORCING, ctmp2);
@@ -2810,16 +3317,19 @@ int cmor_setGblAttr(int var_id)
 /* -------------------------------------------------------------------- */
 /*      first check if the variable itself has a realm                  */
 /* -------------------------------------------------------------------- */
-    if (cmor_tables[nVarRefTblID].vars[ref_var_id].realm[0] != '\0') {
-        szToken = strtok(cmor_tables[nVarRefTblID].vars[ref_var_id].realm, " ");
+    if (pVarDef->realm[0] != '\0') {
+/* -------------------------------------------------------------------- */
+/*      table strings are shared, tokenize a copy                       */
+/* -------------------------------------------------------------------- */
+        strncpy(msg, pVarDef->realm, CMOR_MAX_STRING);
+        msg[CMOR_MAX_STRING - 1] = '\0';
+        szToken = strtok(msg, " ");
         if (szToken != NULL) {
             cmor_set_cur_dataset_attribute_internal(GLOBAL_ATT_REALM,
                                                     szToken, 0);
         } else {
             cmor_set_cur_dataset_attribute_internal(GLOBAL_ATT_REALM,
-                                                    cmor_tables
-                                                    [nVarRefTblID].vars
-                                                    [ref_var_id].realm, 0);
+                                                    pVarDef->realm, 0);
         }
     } else {
 /* -------------------------------------------------------------------- */
@@ -2860,6 +3370,7 @@ int cmor_setGblAttr(int var_id)
                          cmor_vars[var_id].id);
                 cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
                 regfree(&regex);
+                cmor_pop_traceback();
                 return (-1);
 
             }
@@ -2947,6 +3458,7 @@ int cmor_setGblAttr(int var_id)
         did_history = 1;
     }
 
+    cmor_pop_traceback();
     return (ierr);
 }
 
@@ -3077,6 +3589,126 @@ void cmor_generate_uuid()
 
 }
 
+/************************************************************************/
+/*                        cmor_write_checksum()                         */
+/*                                                                      */
+/*  Writes the md5 of a finished output file to <filename>.md5, in the  */
+/*  format md5sum -c reads, when the dataset sets _output_checksum to   */
+/*  "md5".                                                              */
+/************************************************************************/
+int cmor_write_checksum(int var_id, char *filename)
+{
+    unsigned char checksum[16];
+    char value[CMOR_MAX_STRING];
+    char szChecksum[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    char *szBase;
+    FILE *checksum_file;
+    int i;
+
+    cmor_add_traceback("cmor_write_checksum");
+    cmor_get_cur_dataset_attribute(CMOR_OUTPUT_CHECKSUM, value);
+    if (strcmp(value, "md5") != 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "unknown output checksum \"%s\", only md5 is supported",
+                 value);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+        cmor_pop_traceback();
+        return (1);
+    }
+    if (cmor_md5_file(filename, checksum) != 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "could not read %s to compute its checksum", filename);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+        cmor_pop_traceback();
+        return (1);
+    }
+
+    snprintf(szChecksum, CMOR_MAX_STRING, "%s.md5", filename);
+    checksum_file = fopen(szChecksum, "w");
+    if (checksum_file == NULL) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "could not write checksum file %s", szChecksum);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+        cmor_pop_traceback();
+        return (1);
+    }
+    for (i = 0; i < 16; i++) {
+        fprintf(checksum_file, "%02x", checksum[i]);
+    }
+    szBase = strrchr(filename, '/');
+    fprintf(checksum_file, "  %s\n", (szBase != NULL) ? szBase + 1 : filename);
+    fclose(checksum_file);
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                      cmor_tracking_id_once()                         */
+/*                                                                      */
+/*  Returns 1 when the dataset asks for a single tracking_id per file   */
+/*  (_tracking_id_once set to anything but "0") instead of a new one    */
+/*  on every cmor_write call.                                           */
+/************************************************************************/
+int cmor_tracking_id_once()
+{
+    char value[CMOR_MAX_STRING];
+
+    if (cmor_has_cur_dataset_attribute(GLOBAL_TRACKING_ID_ONCE) != 0) {
+        return (0);
+    }
+    cmor_get_cur_dataset_attribute(GLOBAL_TRACKING_ID_ONCE, value);
+    if ((strcmp(value, "0") == 0) || (strcmp(value, "false") == 0)) {
+        return (0);
+    }
+    return (1);
+}
+
+/************************************************************************/
+/*                      cmor_put_tracking_id()                          */
+/*                                                                      */
+/*  Generates a new tracking_id and rewrites it in the open file ncid.  */
+/************************************************************************/
+int cmor_put_tracking_id(int var_id, int ncid)
+{
+    int ierr;
+    char msg[CMOR_MAX_STRING];
+    char ctmp[CMOR_MAX_STRING];
+
+    cmor_add_traceback("cmor_put_tracking_id");
+
+    cmor_generate_uuid();
+    cmor_get_cur_dataset_attribute(GLOBAL_ATT_TRACKING_ID, ctmp);
+    ierr = nc_put_att_text(ncid, NC_GLOBAL, GLOBAL_ATT_TRACKING_ID,
+                           strlen(ctmp), ctmp);
+/* -------------------------------------------------------------------- */
+/*      a longer value needs define mode, the header pad left by        */
+/*      cmor_enddef() keeps the data in place                           */
+/* -------------------------------------------------------------------- */
+    if (ierr == NC_ENOTINDEFINE) {
+        ierr = nc_redef(ncid);
+        if (ierr == NC_NOERR)
+            ierr = nc_put_att_text(ncid, NC_GLOBAL, GLOBAL_ATT_TRACKING_ID,
+                                   strlen(ctmp), ctmp);
+        if (ierr == NC_NOERR)
+            ierr = cmor_enddef(ncid);
+    }
+    if (ierr != NC_NOERR) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "NetCDF error (%i: %s) for variable %s (table: %s)\n! "
+                 "writing global attribute: %s (%s)",
+                 ierr, nc_strerror(ierr), cmor_vars[var_id].id,
+                 cmor_tables[cmor_vars[var_id].ref_table_id].szTable_id,
+                 "tracking_id", ctmp);
+        cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+        cmor_pop_traceback();
+        return (1);
+    }
+    cmor_vars[var_id].tracking_id_pending = 0;
+    cmor_pop_traceback();
+    return (0);
+}
+
 /************************************************************************/
 /*                  cmor_write_all_atributes()                          */
 /************************************************************************/
@@ -3321,16 +3953,7 @@ void cmor_define_dimensions(int var_id, int ncid,
 /* -------------------------------------------------------------------- */
         j = cmor_axes[nAxisID].length;
         if ((i == 0) && (cmor_axes[nAxisID].axis == 'T'))
-            j = NC_UNLIMITED;
-
-        if ((cmor_axes[nAxisID].axis == 'X')
-            || (cmor_axes[nAxisID].axis == 'Y')) {
-            nc_dim_chunking[i] = j;
-        } else if (cmor_axes[nAxisID].isgridaxis == 1) {
-            nc_dim_chunking[i] = j;
-        } else {
-            nc_dim_chunking[i] = 1;
-        }
+            j = NC_UNLIMITED;
 
         ierr = nc_def_dim(ncid, cmor_axes[nAxisID].id, j, &nc_dim[i]);
         if (ierr != NC_NOERR) {
@@ -3359,6 +3982,12 @@ void cmor_define_dimensions(int var_id, int ncid,
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      chunk shape of the variable, used below for the time axis and   */
+/*      by cmor_create_var_attributes() for the variable itself         */
+/* -------------------------------------------------------------------- */
+    cmor_set_chunking(var_id, nVarRefTblID, nc_dim_chunking);
+
 /* -------------------------------------------------------------------- */
 /*      creates the bounds dim (only in metafile?)                      */
 /* -------------------------------------------------------------------- */
@@ -3415,7 +4044,6 @@ void cmor_define_dimensions(int var_id, int ncid,
             //
             // Define Chunking if NETCDF4
             //
-            cmor_set_chunking(var_id, nVarRefTblID, nc_dim_chunking);
             if ((CMOR_NETCDF_MODE != CMOR_REPLACE_3)
                 && (CMOR_NETCDF_MODE != CMOR_PRESERVE_3)
                 && (CMOR_NETCDF_MODE != CMOR_APPEND_3)) {
@@ -3865,13 +4493,14 @@ int cmor_grids_def(int var_id, int nGridID, int ncafid, int *nc_dim_af,
     char msg[CMOR_MAX_STRING];
     double tmps[2];
     int i, j, k, l;
-    int nc_dims_associated[CMOR_MAX_AXES];
+    int nc_dims_associated[CMOR_MAX_DIMENSIONS + 1];   /* and vertices */
     int nVarRefTblID = cmor_vars[var_id].ref_table_id;
     int m2[5];
     int *int_list = NULL;
     char mtype;
     int nelts;
     int ics, icd, icdl;
+    cmor_var_def_t *pVarDef;
 
     cmor_add_traceback("cmor_grids_def");
 /* -------------------------------------------------------------------- */
@@ -4126,18 +4755,11 @@ int cmor_grids_def(int var_id, int nGridID, int ncafid, int *nc_dim_af,
                 && (CMOR_NETCDF_MODE != CMOR_APPEND_3)) {
                 if (cmor_vars[j].ndims > 0) {
 
-                    ics =
-                      cmor_tables[cmor_vars[j].ref_table_id].vars[cmor_vars[j].
-                                                                  ref_var_id].
-                      shuffle;
-                    icd =
-                      cmor_tables[cmor_vars[j].ref_table_id].vars[cmor_vars[j].
-                                                                  ref_var_id].
-                      deflate;
-                    icdl =
-                      cmor_tables[cmor_vars[j].ref_table_id].vars[cmor_vars[j].
-                                                                  ref_var_id].
-                      deflate_level;
+                    pVarDef = cmor_get_var_def(cmor_vars[j].ref_table_id,
+                                               cmor_vars[j].ref_var_id);
+                    ics = pVarDef->shuffle;
+                    icd = pVarDef->deflate;
+                    icdl = pVarDef->deflate_level;
 
                     ierr = nc_def_var_deflate(ncafid, nc_associated_vars[i],
                                               ics, icd, icdl);
@@ -4252,15 +4874,460 @@ void create_singleton_dimensions(int var_id, int ncid, int *nc_singletons,
 
 }
 
+/************************************************************************/
+/*                              cmor_lock()                             */
+/*                                                                      */
+/*      Takes cmor_write_mutex unless this thread already holds it.     */
+/************************************************************************/
+void cmor_lock(void)
+{
+    if (cmor_lock_depth++ == 0)
+        pthread_mutex_lock(&cmor_write_mutex);
+}
+
+/************************************************************************/
+/*                             cmor_unlock()                            */
+/************************************************************************/
+void cmor_unlock(void)
+{
+    if (--cmor_lock_depth == 0)
+        pthread_mutex_unlock(&cmor_write_mutex);
+}
+
+/************************************************************************/
+/*                         cmor_write_worker()                          */
+/*                                                                      */
+/*      Drains one queue of converted slices; the queue of a file is    */
+/*      always the same worker so its slices stay in order.             */
+/************************************************************************/
+void *cmor_write_worker(void *arg)
+{
+    cmor_write_worker_t *worker = (cmor_write_worker_t *) arg;
+    cmor_write_job_t *job;
+
+    cmor_lock();
+    for (;;) {
+        while ((worker->first == NULL) && (worker->stop == 0))
+            pthread_cond_wait(&worker->queued, &cmor_write_mutex);
+        job = worker->first;
+        if (job == NULL)
+            break;
+
+        if (cmor_put_var_data(job->ncid, &cmor_vars[job->var_id], job->type,
+                              job->starts, job->counts, job->data) != 0)
+            cmor_vars[job->var_id].write_error = 1;
+
+        worker->first = job->next;
+        if (worker->first == NULL)
+            worker->last = NULL;
+        worker->njobs--;
+        if (job->staging == -1)
+            free(job->data);
+        else
+            cmor_vars[job->var_id].staging_busy[job->staging] = 0;
+        free(job);
+        pthread_cond_broadcast(&cmor_write_done);
+    }
+    cmor_unlock();
+    return (NULL);
+}
+
+/************************************************************************/
+/*                      cmor_start_write_threads()                      */
+/*                                                                      */
+/*      Called with cmor_write_mutex held on the first cmor_write();    */
+/*      starts at least nmin workers.                                   */
+/************************************************************************/
+int cmor_start_write_threads(int nmin)
+{
+    char value[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    int i, n;
+
+    cmor_add_traceback("cmor_start_write_threads");
+    n = 0;
+    if (cmor_has_cur_dataset_attribute(CMOR_WRITE_THREADS) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_WRITE_THREADS, value);
+        n = atoi(value);
+        if ((n < 0) || (n > CMOR_MAX_WRITE_THREADS)) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "%s must be between 0 and %i, you passed %s, "
+                     "using %i", CMOR_WRITE_THREADS,
+                     CMOR_MAX_WRITE_THREADS, value,
+                     (n < 0) ? 0 : CMOR_MAX_WRITE_THREADS);
+            cmor_handle_error(msg, CMOR_WARNING);
+            n = (n < 0) ? 0 : CMOR_MAX_WRITE_THREADS;
+        }
+    }
+    if (n < nmin)
+        n = nmin;
+
+    for (i = 0; i < n; i++) {
+        cmor_write_workers[i].first = NULL;
+        cmor_write_workers[i].last = NULL;
+        cmor_write_workers[i].njobs = 0;
+        cmor_write_workers[i].stop = 0;
+        pthread_cond_init(&cmor_write_workers[i].queued, NULL);
+        if (pthread_create(&cmor_write_workers[i].thread, NULL,
+                           cmor_write_worker, &cmor_write_workers[i]) != 0) {
+            pthread_cond_destroy(&cmor_write_workers[i].queued);
+            snprintf(msg, CMOR_MAX_STRING,
+                     "could not start write thread %i, writing with %i "
+                     "thread(s)", i, i);
+            cmor_handle_error(msg, CMOR_WARNING);
+            break;
+        }
+    }
+    cmor_nwrite_threads = i;
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_stop_write_threads()                      */
+/************************************************************************/
+void cmor_stop_write_threads(void)
+{
+    int i, n;
+
+    pthread_mutex_lock(&cmor_write_mutex);
+    n = cmor_nwrite_threads;
+    for (i = 0; i < n; i++) {
+        cmor_write_workers[i].stop = 1;
+        pthread_cond_signal(&cmor_write_workers[i].queued);
+    }
+    cmor_nwrite_threads = -1;
+    pthread_mutex_unlock(&cmor_write_mutex);
+
+    for (i = 0; i < n; i++) {
+        pthread_join(cmor_write_workers[i].thread, NULL);
+        pthread_cond_destroy(&cmor_write_workers[i].queued);
+    }
+}
+
+/************************************************************************/
+/*                          cmor_write_worker_of()                      */
+/************************************************************************/
+cmor_write_worker_t *cmor_write_worker_of(int ncid)
+{
+/* -------------------------------------------------------------------- */
+/*      netCDF ids carry the file in their high bits                    */
+/* -------------------------------------------------------------------- */
+    return (&cmor_write_workers[((unsigned int)ncid ^
+                                 ((unsigned int)ncid >> 16))
+                                % cmor_nwrite_threads]);
+}
+
+/************************************************************************/
+/*                          cmor_queue_write()                          */
+/*                                                                      */
+/*      Hands a converted slice to the worker of its file; data comes   */
+/*      from malloc (staging -1) and is freed by the worker, or is a    */
+/*      staging buffer of avar.  Called with cmor_write_mutex held.     */
+/************************************************************************/
+int cmor_queue_write(int ncid, cmor_var_t * avar, char mtype,
+                     size_t * starts, size_t * counts, void *data,
+                     int staging)
+{
+    cmor_write_worker_t *worker;
+    cmor_write_job_t *job;
+    char msg[CMOR_MAX_STRING];
+    int i;
+
+    cmor_add_traceback("cmor_queue_write");
+    job = malloc(sizeof(cmor_write_job_t));
+    if (job == NULL) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "cannot allocate memory to queue a write of variable %s",
+                 avar->id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_pop_traceback();
+        return (1);
+    }
+    job->ncid = ncid;
+    job->var_id = avar->self;
+    job->type = mtype;
+    for (i = 0; i < CMOR_MAX_DIMENSIONS; i++) {
+        job->starts[i] = starts[i];
+        job->counts[i] = counts[i];
+    }
+    job->data = data;
+    job->staging = staging;
+    job->next = NULL;
+    if (staging != -1)
+        avar->staging_busy[staging] = 1;
+
+    worker = cmor_write_worker_of(ncid);
+/* -------------------------------------------------------------------- */
+/*      bound the memory held by converted slices                       */
+/* -------------------------------------------------------------------- */
+    while (worker->njobs >= CMOR_MAX_QUEUED_WRITES)
+        pthread_cond_wait(&cmor_write_done, &cmor_write_mutex);
+
+    if (worker->last == NULL)
+        worker->first = job;
+    else
+        worker->last->next = job;
+    worker->last = job;
+    worker->njobs++;
+    pthread_cond_signal(&worker->queued);
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                          cmor_wait_writes()                          */
+/*                                                                      */
+/*      Waits until no slice of ncid is queued.  Called with            */
+/*      cmor_write_mutex held.                                          */
+/************************************************************************/
+void cmor_wait_writes(int ncid)
+{
+    cmor_write_worker_t *worker;
+    cmor_write_job_t *job;
+
+    if (cmor_nwrite_threads <= 0)
+        return;
+    worker = cmor_write_worker_of(ncid);
+    for (;;) {
+        for (job = worker->first; job != NULL; job = job->next)
+            if (job->ncid == ncid)
+                break;
+        if (job == NULL)
+            break;
+        pthread_cond_wait(&cmor_write_done, &cmor_write_mutex);
+    }
+}
+
 /************************************************************************/
 /*                             cmor_write()                             */
+/*                                                                      */
+/*      Safe to call from several threads for different variables.      */
+/*      The slice is in the file when it returns, after the slices      */
+/*      that cmor_write_async() queued before it.                       */
 /************************************************************************/
 int cmor_write(int var_id, void *data, char type, char *file_suffix,
                int ntimes_passed, double *time_vals, double *time_bounds,
                int *refvar)
 {
-    extern cmor_var_t cmor_vars[CMOR_MAX_VARIABLES];
-    extern cmor_axis_t cmor_axes[CMOR_MAX_AXES];
+    int ierr;
+
+    cmor_lock();
+    if (cmor_nwrite_threads < 0)
+        cmor_start_write_threads(0);
+    ierr = cmor_write_internal(var_id, data, type, file_suffix,
+                               ntimes_passed, time_vals, time_bounds, refvar);
+    cmor_unlock();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                          cmor_write_async()                          */
+/*                                                                      */
+/*      Like cmor_write() but makes sure a write worker runs, so it     */
+/*      returns once data has been converted into one of the            */
+/*      variable's two staging buffers.  data may be reused on return.  */
+/*      Use cmor_wait() or cmor_flush() to wait for the writes.         */
+/************************************************************************/
+int cmor_write_async(int var_id, void *data, char type, char *file_suffix,
+                     int ntimes_passed, double *time_vals,
+                     double *time_bounds, int *refvar)
+{
+    char msg[CMOR_MAX_STRING];
+    int ierr;
+
+    cmor_lock();
+    if (cmor_valid_var_id(var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to write variable id(%d) which was "
+                 "not initialized", var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_unlock();
+        return (-1);
+    }
+    if (cmor_nwrite_threads <= 0)
+        cmor_start_write_threads(1);
+    cmor_vars[var_id].async = 1;
+    ierr = cmor_write_internal(var_id, data, type, file_suffix,
+                               ntimes_passed, time_vals, time_bounds, refvar);
+    cmor_vars[var_id].async = 0;
+    cmor_unlock();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                          cmor_write_region()                         */
+/*                                                                      */
+/*      Writes a block of var_id: start and count give, in the order    */
+/*      of the axes passed to cmor_variable(), the first index and the  */
+/*      number of values of each axis held in data.  On the time axis   */
+/*      start must be the next time step, or one already written by    */
+/*      an earlier block, whose times are then not written again.      */
+/************************************************************************/
+int cmor_write_region(int var_id, void *data, char type, char *file_suffix,
+                      int *start, int *count, double *time_vals,
+                      double *time_bounds)
+{
+    cmor_var_t *avar;
+    cmor_axis_t *pAxis;
+    char msg[CMOR_MAX_STRING];
+    int i, j, ierr, ntimes_passed;
+
+    cmor_add_traceback("cmor_write_region");
+    cmor_lock();
+    if (cmor_valid_var_id(var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to write variable id(%d) which was "
+                 "not initialized", var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_unlock();
+        cmor_pop_traceback();
+        return (-1);
+    }
+    if (cmor_nwrite_threads < 0)
+        cmor_start_write_threads(0);
+
+    avar = &cmor_vars[var_id];
+    ntimes_passed = 0;
+    for (j = 0; j < avar->ndims; j++) {
+        for (i = 0; i < avar->ndims; i++)
+            if (avar->axes_ids[i] == avar->original_order[j])
+                break;
+        pAxis = &cmor_axes[avar->original_order[j]];
+
+        if (pAxis->axis == 'T') {
+            if ((start[j] < 0) || (count[j] < 1)
+                || (start[j] > avar->ntimes_written)
+                || ((start[j] < avar->ntimes_written)
+                    && (start[j] + count[j] > avar->ntimes_written))) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "variable %s (table: %s): cannot write time "
+                         "steps %i to %i, %i time steps were written",
+                         avar->id,
+                         cmor_tables[avar->ref_table_id].szTable_id,
+                         start[j], start[j] + count[j] - 1,
+                         avar->ntimes_written);
+                cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+                cmor_unlock();
+                cmor_pop_traceback();
+                return (1);
+            }
+            avar->region_start[i] = start[j];
+            avar->region_count[i] = count[j];
+            ntimes_passed = count[j];
+            continue;
+        }
+
+        if ((start[j] < 0) || (count[j] < 1)
+            || (start[j] + count[j] > pAxis->length)
+            || ((pAxis->offset != 0) && (count[j] != pAxis->length))) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "variable %s (table: %s): invalid block %i to %i "
+                     "for axis %s of length %i, an axis CMOR has to "
+                     "rotate can only be written whole",
+                     avar->id, cmor_tables[avar->ref_table_id].szTable_id,
+                     start[j], start[j] + count[j] - 1, pAxis->id,
+                     pAxis->length);
+            cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+            cmor_unlock();
+            cmor_pop_traceback();
+            return (1);
+        }
+/* -------------------------------------------------------------------- */
+/*      a reverted axis puts the block at the other end                 */
+/* -------------------------------------------------------------------- */
+        if (pAxis->revert == -1)
+            avar->region_start[i] = pAxis->length - start[j] - count[j];
+        else
+            avar->region_start[i] = start[j];
+        avar->region_count[i] = count[j];
+    }
+
+    avar->region = 1;
+    ierr = cmor_write_internal(var_id, data, type, file_suffix,
+                               ntimes_passed, time_vals, time_bounds, NULL);
+    cmor_vars[var_id].region = 0;
+
+    cmor_unlock();
+    cmor_pop_traceback();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                             cmor_wait()                              */
+/*                                                                      */
+/*      Waits until every slice of var_id's file has been written,      */
+/*      returns 1 if a write worker failed on var_id since the last     */
+/*      cmor_wait(), cmor_flush() or cmor_close_variable().             */
+/************************************************************************/
+int cmor_wait(int var_id)
+{
+    char msg[CMOR_MAX_STRING];
+    int ierr;
+
+    cmor_lock();
+    if (cmor_valid_var_id(var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to wait for variable id(%d) which was "
+                 "not initialized", var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_unlock();
+        return (-1);
+    }
+    if (cmor_vars[var_id].initialized != -1)
+        cmor_wait_writes(cmor_vars[var_id].initialized);
+    ierr = cmor_vars[var_id].write_error;
+    cmor_vars[var_id].write_error = 0;
+    cmor_unlock();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                             cmor_flush()                             */
+/*                                                                      */
+/*      Waits for every queued slice, then syncs the open files.        */
+/************************************************************************/
+int cmor_flush(void)
+{
+    extern int cmor_nvars;
+    char msg[CMOR_MAX_STRING];
+    int i, ierr, ret = 0;
+
+    cmor_add_traceback("cmor_flush");
+    cmor_lock();
+    for (i = 0; i < cmor_nwrite_threads; i++) {
+        while (cmor_write_workers[i].njobs > 0)
+            pthread_cond_wait(&cmor_write_done, &cmor_write_mutex);
+    }
+    for (i = 0; i < cmor_nvars + 1; i++) {
+        if (cmor_vars[i].write_error != 0) {
+            cmor_vars[i].write_error = 0;
+            ret = 1;
+        }
+        if ((cmor_vars[i].initialized == -1) || (cmor_vars[i].closed != 0)
+            || (cmor_vars[i].error != 0))
+            continue;
+        ierr = nc_sync(cmor_vars[i].initialized);
+        if (ierr != NC_NOERR) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "NetCDF Error (%i: %s) syncing variable %s",
+                     ierr, nc_strerror(ierr), cmor_vars[i].id);
+            cmor_handle_error_var(msg, CMOR_CRITICAL, i);
+            ret = 1;
+        }
+    }
+    cmor_unlock();
+    cmor_pop_traceback();
+    return (ret);
+}
+
+/************************************************************************/
+/*                         cmor_write_internal()                        */
+/************************************************************************/
+int cmor_write_internal(int var_id, void *data, char type, char *file_suffix,
+               int ntimes_passed, double *time_vals, double *time_bounds,
+               int *refvar)
+{
     extern int cmor_nvars;
     extern cmor_dataset_def cmor_current_dataset;
 
@@ -4270,20 +5337,20 @@ int cmor_write(int var_id, void *data, char type, char *file_suffix,
     char ctmp2[CMOR_MAX_STRING];
     char msg[CMOR_MAX_STRING];
     char appending_to[CMOR_MAX_STRING];
-    size_t nc_dim_chunking[CMOR_MAX_AXES];
-    int nc_vars[CMOR_MAX_VARIABLES];
-    int nc_vars_af[CMOR_MAX_VARIABLES];
+    size_t nc_dim_chunking[CMOR_MAX_DIMENSIONS];
+    int nc_vars[CMOR_MAX_DIMENSIONS + 1];       /* axes then the variable */
+    int nc_vars_af[CMOR_MAX_DIMENSIONS];
     int nc_dim_af[CMOR_MAX_DIMENSIONS];
     int nc_associated_vars[6];
-    int nc_bnds_vars[CMOR_MAX_VARIABLES];
+    int nc_bnds_vars[CMOR_MAX_DIMENSIONS];
     int dim_bnds;
     int nc_singletons[CMOR_MAX_DIMENSIONS];
     int nc_singletons_bnds[CMOR_MAX_DIMENSIONS];
     char mtype;
     int nzfactors = 0;
-    int nc_dim[CMOR_MAX_AXES];
-    int zfactors[CMOR_MAX_VARIABLES];
-    int nc_zfactors[CMOR_MAX_VARIABLES];
+    int nc_dim[CMOR_MAX_DIMENSIONS];
+    int zfactors[cmor_nvars + 1];       /* each variable at most once */
+    int nc_zfactors[cmor_nvars + 1];
     int refvarid;
 
     int nVarRefTblID;
@@ -4562,7 +5629,7 @@ int cmor_write(int var_id, void *data, char type, char *file_suffix,
             cmor_create_var_attributes(var_id, ncid, ncafid, nc_vars,
                     nc_bnds_vars, nc_vars_af, nc_associated_vars, nc_singletons,
                     nc_singletons_bnds, nc_zfactors, zfactors, nzfactors,
-                    nc_dim_chunking, outname);
+                    nc_dim_chunking, outname, ntimes_passed);
         }
 
     } else {
@@ -4573,23 +5640,14 @@ int cmor_write(int var_id, void *data, char type, char *file_suffix,
         ncid = cmor_vars[refvarid].initialized;
 
 /* -------------------------------------------------------------------- */
-/*      generates a new unique id                                       */
+/*      generates a new unique id, or when the tracking_id is only      */
+/*      generated once per file defer it to cmor_close_variable         */
 /* -------------------------------------------------------------------- */
-        cmor_generate_uuid();
-        cmor_get_cur_dataset_attribute(GLOBAL_ATT_TRACKING_ID, ctmp2);
-        ierr = nc_put_att_text(ncid, NC_GLOBAL, GLOBAL_ATT_TRACKING_ID,
-                               strlen(ctmp2), ctmp2);
-        if (ierr != NC_NOERR) {
-            snprintf(msg, CMOR_MAX_STRING,
-                     "NetCDF error (%i: %s) for variable %s (table: %s)\n! "
-                     "writing global attribute: %s (%s)",
-                     ierr, nc_strerror(ierr), cmor_vars[var_id].id,
-                     cmor_tables[nVarRefTblID].szTable_id,
-                     "tracking_id", (char *)ctmp2);
-            cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+        if (cmor_tracking_id_once() == 1) {
+            cmor_vars[refvarid].tracking_id_pending = 1;
+        } else if (cmor_put_tracking_id(refvarid, ncid) != 0) {
             cmor_pop_traceback();
             return (1);
-
         }
 
 /* -------------------------------------------------------------------- */
@@ -4631,10 +5689,10 @@ int cmor_write(int var_id, void *data, char type, char *file_suffix,
             }
         }
     }
-    cmor_write_var_to_file(ncid, &cmor_vars[var_id], data, type,
-                           ntimes_passed, time_vals, time_bounds);
+    ierr = cmor_write_var_to_file(ncid, &cmor_vars[var_id], data, type,
+                                  ntimes_passed, time_vals, time_bounds);
     cmor_pop_traceback();
-    return (0);
+    return (ierr);
 }
 
 /************************************************************************/
@@ -4645,7 +5703,8 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
                                 int *nc_vars_af, int *nc_associated_vars,
                                 int *nc_singletons, int *nc_singletons_bnds,
                                 int *nc_zfactors, int *zfactors, int nzfactors,
-                                size_t * nc_dim_chunking, char *outname)
+                                size_t * nc_dim_chunking, char *outname,
+                                int ntimes_passed)
 {
 
     size_t starts[2], counts[2];
@@ -4656,7 +5715,6 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
     int nelts;
     int *int_list = NULL;
     int ics, icd, icdl;
-    int bChunk;
     cmor_add_traceback("cmor_create_var_attributes");
 /* -------------------------------------------------------------------- */
 /*      Creates attributes related to that variable                     */
@@ -4742,6 +5800,42 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
             return;
 
         }
+        if (pVar->fletcher32 != 0) {
+            ierr = nc_def_var_fletcher32(ncid, pVar->nc_var_id, NC_FLETCHER32);
+            if (ierr != NC_NOERR) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "NetCDF Error (%i: %s) turning on fletcher32\n! "
+                         "checksums for variable '%s' (table: %s)", ierr,
+                         nc_strerror(ierr), cmor_vars[var_id].id,
+                         cmor_tables[nVarRefTblID].szTable_id);
+                cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+                cmor_pop_traceback();
+                return;
+            }
+        }
+/* -------------------------------------------------------------------- */
+/*      HDF5 filter plugin, only if this netCDF knows about filters     */
+/*      and the plugin is found at run time                             */
+/* -------------------------------------------------------------------- */
+        if (pVar->filter_id != 0) {
+#ifdef NC_EFILTER
+            ierr = nc_def_var_filter(ncid, pVar->nc_var_id, pVar->filter_id,
+                                     pVar->filter_nparams,
+                                     pVar->filter_params);
+#else
+            ierr = NC_ENOTNC4;
+#endif
+            if (ierr != NC_NOERR) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "NetCDF Error (%i: %s) adding HDF5 filter %u\n! "
+                         "to variable '%s' (table: %s), is the plugin\n! "
+                         "in HDF5_PLUGIN_PATH? Writing without it", ierr,
+                         nc_strerror(ierr), pVar->filter_id,
+                         cmor_vars[var_id].id,
+                         cmor_tables[nVarRefTblID].szTable_id);
+                cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+            }
+        }
 /* -------------------------------------------------------------------- */
 /*      Chunking stuff                                                  */
 /* -------------------------------------------------------------------- */
@@ -4749,19 +5843,13 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
 #ifndef NC_CHUNKED
 #define NC_CHUNKED 0
 #endif
-        size_t nc_dim_chunking[cmor_vars[var_id].ndims];
-        bChunk = cmor_set_chunking(var_id, nVarRefTblID, nc_dim_chunking);
-        if (bChunk != -1 && (!((cmor_vars[var_id].grid_id > -1)
-                               &&
-                               (cmor_grids
-                                [cmor_vars[var_id].grid_id].istimevarying ==
-                                1)))) {
+        if (cmor_vars[var_id].ndims > 0) {
             ierr =
               nc_def_var_chunking(ncid, cmor_vars[var_id].nc_var_id, NC_CHUNKED,
                                   &nc_dim_chunking[0]);
             if (ierr != NC_NOERR) {
                 snprintf(msg, CMOR_MAX_STRING,
-                         "NetCDFTestTables/CMIP6_chunking.json: Error (%i: %s) defining chunking\n! "
+                         "NetCDF Error (%i: %s) defining chunking\n! "
                          "parameters for variable '%s' (table: %s)",
                          ierr, nc_strerror(ierr), cmor_vars[var_id].id,
                          cmor_tables[nVarRefTblID].szTable_id);
@@ -4770,6 +5858,8 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
                 return;
 
             }
+            cmor_size_chunk_cache(var_id, ncid, nc_dim_chunking,
+                                  ntimes_passed);
         }
     }
 
@@ -4777,7 +5867,7 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
 /*      Done with NetCDF file definitions                               */
 /* -------------------------------------------------------------------- */
 
-    ierr = nc_enddef(ncid);
+    ierr = cmor_enddef(ncid);
     if (ierr != NC_NOERR && ierr != NC_ENOTINDEFINE) {
         snprintf(msg, CMOR_MAX_STRING,
                  "NetCDF Error (%i: %s) leaving definition mode for file %s",
@@ -4787,7 +5877,7 @@ void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
         return;
 
     }
-    ierr = nc_enddef(ncafid);
+    ierr = cmor_enddef(ncafid);
     if (ierr != NC_NOERR && ierr != NC_ENOTINDEFINE) {
         snprintf(msg, CMOR_MAX_STRING,
                  "NetCDF Error (%i: %s) leaving definition mode for metafile %s",
@@ -5889,12 +6979,39 @@ int cmor_build_outname(int var_id, char *outname ) {
     strncat(outname, ".nc", CMOR_MAX_STRING - strlen(outname));
     return(0);
 }
+/************************************************************************/
+/*                          cmor_valid_var_id()                         */
+/*                                                                      */
+/*      1 if var_id was returned by cmor_variable(), 0 otherwise.       */
+/************************************************************************/
+int cmor_valid_var_id(int var_id)
+{
+    extern int cmor_nvars;
+
+    return ((var_id >= 0) && (var_id <= cmor_nvars)
+            && (var_id < cmor_vars_allocated)
+            && (cmor_vars[var_id].self == var_id));
+}
+
 /************************************************************************/
 /*                        cmor_close_variable()                         */
 /************************************************************************/
 int cmor_close_variable(int var_id, char *file_name, int *preserve)
 {
     int ierr;
+
+    cmor_lock();
+    ierr = cmor_close_variable_internal(var_id, file_name, preserve);
+    cmor_unlock();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                    cmor_close_variable_internal()                    */
+/************************************************************************/
+int cmor_close_variable_internal(int var_id, char *file_name, int *preserve)
+{
+    int ierr, write_error = 0;
     extern int cmor_nvars;
     char outname[CMOR_MAX_STRING];
     char msg[CMOR_MAX_STRING];
@@ -5913,6 +7030,23 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
 /*  initialized contains ncic, so we close file only once.              */
 /* -------------------------------------------------------------------- */
     if (cmor_vars[var_id].initialized != -1 && cmor_vars[var_id].error == 0) {
+/* -------------------------------------------------------------------- */
+/*  let the write workers finish with this file                         */
+/* -------------------------------------------------------------------- */
+        cmor_wait_writes(cmor_vars[var_id].initialized);
+        write_error = cmor_vars[var_id].write_error;
+        cmor_vars[var_id].write_error = 0;
+        cmor_check_written(var_id);
+/* -------------------------------------------------------------------- */
+/*  finalize a tracking_id deferred by cmor_write                       */
+/* -------------------------------------------------------------------- */
+        if (cmor_vars[var_id].tracking_id_pending == 1) {
+            if (cmor_put_tracking_id(var_id,
+                                     cmor_vars[var_id].initialized) != 0) {
+                cmor_pop_traceback();
+                return (1);
+            }
+        }
         ierr = nc_close(cmor_vars[var_id].initialized);
 
         if (ierr != NC_NOERR) {
@@ -6071,6 +7205,13 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
         }
         strncpy(cmor_current_dataset.finalfilename, outname, CMOR_MAX_STRING);
 
+/* -------------------------------------------------------------------- */
+/*      checksum the file while it is still in the page cache           */
+/* -------------------------------------------------------------------- */
+        if (cmor_has_cur_dataset_attribute(CMOR_OUTPUT_CHECKSUM) == 0) {
+            cmor_write_checksum(var_id, outname);
+        }
+
 /* -------------------------------------------------------------------- */
 /*      At this point we need to check the file's size                  */
 /*      and issue a warning if greater than 4Gb                         */
@@ -6083,6 +7224,10 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
 //            cmor_handle_error_var(msg, CMOR_WARNING, var_id);
 //        }
 
+        cmor_free_units_cache(&cmor_vars[var_id]);
+        cmor_free_staging(&cmor_vars[var_id]);
+        cmor_free_written(&cmor_vars[var_id]);
+
         if (preserve != NULL) {
             cmor_vars[var_id].initialized = -1;
             cmor_vars[var_id].ntimes_written = 0;
@@ -6102,11 +7247,11 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
                     == 0) {
                     cmor_set_variable_attribute_internal(var_id, "cell_methods",
                                                          'c',
-                                                         cmor_tables[cmor_vars
-                                                                     [var_id].
-                                                                     ref_table_id].vars
-                                                         [cmor_vars[var_id].
-                                                          ref_var_id].
+                                                         cmor_get_var_def
+                                                         (cmor_vars[var_id].
+                                                          ref_table_id,
+                                                          cmor_vars[var_id].
+                                                          ref_var_id)->
                                                          cell_methods);
                 }
             }
@@ -6117,7 +7262,7 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
     }
     cleanup_varid = -1;
     cmor_pop_traceback();
-    return (0);
+    return (write_error);
 }
 
 /************************************************************************/
@@ -6125,7 +7270,7 @@ int cmor_close_variable(int var_id, char *file_name, int *preserve)
 /************************************************************************/
 int cmor_close(void)
 {
-    int i, j, k;
+    int i, j, k, ierr = 0;
     extern int cmor_nvars;
     char msg[CMOR_MAX_STRING];
     extern ut_system *ut_read;
@@ -6139,7 +7284,8 @@ int cmor_close(void)
     for (i = 0; i < cmor_nvars + 1; i++) {
         if (cmor_vars[i].initialized != -1 && cmor_vars[i].error == 0) {
             if (cmor_vars[i].closed == 0) {
-                cmor_close_variable(i, NULL, NULL);
+                if (cmor_close_variable(i, NULL, NULL) != 0)
+                    ierr = 1;
             }
         } else if ((cmor_vars[i].needsinit == 1)
                    && (cmor_vars[i].closed != 1)) {
@@ -6152,21 +7298,9 @@ int cmor_close(void)
             cmor_reset_variable(i);
         }
     }
-    for (i = 0; i < CMOR_MAX_TABLES; i++) {
-        for (j = 0; j < CMOR_MAX_ELEMENTS; j++) {
-            if (cmor_tables[i].axes[j].requested != NULL) {
-                free(cmor_tables[i].axes[j].requested);
-                cmor_tables[i].axes[j].requested = NULL;
-            }
-            if (cmor_tables[i].axes[j].requested_bounds != NULL) {
-                free(cmor_tables[i].axes[j].requested_bounds);
-                cmor_tables[i].axes[j].requested_bounds = NULL;
-            }
-            if (cmor_tables[i].axes[j].crequested != NULL) {
-                free(cmor_tables[i].axes[j].crequested);
-                cmor_tables[i].axes[j].crequested = NULL;
-            }
-        }
+    cmor_stop_write_threads();
+    for (i = 0; i < cmor_tables_allocated; i++) {
+        cmor_free_table_entries(&cmor_tables[i]);
         if (cmor_tables[i].nforcings > 0) {
             for (j = 0; j < cmor_tables[i].nforcings; j++) {
                 free(cmor_tables[i].forcings[j]);
@@ -6189,6 +7323,9 @@ int cmor_close(void)
         }
 
     }
+    cmor_free_companions();
+
+    cmor_free_interned_strings();
 
     for (i = 0; i < CMOR_MAX_GRIDS; i++) {
         if (cmor_grids[i].lons != NULL) {
@@ -6239,7 +7376,7 @@ int cmor_close(void)
         output_logfile = NULL;
     }
     cmor_pop_traceback();
-    return (0);
+    return (ierr);
 }
 
 /************************************************************************/
@@ -112,6 +112,9 @@ void cmor_CV_init(cmor_CV_def_t * CV, int table_id)
     CV->oValue = NULL;
     CV->aszValue = NULL;
     CV->anElements = -1;
+    CV->order = -1;
+    CV->order_last = -1;
+    CV->index = NULL;
 
     cmor_pop_traceback();
 }
@@ -176,7 +179,7 @@ void cmor_CV_printall()
 /* -------------------------------------------------------------------- */
 /* Parse tree and print key values.                                     */
 /* -------------------------------------------------------------------- */
-    for (i = 0; i < CMOR_MAX_TABLES; i++) {
+    for (i = 0; i < cmor_tables_allocated; i++) {
         if (cmor_tables[i].CV != NULL) {
             printf("table %s\n", cmor_tables[i].szTable_id);
             nCVs = cmor_tables[i].CV->nbObjects;
@@ -220,6 +223,194 @@ cmor_CV_def_t *cmor_CV_set_dataset_attr_from_key(cmor_CV_def_t * CV,
     return (NULL);
 }
 
+/************************************************************************/
+/*                       cmor_CV_count_nodes()                          */
+/************************************************************************/
+int cmor_CV_count_nodes(cmor_CV_def_t * CV)
+{
+    int i, n;
+
+    n = 1;
+    for (i = 0; i < CV->nbObjects; i++) {
+        n += cmor_CV_count_nodes(&CV->oValue[i]);
+    }
+    return (n);
+}
+
+/************************************************************************/
+/*                       cmor_CV_number_nodes()                         */
+/*                                                                      */
+/*      Numbers the subtree in the order cmor_CV_search_child_key()     */
+/*      used to visit it and stores its nodes from nodes[order] on.     */
+/************************************************************************/
+int cmor_CV_number_nodes(cmor_CV_def_t * CV, cmor_CV_def_t ** nodes,
+                         int order)
+{
+    int i;
+
+    CV->order = order;
+    nodes[order++] = CV;
+    for (i = 0; i < CV->nbObjects; i++) {
+        order = cmor_CV_number_nodes(&CV->oValue[i], nodes, order);
+    }
+    CV->order_last = order - 1;
+    return (order);
+}
+
+/************************************************************************/
+/*                       cmor_CV_compare_nodes()                        */
+/************************************************************************/
+int cmor_CV_compare_nodes(const void *a, const void *b)
+{
+    const cmor_CV_def_t *CV1 = *(cmor_CV_def_t * const *)a;
+    const cmor_CV_def_t *CV2 = *(cmor_CV_def_t * const *)b;
+    int rc;
+
+    rc = strcmp(CV1->key, CV2->key);
+    if (rc != 0)
+        return (rc);
+    return (CV1->order - CV2->order);
+}
+
+/************************************************************************/
+/*                        cmor_CV_free_index()                          */
+/************************************************************************/
+void cmor_CV_free_index(cmor_CV_index_t ** index)
+{
+    if (*index == NULL)
+        return;
+    free((*index)->nodes);
+    free((*index)->runs);
+    free((*index)->slots);
+    free((*index)->root_slots);
+    free(*index);
+    *index = NULL;
+}
+
+/************************************************************************/
+/*                        cmor_CV_build_index()                         */
+/************************************************************************/
+void cmor_CV_build_index(cmor_table_t * table)
+{
+    cmor_CV_index_t *index;
+    cmor_CV_def_t *CV = table->CV;
+    int i, j, k, n, nslots;
+
+    cmor_CV_free_index(&table->CV_index);
+    index = (cmor_CV_index_t *) calloc(1, sizeof(cmor_CV_index_t));
+    if (index == NULL) {
+        cmor_handle_error("cannot allocate CV index", CMOR_CRITICAL);
+        return;
+    }
+    table->CV_index = index;
+    index->root = CV;
+
+/* -------------------------------------------------------------------- */
+/*      CV[0] only holds the number of top level entries                */
+/* -------------------------------------------------------------------- */
+    n = 0;
+    for (i = 1; i < CV->nbObjects; i++) {
+        n += cmor_CV_count_nodes(&CV[i]);
+    }
+    index->nodes = (cmor_CV_def_t **) malloc((n + 1) *
+                                             sizeof(cmor_CV_def_t *));
+    index->runs = (int *)malloc((n + 1) * sizeof(int));
+    nslots = 16;
+    while (nslots < 2 * (n + 1))
+        nslots *= 2;
+    index->slots = (int *)calloc(nslots, sizeof(int));
+    if ((index->nodes == NULL) || (index->runs == NULL)
+        || (index->slots == NULL)) {
+        cmor_CV_free_index(&table->CV_index);
+        cmor_handle_error("cannot allocate CV index", CMOR_CRITICAL);
+        return;
+    }
+    index->nslots = nslots;
+    index->nnodes = n;
+
+    k = 0;
+    for (i = 1; i < CV->nbObjects; i++) {
+        k = cmor_CV_number_nodes(&CV[i], index->nodes, k);
+    }
+    CV->index = index;
+    for (i = 0; i < n; i++) {
+        index->nodes[i]->index = index;
+    }
+    qsort(index->nodes, n, sizeof(cmor_CV_def_t *), cmor_CV_compare_nodes);
+
+    for (i = 0; i < n; i = k) {
+        for (k = i + 1; k < n; k++) {
+            if (strcmp(index->nodes[k]->key, index->nodes[i]->key) != 0)
+                break;
+        }
+        index->runs[i] = k - i;
+        j = cmor_hash_string(index->nodes[i]->key) & (nslots - 1);
+        while (index->slots[j] != 0)
+            j = (j + 1) & (nslots - 1);
+        index->slots[j] = i + 1;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      top level keys, for cmor_CV_rootsearch()                        */
+/* -------------------------------------------------------------------- */
+    nslots = 16;
+    while (nslots < 2 * CV->nbObjects)
+        nslots *= 2;
+    index->root_slots = (int *)calloc(nslots, sizeof(int));
+    if (index->root_slots == NULL) {
+        cmor_CV_free_index(&table->CV_index);
+        cmor_handle_error("cannot allocate CV index", CMOR_CRITICAL);
+        return;
+    }
+    index->nroot_slots = nslots;
+    for (i = 1; i < CV->nbObjects; i++) {
+        j = cmor_hash_string(CV[i].key) & (nslots - 1);
+        while ((k = index->root_slots[j]) != 0) {
+            if (strcmp(CV[k - 1].key, CV[i].key) == 0)
+                break;
+            j = (j + 1) & (nslots - 1);
+        }
+        if (k == 0)
+            index->root_slots[j] = i + 1;
+    }
+}
+
+/************************************************************************/
+/*                        cmor_CV_search_index()                        */
+/*                                                                      */
+/*      First node named key whose order is within [first, last].       */
+/************************************************************************/
+cmor_CV_def_t *cmor_CV_search_index(cmor_CV_index_t * index, char *key,
+                                    int first, int last)
+{
+    int i, j, lo, hi, mid;
+
+    if ((index->slots == NULL) || (first > last))
+        return (NULL);
+
+    j = cmor_hash_string(key) & (index->nslots - 1);
+    while ((i = index->slots[j]) != 0) {
+        if (strcmp(index->nodes[i - 1]->key, key) == 0)
+            break;
+        j = (j + 1) & (index->nslots - 1);
+    }
+    if (i == 0)
+        return (NULL);
+
+    lo = i - 1;
+    hi = lo + index->runs[lo];
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (index->nodes[mid]->order < first)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ((lo == i - 1 + index->runs[i - 1]) || (index->nodes[lo]->order > last))
+        return (NULL);
+    return (index->nodes[lo]);
+}
+
 /************************************************************************/
 /*                  cmor_CV_search_child_key()                          */
 /************************************************************************/
@@ -227,28 +418,32 @@ cmor_CV_def_t *cmor_CV_search_child_key(cmor_CV_def_t * CV, char *key)
 {
     int i;
     cmor_CV_def_t *searchCV;
+    cmor_CV_index_t *index;
     int nbCVs = -1;
-    cmor_add_traceback("_CV_search_child_key");
 
     nbCVs = CV->nbObjects;
 
     // Look at this objects
     if (strcmp(CV->key, key) == 0) {
-        cmor_pop_traceback();
         return (CV);
     }
+    // Indexed tree, look below this object in one go
+    index = CV->index;
+    if ((CV->order >= 0) && (index != NULL) && (index->slots != NULL)
+        && (CV->order_last < index->nnodes)) {
+        return (cmor_CV_search_index(index, key, CV->order + 1,
+                                     CV->order_last));
+    }
     // Look at each of object key
     for (i = 0; i < nbCVs; i++) {
         // Is there a branch on that object?
         if (&CV->oValue[i] != NULL) {
             searchCV = cmor_CV_search_child_key(&CV->oValue[i], key);
             if (searchCV != NULL) {
-                cmor_pop_traceback();
                 return (searchCV);
             }
         }
     }
-    cmor_pop_traceback();
     return (NULL);
 }
 
@@ -257,15 +452,25 @@ cmor_CV_def_t *cmor_CV_search_child_key(cmor_CV_def_t * CV, char *key)
 /************************************************************************/
 cmor_CV_def_t *cmor_CV_rootsearch(cmor_CV_def_t * CV, char *key)
 {
-    int i;
+    int i, j;
     int nbCVs = -1;
-    cmor_add_traceback("_CV_rootsearch");
+    cmor_CV_index_t *index;
 
     // Look at first objects
     if (strcmp(CV->key, key) == 0) {
-        cmor_pop_traceback();
         return (CV);
     }
+    // Use the index if CV is the root of an indexed tree
+    index = CV->index;
+    if ((index != NULL) && (index->root_slots != NULL) && (CV == index->root)) {
+        j = cmor_hash_string(key) & (index->nroot_slots - 1);
+        while ((i = index->root_slots[j]) != 0) {
+            if (strcmp(CV[i - 1].key, key) == 0)
+                return (&CV[i - 1]);
+            j = (j + 1) & (index->nroot_slots - 1);
+        }
+        return (NULL);
+    }
     // Is there more than 1 object?
     if (CV->nbObjects != -1) {
         nbCVs = CV->nbObjects;
@@ -273,11 +478,9 @@ cmor_CV_def_t *cmor_CV_rootsearch(cmor_CV_def_t * CV, char *key)
     // Look at each of object key
     for (i = 1; i < nbCVs; i++) {
         if (strcmp(CV[i].key, key) == 0) {
-            cmor_pop_traceback();
             return (&CV[i]);
         }
     }
-    cmor_pop_traceback();
     return (NULL);
 }
 
@@ -1501,7 +1704,7 @@ int cmor_CV_checkFilename(cmor_CV_def_t * CV, int var_id,
     timeDim = -1;
     for (i = 0; i < cmor_tables[0].vars[0].ndims; i++) {
         int dim = cmor_tables[0].vars[0].dimensions[i];
-        if (cmor_tables[0].axes[dim].axis == 'T') {
+        if (cmor_get_axis_def(0, dim)->axis == 'T') {
             timeDim = dim;
             break;
         }
@@ -2195,6 +2398,14 @@ int cmor_CV_set_entry(cmor_table_t * table, json_object * value)
 
     cmor_add_traceback("_CV_set_entry");
 /* -------------------------------------------------------------------- */
+/* a CV shared with other tables is not ours to grow                    */
+/* -------------------------------------------------------------------- */
+    if (cmor_table->CV_shared == 1) {
+        cmor_table->CV_index = NULL;
+        cmor_table->CV = NULL;
+        cmor_table->CV_shared = 0;
+    }
+/* -------------------------------------------------------------------- */
 /* CV 0 contains number of objects                                      */
 /* -------------------------------------------------------------------- */
     nbObjects++;
@@ -2236,10 +2447,363 @@ int cmor_CV_set_entry(cmor_table_t * table, json_object * value)
     }
     CV = &cmor_table->CV[0];
     CV->nbObjects = nbObjects;
+    cmor_CV_build_index(cmor_table);
     cmor_pop_traceback();
     return (0);
 }
 
+/************************************************************************/
+/*                        cmor_CV_stream_att()                          */
+/*                                                                      */
+/*      Same as cmor_CV_set_att() for the JSON text at szValue, which   */
+/*      ends at szEnd.  Objects are walked in place and only the other  */
+/*      values are parsed by json-c.  Returns -1 on a syntax error.     */
+/************************************************************************/
+int cmor_CV_stream_att(cmor_CV_def_t * CV, char *szKey, json_tokener * tok,
+                       char *szValue, char *szEnd)
+{
+    json_object *joValue;
+    char key[CMOR_MAX_STRING];
+    char *cursor, *value;
+    cmor_CV_def_t *oValue;
+    int k, n, ierr;
+
+    if (*szValue != '{') {
+        joValue = cmor_json_parse_value(tok, szValue, szEnd, &ierr);
+        if (ierr != 0) {
+            return (-1);
+        }
+        cmor_CV_set_att(CV, szKey, joValue);
+        json_object_put(joValue);
+        return (0);
+    }
+
+    strcpy(CV->key, szKey);
+    CV->nbObjects = 0;
+    CV->type = CV_object;
+    cursor = szValue;
+    n = 0;
+    while ((ierr = cmor_json_next_member(&cursor, &n, key, &value)) == 1) {
+/* -------------------------------------------------------------------- */
+/*      a repeated key replaces the earlier value, as in json-c         */
+/* -------------------------------------------------------------------- */
+        for (k = 0; k < CV->nbObjects; k++) {
+            if (strcmp(CV->oValue[k].key, key) == 0) {
+                break;
+            }
+        }
+        if (k < CV->nbObjects) {
+            cmor_CV_free(&CV->oValue[k]);
+        } else {
+            oValue = (cmor_CV_def_t *) realloc(CV->oValue,
+                                               sizeof(cmor_CV_def_t) * (k + 1));
+            if (oValue == NULL) {
+                return (-1);
+            }
+            CV->oValue = oValue;
+            CV->nbObjects = k + 1;
+        }
+        cmor_CV_init(&CV->oValue[k], CV->table_id);
+        if (cmor_CV_stream_att(&CV->oValue[k], key, tok, value,
+                               cursor) != 0) {
+            return (-1);
+        }
+    }
+    return (ierr);
+}
+
+/************************************************************************/
+/*                       cmor_CV_stream_entry()                         */
+/*                                                                      */
+/*      Same as cmor_CV_set_entry() for the JSON text of the CV         */
+/*      section, without building its json-c tree.                      */
+/************************************************************************/
+int cmor_CV_stream_entry(cmor_table_t * table, json_tokener * tok,
+                         char *szValue)
+{
+    extern int cmor_ntables;
+    char CVName[CMOR_MAX_STRING];
+    char *cursor, *CVValue;
+    cmor_CV_def_t *CV;
+    cmor_CV_def_t *newCV;
+    cmor_table_t *cmor_table;
+    int k, n, nbObjects, ierr;
+    cmor_table = &cmor_tables[cmor_ntables];
+
+    cmor_is_setup();
+
+    cmor_add_traceback("cmor_CV_stream_entry");
+    if (cmor_table->CV_shared == 1) {
+        cmor_table->CV_index = NULL;
+        cmor_table->CV = NULL;
+        cmor_table->CV_shared = 0;
+    }
+    newCV = (cmor_CV_def_t *) realloc(cmor_table->CV, sizeof(cmor_CV_def_t));
+    cmor_table->CV = newCV;
+    cmor_CV_init(cmor_table->CV, cmor_ntables);
+    cmor_table->CV->nbObjects = 1;
+
+    cursor = szValue;
+    n = 0;
+    while ((ierr = cmor_json_next_member(&cursor, &n, CVName, &CVValue)) == 1) {
+        nbObjects = cmor_table->CV->nbObjects;
+        for (k = 1; k < nbObjects; k++) {
+            if ((CVName[0] != '#')
+                && (strcmp(cmor_table->CV[k].key, CVName) == 0)) {
+                break;
+            }
+        }
+        if (k < nbObjects) {
+            cmor_CV_free(&cmor_table->CV[k]);
+        } else {
+            newCV = (cmor_CV_def_t *) realloc(cmor_table->CV,
+                                              (k + 1) *
+                                              sizeof(cmor_CV_def_t));
+            if (newCV == NULL) {
+                ierr = -1;
+                break;
+            }
+            cmor_table->CV = newCV;
+            cmor_table->CV->nbObjects++;
+        }
+        CV = &cmor_table->CV[k];
+        cmor_CV_init(CV, cmor_ntables);
+
+        if (CVName[0] == '#') {
+            continue;
+        }
+        ierr = cmor_CV_stream_att(CV, CVName, tok, CVValue, cursor);
+        if (ierr != 0) {
+            break;
+        }
+    }
+    if (ierr == 0) {
+        cmor_CV_build_index(cmor_table);
+    }
+    cmor_pop_traceback();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                        cmor_CV_write_cache()                         */
+/*                                                                      */
+/*      Appends a CV node and its subtree to a table cache.             */
+/************************************************************************/
+void cmor_CV_write_cache(cmor_table_cache_builder_t * cache,
+                         cmor_CV_def_t * CV)
+{
+    cmor_table_cache_record_t *record;
+    int i;
+
+    record = cmor_table_cache_add(cache, CACHE_CV_NODE, CV->key,
+                                  CV->szValue);
+    if (record == NULL) {
+        return;
+    }
+    record->type = CV->type;
+    record->nobjects = CV->nbObjects;
+    record->nitems = CV->anElements;
+    record->nValue = CV->nValue;
+    record->dValue = CV->dValue;
+    for (i = 0; i < CV->anElements; i++) {
+        cmor_table_cache_add(cache, CACHE_CV_ITEM, "", CV->aszValue[i]);
+    }
+    if (CV->oValue != NULL) {
+        for (i = 0; i < CV->nbObjects; i++) {
+            cmor_CV_write_cache(cache, &CV->oValue[i]);
+        }
+    }
+}
+
+/************************************************************************/
+/*                      cmor_CV_write_cache_root()                      */
+/************************************************************************/
+void cmor_CV_write_cache_root(cmor_table_cache_builder_t * cache,
+                              cmor_CV_def_t * CV)
+{
+    cmor_table_cache_record_t *record;
+    int i;
+
+    record = cmor_table_cache_add(cache, CACHE_CV_ROOT, "", "");
+    if (record == NULL) {
+        return;
+    }
+    record->nobjects = CV->nbObjects;
+    for (i = 1; i < CV->nbObjects; i++) {
+        cmor_CV_write_cache(cache, &CV[i]);
+    }
+}
+
+/************************************************************************/
+/*                        cmor_CV_check_cache()                         */
+/*                                                                      */
+/*      Walks the CACHE_CV_ROOT record at records[i] and the node       */
+/*      trees following it without building them, and returns the       */
+/*      record after the last one, -1 if the counts they hold do not    */
+/*      fit in the nrecords records.                                    */
+/************************************************************************/
+int cmor_CV_check_cache(cmor_table_cache_record_t * records, int nrecords,
+                        int i)
+{
+    cmor_table_cache_record_t *record;
+    long pending;
+    int k;
+
+    if ((i >= nrecords) || (records[i].kind != CACHE_CV_ROOT)
+        || (records[i].nobjects < 1)
+        || (records[i].nobjects > nrecords - i)) {
+        return (-1);
+    }
+/* -------------------------------------------------------------------- */
+/*      nodes are written depth first, so counting the nodes still      */
+/*      expected is enough to find where the trees end                  */
+/* -------------------------------------------------------------------- */
+    pending = records[i++].nobjects - 1;
+    while (pending > 0) {
+        if ((i >= nrecords) || (records[i].kind != CACHE_CV_NODE)) {
+            return (-1);
+        }
+        record = &records[i++];
+        if (record->nitems > nrecords - i) {
+            return (-1);
+        }
+        for (k = 0; k < record->nitems; k++) {
+            if (records[i++].kind != CACHE_CV_ITEM) {
+                return (-1);
+            }
+        }
+        if ((record->type == CV_object) && (record->nobjects > 0)) {
+            if (record->nobjects > nrecords - i) {
+                return (-1);
+            }
+            pending += record->nobjects;
+        }
+        pending--;
+    }
+    return (i);
+}
+
+/************************************************************************/
+/*                        cmor_CV_read_cache()                          */
+/*                                                                      */
+/*      Rebuilds the node written at records[i] and its subtree, and    */
+/*      returns the record following it, -1 if the cache is corrupt.   */
+/************************************************************************/
+int cmor_CV_read_cache(cmor_CV_def_t * CV, cmor_table_cache_record_t * records,
+                       int nrecords, int i, char *strings)
+{
+    cmor_table_cache_record_t *record;
+    int k;
+
+    if ((i >= nrecords) || (records[i].kind != CACHE_CV_NODE)) {
+        return (-1);
+    }
+    record = &records[i++];
+    strncpy(CV->key, cmor_table_cache_string(strings, record->name),
+            CMOR_MAX_STRING);
+    strncpy(CV->szValue, cmor_table_cache_string(strings, record->value),
+            CMOR_MAX_STRING);
+    CV->type = record->type;
+    CV->nValue = record->nValue;
+    CV->dValue = record->dValue;
+
+    if (record->nitems > nrecords - i) {
+        return (-1);
+    }
+    if (record->nitems > 0) {
+        CV->aszValue = (char **)malloc(record->nitems * sizeof(char *));
+        if (CV->aszValue == NULL) {
+            return (-1);
+        }
+        CV->anElements = 0;
+        for (k = 0; k < record->nitems; k++) {
+            if (records[i].kind != CACHE_CV_ITEM) {
+                return (-1);
+            }
+            CV->aszValue[k] = (char *)malloc(sizeof(char) * CMOR_MAX_STRING);
+            if (CV->aszValue[k] == NULL) {
+                return (-1);
+            }
+            CV->anElements++;
+            strncpy(CV->aszValue[k],
+                    cmor_table_cache_string(strings, records[i].value),
+                    CMOR_MAX_STRING);
+            i++;
+        }
+    }
+
+    CV->nbObjects = record->nobjects;
+    if ((record->type == CV_object) && (record->nobjects > 0)) {
+        if (record->nobjects > nrecords - i) {
+            return (-1);
+        }
+        CV->oValue = (cmor_CV_def_t *) malloc(record->nobjects *
+                                              sizeof(cmor_CV_def_t));
+        if (CV->oValue == NULL) {
+            return (-1);
+        }
+        for (k = 0; k < record->nobjects; k++) {
+            cmor_CV_init(&CV->oValue[k], CV->table_id);
+        }
+        for (k = 0; k < record->nobjects; k++) {
+            i = cmor_CV_read_cache(&CV->oValue[k], records, nrecords, i,
+                                   strings);
+            if (i < 0) {
+                return (-1);
+            }
+        }
+    }
+    return (i);
+}
+
+/************************************************************************/
+/*                      cmor_CV_read_cache_root()                       */
+/*                                                                      */
+/*      Same as cmor_CV_set_entry() from the CACHE_CV_ROOT record at    */
+/*      records[i].                                                     */
+/************************************************************************/
+int cmor_CV_read_cache_root(cmor_table_cache_record_t * records,
+                            int nrecords, int i, char *strings)
+{
+    extern int cmor_ntables;
+    int k, nbObjects;
+    cmor_CV_def_t *newCV;
+    cmor_table_t *cmor_table;
+    cmor_table = &cmor_tables[cmor_ntables];
+
+    cmor_add_traceback("cmor_CV_read_cache_root");
+    if (cmor_table->CV_shared == 1) {
+        cmor_table->CV_index = NULL;
+        cmor_table->CV = NULL;
+        cmor_table->CV_shared = 0;
+    }
+    nbObjects = records[i++].nobjects;
+    if ((nbObjects < 1) || (nbObjects > nrecords - i + 1)) {
+        cmor_pop_traceback();
+        return (-1);
+    }
+    newCV = (cmor_CV_def_t *) realloc(cmor_table->CV,
+                                      nbObjects * sizeof(cmor_CV_def_t));
+    if (newCV == NULL) {
+        cmor_pop_traceback();
+        return (-1);
+    }
+    cmor_table->CV = newCV;
+    for (k = 0; k < nbObjects; k++) {
+        cmor_CV_init(&cmor_table->CV[k], cmor_ntables);
+    }
+    cmor_table->CV->nbObjects = nbObjects;
+    for (k = 1; (k < nbObjects) && (i >= 0); k++) {
+        i = cmor_CV_read_cache(&cmor_table->CV[k], records, nrecords, i,
+                               strings);
+    }
+    if (i >= 0) {
+        cmor_CV_build_index(cmor_table);
+    }
+    cmor_pop_traceback();
+    return (i);
+}
+
 /************************************************************************/
 /*                       cmor_CV_checkTime()                            */
 /************************************************************************/
@@ -2304,25 +2868,14 @@ int cmor_CV_variable(int *var_id, char *name, char *units, float *missing,
 /*      ok now look which variable is corresponding in table if not     */
 /*      found then error                                                */
 /* -------------------------------------------------------------------- */
-    iref = -1;
     cmor_trim_string(name, ctmp);
-    for (i = 0; i < cmor_tables[CMOR_TABLE].nvars + 1; i++) {
-        if (strcmp(cmor_tables[CMOR_TABLE].vars[i].id, ctmp) == 0) {
-            iref = i;
-            break;
-        }
-    }
+    iref = cmor_get_table_var_id(CMOR_TABLE, ctmp);
 /* -------------------------------------------------------------------- */
 /*      ok now look for out_name to see if we can it.                   */
 /* -------------------------------------------------------------------- */
 
     if (iref == -1) {
-        for (i = 0; i < cmor_tables[CMOR_TABLE].nvars + 1; i++) {
-            if (strcmp(cmor_tables[CMOR_TABLE].vars[i].out_name, ctmp) == 0) {
-                iref = i;
-                break;
-            }
-        }
+        iref = cmor_get_table_out_name_id(CMOR_TABLE, ctmp);
     }
 
     if (iref == -1) {
@@ -2332,7 +2885,7 @@ int cmor_CV_variable(int *var_id, char *name, char *units, float *missing,
     }
 
     refvar = cmor_tables[CMOR_TABLE].vars[iref];
-    for (i = 0; i < CMOR_MAX_VARIABLES; i++) {
+    for (i = 0; i < cmor_vars_allocated; i++) {
         if(cmor_vars[i].ref_table_id == CMOR_TABLE) {
             if (refvar.out_name[0] == '\0') {
                 if(strncmp(cmor_vars[i].id, name, CMOR_MAX_STRING) == 0) {
@@ -2349,11 +2902,10 @@ int cmor_CV_variable(int *var_id, char *name, char *units, float *missing,
     }
 
 
-    for (i = 0; i < CMOR_MAX_VARIABLES; i++) {
-        if (cmor_vars[i].self == -1) {
-            vrid = i;
-            break;
-        }
+    vrid = cmor_get_free_variable();
+    if (vrid == -1) {
+        cmor_pop_traceback();
+        return (1);
     }
 
     cmor_vars[vrid].ref_table_id = CMOR_TABLE;
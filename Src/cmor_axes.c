@@ -287,7 +287,6 @@ int cmor_convert_time_values(void *values_in, char type, int nvalues,
 int cmor_set_axis_attribute(int id, char *attribute_name, char type,
                             void *value)
 {
-    extern cmor_axis_t cmor_axes[];
     char msg[CMOR_MAX_STRING];
     int i, index;
 
@@ -307,18 +306,20 @@ int cmor_set_axis_attribute(int id, char *attribute_name, char type,
     if (index == -1) {
         index = cmor_axes[id].nattributes;
         cmor_axes[id].nattributes += 1;
+        cmor_axes[id].attributes_values_char[index] = cmor_intern("");
     }
 /* --------------------------------------------------------------------- */
 /*      store the name                                                   */
 /* --------------------------------------------------------------------- */
 
-    strncpy(cmor_axes[id].attributes[index], msg, CMOR_MAX_STRING);
+    cmor_axes[id].attributes[index] = cmor_intern(msg);
 
     cmor_axes[id].attributes_type[index] = type;
     if (type == 'c') {
-        if (strlen(value) > 0)
-            strncpytrim(cmor_axes[id].attributes_values_char[index],
-                        value, CMOR_MAX_STRING);
+        if (strlen(value) > 0) {
+            strncpytrim(msg, value, CMOR_MAX_STRING);
+            cmor_axes[id].attributes_values_char[index] = cmor_intern(msg);
+        }
     } else if (type == 'f')
         cmor_axes[id].attributes_values_num[index] = (double)*(float *)value;
     else if (type == 'i')
@@ -349,7 +350,6 @@ int cmor_set_axis_attribute(int id, char *attribute_name, char type,
 int cmor_get_axis_attribute(int id, char *attribute_name, char type,
                             void *value)
 {
-    extern cmor_axis_t cmor_axes[];
     char msg[CMOR_MAX_STRING];
     int i, index;
 
@@ -391,7 +391,6 @@ int cmor_get_axis_attribute(int id, char *attribute_name, char type,
 /************************************************************************/
 int cmor_has_axis_attribute(int id, char *attribute_name)
 {
-    extern cmor_axis_t cmor_axes[];
     int i, index;
 
     cmor_add_traceback("cmor_has_axis_attribute");
@@ -1616,9 +1615,10 @@ int cmor_check_interval(int axis_id, char *interval, double *values,
 /************************************************************************/
 /*                             cmor_axis()                              */
 /************************************************************************/
-int cmor_axis(int *axis_id, char *name, char *units, int length,
-              void *coord_vals, char type, void *cell_bounds,
-              int cell_bounds_ndim, char *interval)
+static int cmor_axis_internal(int *axis_id, char *name, char *units,
+                              int length, void *coord_vals, char type,
+                              void *cell_bounds, int cell_bounds_ndim,
+                              char *interval)
 {
     extern int cmor_naxes;
     extern int CMOR_TABLE;
@@ -1636,8 +1636,7 @@ int cmor_axis(int *axis_id, char *name, char *units, int length,
         cmor_handle_error("You did not define a table yet!", CMOR_CRITICAL);
     }
 
-    if (cmor_naxes == CMOR_MAX_AXES - 1) {
-        cmor_handle_error("Too many axes defined", CMOR_CRITICAL);
+    if (cmor_reserve_axis(cmor_naxes + 1) != 0) {
         cmor_pop_traceback();
         return (1);
     }
@@ -1648,15 +1647,8 @@ int cmor_axis(int *axis_id, char *name, char *units, int length,
 /*        ok now look which axis is corresponding in                    */
 /*        table if not found then error                                 */
 /* -------------------------------------------------------------------- */
-    iref = -1;
     cmor_trim_string(name, msg);
-
-    for (i = 0; i <= cmor_tables[CMOR_TABLE].naxes; i++) {
-        if (strcmp(cmor_tables[CMOR_TABLE].axes[i].id, msg) == 0) {
-            iref = i;
-            break;
-        }
-    }
+    iref = cmor_get_table_axis_id(CMOR_TABLE, msg);
 
     if (iref == -1) {
         snprintf(ctmp, CMOR_MAX_STRING,
@@ -2118,6 +2110,22 @@ int cmor_axis(int *axis_id, char *name, char *units, int length,
     return (0);
 }
 
+/************************************************************************/
+/*                             cmor_axis()                              */
+/************************************************************************/
+int cmor_axis(int *axis_id, char *name, char *units, int length,
+              void *coord_vals, char type, void *cell_bounds,
+              int cell_bounds_ndim, char *interval)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_axis_internal(axis_id, name, units, length, coord_vals, type,
+                              cell_bounds, cell_bounds_ndim, interval);
+    cmor_unlock();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                       cmor_init_axis_def()                           */
 /************************************************************************/
@@ -2126,12 +2134,14 @@ void cmor_init_axis_def(cmor_axis_def_t * axis, int table_id)
     cmor_is_setup();
     axis->table_id = table_id;
     axis->climatology = 0;
-    axis->standard_name[0] = '\0';
-    axis->units[0] = '\0';
+    axis->id = cmor_intern("");
+    axis->required = cmor_intern("");
+    axis->standard_name = cmor_intern("");
+    axis->units = cmor_intern("");
     axis->axis = '\0';
     axis->positive = '\0';
-    axis->long_name[0] = '\0';
-    axis->out_name[0] = '\0';
+    axis->long_name = cmor_intern("");
+    axis->out_name = cmor_intern("");
     axis->type = 'd';
     axis->stored_direction = 'i';
     axis->valid_min = 1.e20;    /* means no check */
@@ -2144,17 +2154,17 @@ void cmor_init_axis_def(cmor_axis_def_t * axis, int table_id)
     axis->requested_bounds = NULL;
     axis->tolerance = 1.e-3;
     axis->value = 1.e20;
-    axis->cvalue[0] = '\0';
+    axis->cvalue = cmor_intern("");
     axis->bounds_value[0] = 1.e20;
     axis->bounds_value[1] = 1.e20;
-    axis->convert_to[0] = '\0';
-    axis->formula[0] = '\0';
-    axis->z_factors[0] = '\0';
-    axis->z_bounds_factors[0] = '\0';
+    axis->convert_to = cmor_intern("");
+    axis->formula = cmor_intern("");
+    axis->z_factors = cmor_intern("");
+    axis->z_bounds_factors = cmor_intern("");
     if (axis->crequested != NULL)
         free(axis->requested);
     axis->crequested = NULL;
-    axis->cname[0] = '\0';
+    axis->cname = cmor_intern("");
     if (axis->requested_bounds != NULL)
         free(axis->requested_bounds);
     axis->requested = NULL;
@@ -2189,11 +2199,11 @@ int cmor_set_axis_def_att(cmor_axis_def_t * axis, char att[CMOR_MAX_STRING],
     }
     if (strcmp(att, AXIS_ATT_REQUIRED) == 0) {
 
-        strcpy(axis->required, att);
+        axis->required = cmor_intern(att);
 
     } else if (strcmp(att, AXIS_ATT_ID) == 0) {
 
-        strcpy(axis->id, val);
+        axis->id = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_CLIMATOLOGY) == 0) {
 
@@ -2203,35 +2213,35 @@ int cmor_set_axis_def_att(cmor_axis_def_t * axis, char att[CMOR_MAX_STRING],
 
     } else if (strcmp(att, AXIS_ATT_OUTNAME) == 0) {
 
-        strcpy(axis->out_name, val);
+        axis->out_name = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_STANDARDNAME) == 0) {
 
-        strcpy(axis->standard_name, val);
+        axis->standard_name = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_LONGNAME) == 0) {
 
-        strcpy(axis->long_name, val);
+        axis->long_name = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_CONVERTTO) == 0) {
 
-        strcpy(axis->convert_to, val);
+        axis->convert_to = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_FORMULA) == 0) {
 
-        strcpy(axis->formula, val);
+        axis->formula = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_ZFACTORS) == 0) {
 
-        strcpy(axis->z_factors, val);
+        axis->z_factors = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_ZBOUNDSFACTORS) == 0) {
 
-        strcpy(axis->z_bounds_factors, val);
+        axis->z_bounds_factors = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_UNITS) == 0) {
 
-        strncpy(axis->units, val, CMOR_MAX_STRING);
+        axis->units = cmor_intern(val);
 
     } else if (strcmp(att, AXIS_ATT_STOREDDIRECTION) == 0) {
 
@@ -2294,7 +2304,8 @@ int cmor_set_axis_def_att(cmor_axis_def_t * axis, char att[CMOR_MAX_STRING],
 
     } else if (strcmp(att, AXIS_ATT_VALUE) == 0) {
 
-        strncpytrim(axis->cvalue, val, CMOR_MAX_STRING);
+        strncpytrim(dim, val, CMOR_MAX_STRING);
+        axis->cvalue = cmor_intern(dim);
         axis->value = atof(val);
 
     } else if (strcmp(att, AXIS_ATT_BOUNDVALUES) == 0) {
@@ -2303,7 +2314,8 @@ int cmor_set_axis_def_att(cmor_axis_def_t * axis, char att[CMOR_MAX_STRING],
 
     } else if (strcmp(att, AXIS_ATT_COORDSATTRIB) == 0) {
 
-        strncpytrim(axis->cname, val, CMOR_MAX_STRING);
+        strncpytrim(dim, val, CMOR_MAX_STRING);
+        axis->cname = cmor_intern(dim);
 
     } else if ((strcmp(att, AXIS_ATT_BOUNDSREQUESTED) == 0)
                || (strcmp(att, AXIS_ATT_REQUESTEDBOUNDS) == 0)) {
@@ -510,11 +510,12 @@ void cmor_set_mapping_attribute(cmor_mappings_t * mapping,
 /*                       cmor_set_grid_mapping()                        */
 /************************************************************************/
 
-int cmor_set_grid_mapping(int gid, char *name, int nparam,
-                          char *attributes_names, int lparams,
-                          double
-                          attributes_values[CMOR_MAX_GRID_ATTRIBUTES],
-                          char *units, int lnunits)
+static int cmor_set_grid_mapping_internal(int gid, char *name, int nparam,
+                                          char *attributes_names, int lparams,
+                                          double
+                                          attributes_values
+                                          [CMOR_MAX_GRID_ATTRIBUTES],
+                                          char *units, int lnunits)
 {
     int grid_id, nattributes, ndims;
     int i, j, k, l;
@@ -660,13 +661,35 @@ int cmor_set_grid_mapping(int gid, char *name, int nparam,
     return (0);
 }
 
+/************************************************************************/
+/*                       cmor_set_grid_mapping()                        */
+/************************************************************************/
+int cmor_set_grid_mapping(int gid, char *name, int nparam,
+                          char *attributes_names, int lparams,
+                          double
+                          attributes_values[CMOR_MAX_GRID_ATTRIBUTES],
+                          char *units, int lnunits)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_set_grid_mapping_internal(gid, name, nparam, attributes_names,
+                                          lparams, attributes_values, units,
+                                          lnunits);
+    cmor_unlock();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                 cmor_time_varying_grid_coordinate()                  */
 /************************************************************************/
 
-int cmor_time_varying_grid_coordinate(int *coord_grid_id, int grid_id,
-                                      char *table_entry, char *units, char type,
-                                      void *missing, int *coordinate_type)
+static int cmor_time_varying_grid_coordinate_internal(int *coord_grid_id,
+                                                      int grid_id,
+                                                      char *table_entry,
+                                                      char *units, char type,
+                                                      void *missing,
+                                                      int *coordinate_type)
 {
     int ierr = 0, j;
     int axes[2];
@@ -688,12 +711,10 @@ int cmor_time_varying_grid_coordinate(int *coord_grid_id, int grid_id,
 
     strcpy(msg, "not found");
     if (coordinate_type == NULL) {
-        for (j = 0; j < cmor_tables[table_id].nvars; j++) {
-            if (strcmp(cmor_tables[table_id].vars[j].id, table_entry) == 0) {
-                strncpy(msg, cmor_tables[table_id].vars[j].standard_name,
-                        CMOR_MAX_STRING);
-                break;
-            }
+        j = cmor_get_table_var_id(table_id, table_entry);
+        if (j != -1) {
+            strncpy(msg, cmor_tables[table_id].vars[j].standard_name,
+                    CMOR_MAX_STRING);
         }
         if (strcmp(msg, "latitude") == 0)
             ctype = 0;
@@ -863,12 +884,31 @@ int cmor_time_varying_grid_coordinate(int *coord_grid_id, int grid_id,
     return (ierr);
 }
 
+/************************************************************************/
+/*                 cmor_time_varying_grid_coordinate()                  */
+/************************************************************************/
+int cmor_time_varying_grid_coordinate(int *coord_grid_id, int grid_id,
+                                      char *table_entry, char *units, char type,
+                                      void *missing, int *coordinate_type)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_time_varying_grid_coordinate_internal(coord_grid_id, grid_id,
+                                                      table_entry, units, type,
+                                                      missing,
+                                                      coordinate_type);
+    cmor_unlock();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                             cmor_grid()                              */
 /************************************************************************/
 
-int cmor_grid(int *grid_id, int ndims, int *axes_ids, char type,
-              void *lat, void *lon, int nvertices, void *blat, void *blon)
+static int cmor_grid_internal(int *grid_id, int ndims, int *axes_ids,
+                              char type, void *lat, void *lon, int nvertices,
+                              void *blat, void *blon)
 {
 
     int i, j, n, did_vertices = 0;
@@ -1065,3 +1105,18 @@ int cmor_grid(int *grid_id, int ndims, int *axes_ids, char type,
     cmor_pop_traceback();
     return (0);
 }
+
+/************************************************************************/
+/*                             cmor_grid()                              */
+/************************************************************************/
+int cmor_grid(int *grid_id, int ndims, int *axes_ids, char type,
+              void *lat, void *lon, int nvertices, void *blat, void *blon)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_grid_internal(grid_id, ndims, axes_ids, type, lat, lon,
+                              nvertices, blat, blon);
+    cmor_unlock();
+    return (ierr);
+}
@@ -286,20 +286,46 @@ void cvs_MD5Transform(cvs_uint32 buf[4], const unsigned char inraw[64])
    RFC1321 for example.  */
 #include <stdio.h>
 
-void cmor_md5(FILE * inputfile, unsigned char checksum[16])
+/* Files are hashed CMOR_MD5_BUFFER bytes at a time.  */
+#define CMOR_MD5_BUFFER 65536
+
+/* Hashes inputfile from its current position to its end, returns
+   non zero on a read error.  */
+static int cmor_md5_stream(FILE * inputfile, unsigned char checksum[16])
 {
     struct cvs_MD5Context context;
-    char c, d;
+    unsigned char buffer[CMOR_MD5_BUFFER];
+    size_t n;
 
     cvs_MD5Init(&context);
-    c = fgetc(inputfile);
-    d = EOF;
-    while (c != d) {
-        cvs_MD5Update(&context, (unsigned char *)&c, 1);
-        c = fgetc(inputfile);
+    while ((n = fread(buffer, 1, CMOR_MD5_BUFFER, inputfile)) > 0) {
+        cvs_MD5Update(&context, buffer, n);
     }
-    rewind(inputfile);
     cvs_MD5Final(checksum, &context);
 
+    return (ferror(inputfile));
+}
+
+void cmor_md5(FILE * inputfile, unsigned char checksum[16])
+{
+    cmor_md5_stream(inputfile, checksum);
+    rewind(inputfile);
+
     return;
 }
+
+/* Checksum of a whole file, returns 1 if it cannot be read.  */
+int cmor_md5_file(char *filename, unsigned char checksum[16])
+{
+    FILE *inputfile;
+    int ierr;
+
+    inputfile = fopen(filename, "rb");
+    if (inputfile == NULL) {
+        return (1);
+    }
+    ierr = cmor_md5_stream(inputfile, checksum);
+    fclose(inputfile);
+
+    return (ierr != 0);
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <libgen.h>
 #include "cmor.h"
@@ -10,6 +11,9 @@
 #include "json.h"
 #include "json_tokener.h"
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /************************************************************************/
 /*                               wfgetc()                               */
@@ -62,22 +66,395 @@ int cmor_get_table_attr(char *szToken, cmor_table_t * table, char *out)
 
 }
 
+/* -------------------------------------------------------------------- */
+/*      Interned strings of all loaded tables, packed in blocks of      */
+/*      CMOR_INTERN_BLOCK bytes and found through an open addressing    */
+/*      hash table so each distinct string is stored once.              */
+/* -------------------------------------------------------------------- */
+cmor_axis_def_t cmor_no_axis_def;
+static char cmor_intern_empty[1] = "";
+cmor_intern_block_t *cmor_intern_blocks = NULL;
+char **cmor_intern_slots = NULL;
+int cmor_intern_nslots = 0;
+int cmor_intern_count = 0;
+
 /************************************************************************/
-/*                          cmor_init_table()                           */
+/*                          cmor_hash_string()                          */
+/*                                                                      */
+/*      32 bit FNV-1a hash.                                             */
 /************************************************************************/
-void cmor_init_table(cmor_table_t * table, int id)
+unsigned int cmor_hash_string(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s != '\0') {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return (h);
+}
+
+/************************************************************************/
+/*                            cmor_intern()                             */
+/*                                                                      */
+/*      Returns the arena copy of s, adding it on first use.  The       */
+/*      result lives until cmor_free_interned_strings() and must not    */
+/*      be written to.  Never NULL, an empty string is returned when    */
+/*      the arena cannot grow.                                          */
+/************************************************************************/
+char *cmor_intern(const char *s)
+{
+    int i, j, nslots;
+    size_t len, size;
+    char **slots;
+    char *str;
+    cmor_intern_block_t *block;
+
+    if (2 * (cmor_intern_count + 1) > cmor_intern_nslots) {
+        nslots = (cmor_intern_nslots == 0) ? 1024 : 2 * cmor_intern_nslots;
+        slots = (char **)calloc(nslots, sizeof(char *));
+        if (slots == NULL) {
+            cmor_handle_error("cannot allocate interned string table",
+                              CMOR_CRITICAL);
+            return (cmor_intern_empty);
+        }
+        for (i = 0; i < cmor_intern_nslots; i++) {
+            if (cmor_intern_slots[i] == NULL)
+                continue;
+            j = cmor_hash_string(cmor_intern_slots[i]) & (nslots - 1);
+            while (slots[j] != NULL)
+                j = (j + 1) & (nslots - 1);
+            slots[j] = cmor_intern_slots[i];
+        }
+        free(cmor_intern_slots);
+        cmor_intern_slots = slots;
+        cmor_intern_nslots = nslots;
+    }
+
+    j = cmor_hash_string(s) & (cmor_intern_nslots - 1);
+    while (cmor_intern_slots[j] != NULL) {
+        if (strcmp(cmor_intern_slots[j], s) == 0)
+            return (cmor_intern_slots[j]);
+        j = (j + 1) & (cmor_intern_nslots - 1);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Not seen yet, copy it at the end of the current block.  Long    */
+/*      strings get a block of their own behind the current one.        */
+/* -------------------------------------------------------------------- */
+    len = strlen(s) + 1;
+    block = cmor_intern_blocks;
+    if ((block == NULL) || (block->size - block->used < len)) {
+        size = (len > CMOR_INTERN_BLOCK / 4) ? len : CMOR_INTERN_BLOCK;
+        block = (cmor_intern_block_t *) malloc(sizeof(cmor_intern_block_t)
+                                               + size);
+        if (block == NULL) {
+            cmor_handle_error("cannot allocate interned string block",
+                              CMOR_CRITICAL);
+            return (cmor_intern_empty);
+        }
+        block->used = 0;
+        block->size = size;
+        if ((size == len) && (cmor_intern_blocks != NULL)) {
+            block->next = cmor_intern_blocks->next;
+            cmor_intern_blocks->next = block;
+        } else {
+            block->next = cmor_intern_blocks;
+            cmor_intern_blocks = block;
+        }
+    }
+    str = (char *)(block + 1) + block->used;
+    memcpy(str, s, len);
+    block->used += len;
+
+    cmor_intern_slots[j] = str;
+    cmor_intern_count++;
+    return (str);
+}
+
+/************************************************************************/
+/*                     cmor_free_interned_strings()                     */
+/************************************************************************/
+void cmor_free_interned_strings(void)
+{
+    cmor_intern_block_t *block;
+
+    while (cmor_intern_blocks != NULL) {
+        block = cmor_intern_blocks;
+        cmor_intern_blocks = block->next;
+        free(block);
+    }
+    free(cmor_intern_slots);
+    cmor_intern_slots = NULL;
+    cmor_intern_nslots = 0;
+    cmor_intern_count = 0;
+    cmor_no_axis_def.id = NULL;
+}
+
+/************************************************************************/
+/*                      cmor_free_table_entries()                       */
+/*                                                                      */
+/*      Releases the entry arrays of a table, its strings stay in the   */
+/*      arena.                                                          */
+/************************************************************************/
+void cmor_free_table_entries(cmor_table_t * table)
 {
     int i;
 
-    cmor_add_traceback("cmor_init_table");
-    cmor_is_setup();
-    /* init the table */
-    table->id = id;
+    for (i = 0; (i <= table->naxes) && (i < table->axes_allocated); i++) {
+        if (table->axes[i].requested != NULL)
+            free(table->axes[i].requested);
+        if (table->axes[i].requested_bounds != NULL)
+            free(table->axes[i].requested_bounds);
+        if (table->axes[i].crequested != NULL)
+            free(table->axes[i].crequested);
+    }
+    free(table->axes);
+    free(table->vars);
+    free(table->formula);
+    free(table->mappings);
+    free(table->expt_ids);
+    free(table->sht_expt_ids);
+    free(table->generic_levels);
+    table->axes = NULL;
+    table->vars = NULL;
+    table->formula = NULL;
+    table->mappings = NULL;
+    table->expt_ids = NULL;
+    table->sht_expt_ids = NULL;
+    table->generic_levels = NULL;
+    table->axes_allocated = 0;
+    table->vars_allocated = 0;
+    table->formula_allocated = 0;
+    table->mappings_allocated = 0;
+    table->expts_allocated = 0;
+    table->generic_levels_allocated = 0;
+    cmor_free_index(&table->axes_index);
+    cmor_free_index(&table->vars_index);
+    cmor_free_index(&table->out_names_index);
+    cmor_free_index(&table->formula_index);
+    if (table->CV_shared == 1) {
+        table->CV_index = NULL;
+        table->CV = NULL;
+        table->CV_shared = 0;
+    } else {
+        cmor_CV_free_index(&table->CV_index);
+    }
+    table->naxes = -1;
     table->nvars = -1;
     table->nformula = -1;
-    table->naxes = -1;
     table->nexps = -1;
     table->nmappings = -1;
+    table->ngeneric_levels = 0;
+}
+
+/************************************************************************/
+/*                       cmor_reserve_experiment()                      */
+/************************************************************************/
+int cmor_reserve_experiment(cmor_table_t * table, int n)
+{
+    int allocated;
+
+    allocated = table->expts_allocated;
+    table->expt_ids = cmor_grow_registry(table->expt_ids, &allocated, n,
+                                         sizeof(char *), 0);
+    table->sht_expt_ids = cmor_grow_registry(table->sht_expt_ids,
+                                             &table->expts_allocated, n,
+                                             sizeof(char *), 0);
+    return (n < allocated && n < table->expts_allocated) ? 0 : 1;
+}
+
+/************************************************************************/
+/*                          cmor_get_var_def()                          */
+/*                                                                      */
+/*      Formula entries are referenced with ids starting at             */
+/*      CMOR_MAX_ELEMENTS.                                              */
+/************************************************************************/
+cmor_var_def_t *cmor_get_var_def(int table_id, int ref_var_id)
+{
+    if (ref_var_id >= CMOR_MAX_ELEMENTS)
+        return (&cmor_tables[table_id].formula[ref_var_id
+                                                - CMOR_MAX_ELEMENTS]);
+    return (&cmor_tables[table_id].vars[ref_var_id]);
+}
+
+/************************************************************************/
+/*                          cmor_get_axis_def()                         */
+/*                                                                      */
+/*      Variable dimensions use negative ids for axes that are not      */
+/*      in the table (-2 generic level, -CMOR_MAX_GRIDS grid axis);     */
+/*      those get an empty definition.                                  */
+/************************************************************************/
+cmor_axis_def_t *cmor_get_axis_def(int table_id, int axis_id)
+{
+    if (axis_id < 0) {
+        if (cmor_no_axis_def.id == NULL)
+            cmor_init_axis_def(&cmor_no_axis_def, -1);
+        return (&cmor_no_axis_def);
+    }
+    return (&cmor_tables[table_id].axes[axis_id]);
+}
+
+/************************************************************************/
+/*                          cmor_build_index()                          */
+/*                                                                      */
+/*      Hashes the string found at offset in each of the n entries of   */
+/*      size bytes.  When a key repeats the first entry wins, as it     */
+/*      would in a linear scan.                                         */
+/************************************************************************/
+void cmor_build_index(cmor_table_index_t * index, char *entries, int n,
+                      size_t size, size_t offset)
+{
+    int i, j, k, nslots;
+    char *key;
+
+    if ((index->slots != NULL) && (index->nindexed == n))
+        return;
+
+    nslots = 16;
+    while (nslots < 2 * n)
+        nslots *= 2;
+    free(index->slots);
+    index->slots = (int *)calloc(nslots, sizeof(int));
+    index->nslots = nslots;
+    index->nindexed = 0;
+    if (index->slots == NULL) {
+        cmor_handle_error("cannot allocate table index", CMOR_CRITICAL);
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        key = *(char **)(entries + i * size + offset);
+        j = cmor_hash_string(key) & (nslots - 1);
+        while ((k = index->slots[j]) != 0) {
+            if (strcmp(*(char **)(entries + (k - 1) * size + offset),
+                       key) == 0)
+                break;
+            j = (j + 1) & (nslots - 1);
+        }
+        if (k == 0)
+            index->slots[j] = i + 1;
+    }
+    index->nindexed = n;
+}
+
+/************************************************************************/
+/*                         cmor_search_index()                          */
+/*                                                                      */
+/*      Returns the first of the n entries whose key matches, -1 if     */
+/*      none does.                                                      */
+/************************************************************************/
+int cmor_search_index(cmor_table_index_t * index, char *entries, int n,
+                      size_t size, size_t offset, const char *key)
+{
+    int i, j;
+
+    if (index->slots != NULL) {
+        j = cmor_hash_string(key) & (index->nslots - 1);
+        while ((i = index->slots[j]) != 0) {
+            if (strcmp(*(char **)(entries + (i - 1) * size + offset),
+                       key) == 0)
+                return (i - 1);
+            j = (j + 1) & (index->nslots - 1);
+        }
+    }
+    for (i = index->nindexed; i < n; i++) {
+        if (strcmp(*(char **)(entries + i * size + offset), key) == 0)
+            return (i);
+    }
+    return (-1);
+}
+
+/************************************************************************/
+/*                           cmor_free_index()                          */
+/************************************************************************/
+void cmor_free_index(cmor_table_index_t * index)
+{
+    free(index->slots);
+    index->slots = NULL;
+    index->nslots = 0;
+    index->nindexed = 0;
+}
+
+/************************************************************************/
+/*                          cmor_index_table()                          */
+/************************************************************************/
+void cmor_index_table(cmor_table_t * table)
+{
+    cmor_build_index(&table->axes_index, (char *)table->axes,
+                     table->naxes + 1, sizeof(cmor_axis_def_t),
+                     offsetof(cmor_axis_def_t, id));
+    cmor_build_index(&table->vars_index, (char *)table->vars,
+                     table->nvars + 1, sizeof(cmor_var_def_t),
+                     offsetof(cmor_var_def_t, id));
+    cmor_build_index(&table->out_names_index, (char *)table->vars,
+                     table->nvars + 1, sizeof(cmor_var_def_t),
+                     offsetof(cmor_var_def_t, out_name));
+    cmor_build_index(&table->formula_index, (char *)table->formula,
+                     table->nformula + 1, sizeof(cmor_var_def_t),
+                     offsetof(cmor_var_def_t, id));
+}
+
+/************************************************************************/
+/*                        cmor_get_table_var_id()                       */
+/*                                                                      */
+/*      Table lookups by name, -1 when not found.                       */
+/************************************************************************/
+int cmor_get_table_var_id(int table_id, const char *name)
+{
+    cmor_table_t *table = &cmor_tables[table_id];
+
+    return (cmor_search_index(&table->vars_index, (char *)table->vars,
+                              table->nvars + 1, sizeof(cmor_var_def_t),
+                              offsetof(cmor_var_def_t, id), name));
+}
+
+/************************************************************************/
+/*                     cmor_get_table_out_name_id()                     */
+/************************************************************************/
+int cmor_get_table_out_name_id(int table_id, const char *name)
+{
+    cmor_table_t *table = &cmor_tables[table_id];
+
+    return (cmor_search_index(&table->out_names_index, (char *)table->vars,
+                              table->nvars + 1, sizeof(cmor_var_def_t),
+                              offsetof(cmor_var_def_t, out_name), name));
+}
+
+/************************************************************************/
+/*                       cmor_get_table_axis_id()                       */
+/************************************************************************/
+int cmor_get_table_axis_id(int table_id, const char *name)
+{
+    cmor_table_t *table = &cmor_tables[table_id];
+
+    return (cmor_search_index(&table->axes_index, (char *)table->axes,
+                              table->naxes + 1, sizeof(cmor_axis_def_t),
+                              offsetof(cmor_axis_def_t, id), name));
+}
+
+/************************************************************************/
+/*                     cmor_get_table_formula_id()                      */
+/************************************************************************/
+int cmor_get_table_formula_id(int table_id, const char *name)
+{
+    cmor_table_t *table = &cmor_tables[table_id];
+
+    return (cmor_search_index(&table->formula_index, (char *)table->formula,
+                              table->nformula + 1, sizeof(cmor_var_def_t),
+                              offsetof(cmor_var_def_t, id), name));
+}
+
+/************************************************************************/
+/*                          cmor_init_table()                           */
+/************************************************************************/
+void cmor_init_table(cmor_table_t * table, int id)
+{
+    cmor_add_traceback("cmor_init_table");
+    cmor_is_setup();
+    /* init the table */
+    cmor_free_table_entries(table);
+    table->id = id;
     table->cf_version = 1.6;
     table->cmor_version = 3.0;
     table->mip_era[0] = '\0';
@@ -94,11 +471,6 @@ void cmor_init_table(cmor_table_t * table, int id)
     table->path[0] = '\0';
 //    table->frequency[0] = '\0';
     table->nforcings = 0;
-    for (i = 0; i < CMOR_MAX_ELEMENTS; i++) {
-        table->expt_ids[i][0] = '\0';
-        table->sht_expt_ids[i][0] = '\0';
-        table->generic_levels[i][0] = '\0';
-    }
     table->CV = NULL;
 
     cmor_pop_traceback();
@@ -106,13 +478,14 @@ void cmor_init_table(cmor_table_t * table, int id)
 }
 
 /************************************************************************/
-/*                    cmor_set_formula_entry()                          */
+/*                    cmor_add_formula_entry()                          */
+/*                                                                      */
+/*      Appends an empty formula entry to the table, NULL on error.     */
 /************************************************************************/
-int cmor_set_formula_entry(cmor_table_t * table,
-                           char *formula_entry, json_object * json)
+cmor_var_def_t *cmor_add_formula_entry(cmor_table_t * table,
+                                       char *formula_entry)
 {
     extern int cmor_ntables;
-    char szValue[CMOR_MAX_STRING];
     char msg[CMOR_MAX_STRING];
     int nFormulaId;
     char *szTableId;
@@ -122,7 +495,7 @@ int cmor_set_formula_entry(cmor_table_t * table,
 
     szTableId = cmor_table->szTable_id;
 
-    cmor_add_traceback("cmor_set_formula_entry");
+    cmor_add_traceback("cmor_add_formula_entry");
     cmor_is_setup();
 
     /* -------------------------------------------------------------------- */
@@ -130,19 +503,43 @@ int cmor_set_formula_entry(cmor_table_t * table,
     /* -------------------------------------------------------------------- */
     cmor_table->nformula++;
     nFormulaId = cmor_table->nformula;
-    formula = &cmor_table->formula[nFormulaId];
-
-    if (nFormulaId >= CMOR_MAX_FORMULA) {
+    cmor_table->formula = cmor_grow_registry(cmor_table->formula,
+                                             &cmor_table->formula_allocated,
+                                             nFormulaId,
+                                             sizeof(cmor_var_def_t), 0);
+    if (nFormulaId >= cmor_table->formula_allocated) {
         snprintf(msg, CMOR_MAX_STRING,
                  "Too many formula defined for table: %s", szTableId);
         cmor_handle_error(msg, CMOR_CRITICAL);
         cmor_ntables--;
         cmor_pop_traceback();
-        return (1);
+        return (NULL);
     }
+    formula = &cmor_table->formula[nFormulaId];
 
     cmor_init_var_def(formula, cmor_ntables);
     cmor_set_var_def_att(formula, "id", formula_entry);
+    cmor_pop_traceback();
+    return (formula);
+}
+
+/************************************************************************/
+/*                    cmor_set_formula_entry()                          */
+/************************************************************************/
+int cmor_set_formula_entry(cmor_table_t * table,
+                           char *formula_entry, json_object * json)
+{
+    char szValue[CMOR_MAX_STRING];
+    cmor_var_def_t *formula;
+
+    cmor_add_traceback("cmor_set_formula_entry");
+    cmor_is_setup();
+
+    formula = cmor_add_formula_entry(table, formula_entry);
+    if (formula == NULL) {
+        cmor_pop_traceback();
+        return (1);
+    }
 
     json_object_object_foreach(json, attr, value) {
 /* -------------------------------------------------------------------- */
@@ -161,13 +558,14 @@ int cmor_set_formula_entry(cmor_table_t * table,
 }
 
 /************************************************************************/
-/*                    cmor_set_variable_entry()                         */
+/*                    cmor_add_variable_entry()                         */
+/*                                                                      */
+/*      Appends an empty variable entry to the table, NULL on error.    */
 /************************************************************************/
-int cmor_set_variable_entry(cmor_table_t * table,
-                            char *variable_entry, json_object * json)
+cmor_var_def_t *cmor_add_variable_entry(cmor_table_t * table,
+                                        char *variable_entry)
 {
     extern int cmor_ntables;
-    char szValue[CMOR_MAX_STRING];
     char msg[CMOR_MAX_STRING];
     int nVarId;
     char *szTableId;
@@ -177,7 +575,7 @@ int cmor_set_variable_entry(cmor_table_t * table,
 
     szTableId = cmor_table->szTable_id;
 
-    cmor_add_traceback("cmor_set_variable_entry");
+    cmor_add_traceback("cmor_add_variable_entry");
     cmor_is_setup();
 
     /* -------------------------------------------------------------------- */
@@ -185,19 +583,49 @@ int cmor_set_variable_entry(cmor_table_t * table,
     /* -------------------------------------------------------------------- */
     cmor_table->nvars++;
     nVarId = cmor_table->nvars;
-    variable = &cmor_table->vars[nVarId];
-
-    if (nVarId >= CMOR_MAX_ELEMENTS) {
+/* -------------------------------------------------------------------- */
+/*      ids from CMOR_MAX_ELEMENTS up refer to formula entries          */
+/* -------------------------------------------------------------------- */
+    if (nVarId < CMOR_MAX_ELEMENTS) {
+        cmor_table->vars = cmor_grow_registry(cmor_table->vars,
+                                              &cmor_table->vars_allocated,
+                                              nVarId, sizeof(cmor_var_def_t),
+                                              0);
+    }
+    if ((nVarId >= CMOR_MAX_ELEMENTS)
+        || (nVarId >= cmor_table->vars_allocated)) {
         snprintf(msg, CMOR_MAX_STRING,
                  "Too many variables defined for table: %s", szTableId);
         cmor_handle_error(msg, CMOR_CRITICAL);
         cmor_ntables--;
         cmor_pop_traceback();
-        return (1);
+        return (NULL);
     }
+    variable = &cmor_table->vars[nVarId];
 
     cmor_init_var_def(variable, cmor_ntables);
     cmor_set_var_def_att(variable, "id", variable_entry);
+    cmor_pop_traceback();
+    return (variable);
+}
+
+/************************************************************************/
+/*                    cmor_set_variable_entry()                         */
+/************************************************************************/
+int cmor_set_variable_entry(cmor_table_t * table,
+                            char *variable_entry, json_object * json)
+{
+    char szValue[CMOR_MAX_STRING];
+    cmor_var_def_t *variable;
+
+    cmor_add_traceback("cmor_set_variable_entry");
+    cmor_is_setup();
+
+    variable = cmor_add_variable_entry(table, variable_entry);
+    if (variable == NULL) {
+        cmor_pop_traceback();
+        return (1);
+    }
 
     json_object_object_foreach(json, attr, value) {
 /* -------------------------------------------------------------------- */
@@ -216,13 +644,13 @@ int cmor_set_variable_entry(cmor_table_t * table,
 }
 
 /************************************************************************/
-/*                        cmor_set_axis_entry()                         */
+/*                        cmor_add_axis_entry()                         */
+/*                                                                      */
+/*      Appends an empty axis entry to the table, NULL on error.        */
 /************************************************************************/
-int cmor_set_axis_entry(cmor_table_t * table,
-                        char *axis_entry, json_object * json)
+cmor_axis_def_t *cmor_add_axis_entry(cmor_table_t * table, char *axis_entry)
 {
     extern int cmor_ntables;
-    char szValue[CMOR_MAX_STRING * 20];
     char msg[CMOR_MAX_STRING];
     int nAxisId;
     char *szTableId;
@@ -232,7 +660,7 @@ int cmor_set_axis_entry(cmor_table_t * table,
 
     szTableId = cmor_table->szTable_id;
 
-    cmor_add_traceback("cmor_set_axis_entry");
+    cmor_add_traceback("cmor_add_axis_entry");
     cmor_is_setup();
 
     /* -------------------------------------------------------------------- */
@@ -240,23 +668,47 @@ int cmor_set_axis_entry(cmor_table_t * table,
     /* -------------------------------------------------------------------- */
     cmor_table->naxes++;
     nAxisId = cmor_table->naxes;
-    axis = &cmor_table->axes[nAxisId];
-
-    if (nAxisId >= CMOR_MAX_ELEMENTS) {
+    cmor_table->axes = cmor_grow_registry(cmor_table->axes,
+                                          &cmor_table->axes_allocated,
+                                          nAxisId, sizeof(cmor_axis_def_t),
+                                          0);
+    if (nAxisId >= cmor_table->axes_allocated) {
         snprintf(msg, CMOR_MAX_STRING, "Too many axes defined for table: %s",
                  szTableId);
         cmor_handle_error(msg, CMOR_CRITICAL);
         cmor_ntables--;
         cmor_pop_traceback();
-        return (1);
+        return (NULL);
     }
     axis = &cmor_table->axes[nAxisId];
+    memset(axis, 0, sizeof(cmor_axis_def_t));
 
     /* -------------------------------------------------------------------- */
     /*      Define Axis                                                     */
     /* -------------------------------------------------------------------- */
     cmor_init_axis_def(axis, cmor_ntables);
     cmor_set_axis_def_att(axis, "id", axis_entry);
+    cmor_pop_traceback();
+    return (axis);
+}
+
+/************************************************************************/
+/*                        cmor_set_axis_entry()                         */
+/************************************************************************/
+int cmor_set_axis_entry(cmor_table_t * table,
+                        char *axis_entry, json_object * json)
+{
+    char szValue[CMOR_MAX_STRING * 20];
+    cmor_axis_def_t *axis;
+
+    cmor_add_traceback("cmor_set_axis_entry");
+    cmor_is_setup();
+
+    axis = cmor_add_axis_entry(table, axis_entry);
+    if (axis == NULL) {
+        cmor_pop_traceback();
+        return (1);
+    }
 
     /* -------------------------------------------------------------------- */
     /*      Add axis value                                                  */
@@ -285,9 +737,9 @@ int cmor_set_experiments(cmor_table_t * table, char att[CMOR_MAX_STRING],
     cmor_is_setup();
     table->nexps++;
     /* -------------------------------------------------------------------- */
-    /*      Check number of experiments                                     */
+    /*      Make room for the experiment                                    */
     /* -------------------------------------------------------------------- */
-    if (table->nexps > CMOR_MAX_ELEMENTS) {
+    if (cmor_reserve_experiment(table, table->nexps) != 0) {
         snprintf(szError, CMOR_MAX_STRING,
                  "Table %s: Too many experiments defined", table->szTable_id);
         cmor_handle_error(szError, CMOR_CRITICAL);
@@ -300,8 +752,8 @@ int cmor_set_experiments(cmor_table_t * table, char att[CMOR_MAX_STRING],
     /*      Insert experiment to table                                      */
     /* -------------------------------------------------------------------- */
 
-    strncpy(table->sht_expt_ids[table->nexps], att, CMOR_MAX_STRING);
-    strncpy(table->expt_ids[table->nexps], val, CMOR_MAX_STRING);
+    table->sht_expt_ids[table->nexps] = cmor_intern(att);
+    table->expt_ids[table->nexps] = cmor_intern(val);
 
     cmor_pop_traceback();
     return (0);
@@ -358,13 +810,21 @@ int cmor_set_dataset_att(cmor_table_t * table, char att[CMOR_MAX_STRING],
                 i++;
             j = 0;
             while (i < (strlen(value)) && value[i] != ' ') {
-                table->generic_levels[n][j] = value[i];
+                value2[j] = value[i];
                 j++;
                 i++;
             }
-            table->generic_levels[n][j] = '\0';
+            value2[j] = '\0';
+            if (j == 0)
+                continue;
+            table->generic_levels =
+              cmor_grow_registry(table->generic_levels,
+                                 &table->generic_levels_allocated, n,
+                                 sizeof(char *), 0);
+            table->generic_levels[n] = cmor_intern(value2);
             n += 1;
         }
+        table->ngeneric_levels = n;
 
     } else if (strcmp(att, TABLE_HEADER_CONVENTIONS) == 0) {
         strncpy(table->Conventions, val, CMOR_MAX_STRING);
@@ -425,7 +885,7 @@ int cmor_set_dataset_att(cmor_table_t * table, char att[CMOR_MAX_STRING],
 /* -------------------------------------------------------------------- */
     } else if (strcmp(att, TABLE_EXPIDS) == 0) {
         table->nexps++;
-        if (table->nexps > CMOR_MAX_ELEMENTS) {
+        if (cmor_reserve_experiment(table, table->nexps) != 0) {
             snprintf(value2, CMOR_MAX_STRING,
                      "Table %s: Too many experiments defined",
                      table->szTable_id);
@@ -454,8 +914,8 @@ int cmor_set_dataset_att(cmor_table_t * table, char att[CMOR_MAX_STRING],
             }
         }
         if (n == -1) {
-            strncpy(table->expt_ids[table->nexps], value, CMOR_MAX_STRING);
-            strcpy(table->sht_expt_ids[table->nexps], "");
+            table->expt_ids[table->nexps] = cmor_intern(value);
+            table->sht_expt_ids[table->nexps] = cmor_intern("");
         } else {
 /* -------------------------------------------------------------------- */
 /*      ok looks like we have a short name let clook for the next '     */
@@ -469,17 +929,16 @@ int cmor_set_dataset_att(cmor_table_t * table, char att[CMOR_MAX_STRING],
 /*      ok we must have a ' in our exp_id_ok                            */
 /* -------------------------------------------------------------------- */
             if (i == -1) {
-                strncpy(table->expt_ids[table->nexps], value, CMOR_MAX_STRING);
-                strcpy(table->sht_expt_ids[table->nexps], "");
+                table->expt_ids[table->nexps] = cmor_intern(value);
+                table->sht_expt_ids[table->nexps] = cmor_intern("");
             } else {
                 for (j = i + 1; j < strlen(value); j++) {
                     value2[j - i - 1] = value[j];
                     value2[j - i] = '\0';
                 }
-                strncpy(table->sht_expt_ids[table->nexps], value2,
-                        CMOR_MAX_STRING);
+                table->sht_expt_ids[table->nexps] = cmor_intern(value2);
                 value[n] = '\0';
-                strncpy(table->expt_ids[table->nexps], value, CMOR_MAX_STRING);
+                table->expt_ids[table->nexps] = cmor_intern(value);
             }
         }
     } else if (strcmp(att, TABLE_HEADER_APRX_INTRVL) == 0) {
@@ -549,12 +1008,11 @@ int cmor_load_table(char szTable[CMOR_MAX_STRING], int *table_id)
     char msg[CMOR_MAX_STRING];
     struct stat st;
     cmor_add_traceback("cmor_load_table");
+    cmor_lock();
 
-    if (cmor_ntables == (CMOR_MAX_TABLES - 1)) {
-        snprintf(msg, CMOR_MAX_STRING, "You cannot load more than %d tables",
-                 CMOR_MAX_TABLES);
+    if (cmor_reserve_table(cmor_ntables + 1) != 0) {
+        cmor_unlock();
         cmor_pop_traceback();
-        cmor_handle_error(msg, CMOR_CRITICAL);
         return (-1);
     }
 
@@ -603,6 +1061,8 @@ int cmor_load_table(char szTable[CMOR_MAX_STRING], int *table_id)
     rc = cmor_search_table(szTable, table_id);
 
     if (rc == TABLE_FOUND) {
+        free(szTableName);
+        cmor_unlock();
         return (TABLE_SUCCESS);
     }
 
@@ -614,7 +1074,7 @@ int cmor_load_table(char szTable[CMOR_MAX_STRING], int *table_id)
         strcpy(cmor_tables[cmor_ntables].path, szTable);
         cmor_set_cur_dataset_attribute_internal(CV_INPUTFILENAME,
                                                 szControlFilenameJSON, 1);
-        rc = cmor_load_table_internal(szAxisEntryFilenameJSON, table_id);
+        rc = cmor_load_companion_table(szAxisEntryFilenameJSON, table_id);
         if (rc != TABLE_SUCCESS) {
             snprintf(msg, CMOR_MAX_STRING, "Can't open/read JSON table %s",
                      szAxisEntryFilenameJSON);
@@ -625,14 +1085,22 @@ int cmor_load_table(char szTable[CMOR_MAX_STRING], int *table_id)
             snprintf(msg, CMOR_MAX_STRING, "Can't open/read JSON table %s",
                      szTable);
             cmor_handle_error(msg, CMOR_WARNING);
+/* -------------------------------------------------------------------- */
+/*      give the slot back so that the table can be loaded again        */
+/* -------------------------------------------------------------------- */
+            cmor_init_table(&cmor_tables[*table_id], *table_id);
+            cmor_ntables = *table_id - 1;
+            free(szTableName);
+            cmor_unlock();
+            return (TABLE_ERROR);
         }
-        rc = cmor_load_table_internal(szFormulaVarFilenameJSON, table_id);
+        rc = cmor_load_companion_table(szFormulaVarFilenameJSON, table_id);
         if (rc != TABLE_SUCCESS) {
             snprintf(msg, CMOR_MAX_STRING, "Can't open/read JSON table %s",
                      szFormulaVarFilenameJSON);
             cmor_handle_error(msg, CMOR_WARNING);
         }
-        rc = cmor_load_table_internal(szControlFilenameJSON, table_id);
+        rc = cmor_load_companion_table(szControlFilenameJSON, table_id);
         if (rc != TABLE_SUCCESS) {
             snprintf(msg, CMOR_MAX_STRING, "Can't open/read JSON table %s",
                      szControlFilenameJSON);
@@ -644,6 +1112,7 @@ int cmor_load_table(char szTable[CMOR_MAX_STRING], int *table_id)
     }
 
     free(szTableName);
+    cmor_unlock();
 
     return (rc);
 }
@@ -667,38 +1136,1128 @@ int cmor_search_table(char szTable[CMOR_MAX_STRING], int *table_id)
     return (TABLE_NOTFOUND);
 }
 
+/* -------------------------------------------------------------------- */
+/*      Companion tables parsed so far, several versions of a file may  */
+/*      be kept as earlier tables still point to their CV.              */
+/* -------------------------------------------------------------------- */
+cmor_companion_t *cmor_companions = NULL;
+int cmor_ncompanions = 0;
+int cmor_companions_allocated = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Cleared by cmor_load_table_internal() when the file it loaded   */
+/*      had sections other than axis_entry, formula_entry or CV.        */
+/* -------------------------------------------------------------------- */
+int cmor_table_shareable = 0;
+
 /************************************************************************/
-/*                   cmor_load_table_internal()                         */
+/*                        cmor_find_table_file()                        */
+/*                                                                      */
+/*      Looks for a table the way cmor_load_table_internal() opens it   */
+/*      and returns its path, modification time and size.               */
 /************************************************************************/
-int cmor_load_table_internal(char szTable[CMOR_MAX_STRING], int *table_id)
+int cmor_find_table_file(char *szTable, char *szPath, time_t * mtime,
+                         off_t * size)
 {
-    FILE *table_file;
-    char word[CMOR_MAX_STRING];
-    int n;
-    int done = 0;
-    extern int CMOR_TABLE, cmor_ntables;
     extern char cmor_input_path[CMOR_MAX_STRING];
-    char msg[CMOR_MAX_STRING];
-    char szVal[1024000];
-    char *buffer = NULL;
-    int nTableSize, read_size;
-    json_object *json_obj;
-
-    cmor_add_traceback("cmor_load_table_internal");
-    cmor_is_setup();
+    struct stat st;
 
-    table_file = fopen(szTable, "r");
-    if (table_file == NULL) {
+    strncpy(szPath, szTable, CMOR_MAX_STRING);
+    if (stat(szPath, &st) != 0) {
         if (szTable[0] != '/') {
-            snprintf(word, CMOR_MAX_STRING, "%s/%s", cmor_input_path, szTable);
-            table_file = fopen(word, "r");
+            snprintf(szPath, CMOR_MAX_STRING, "%s/%s", cmor_input_path,
+                     szTable);
         }
-        if (table_file == NULL) {
-            snprintf(word, CMOR_MAX_STRING, "%s/share/%s", CMOR_PREFIX,
+        if ((szTable[0] == '/') || (stat(szPath, &st) != 0)) {
+            snprintf(szPath, CMOR_MAX_STRING, "%s/share/%s", CMOR_PREFIX,
                      szTable);
-            table_file = fopen(word, "r");
+            if (stat(szPath, &st) != 0) {
+                return (1);
+            }
         }
-        if (table_file == NULL) {
+    }
+    *mtime = st.st_mtime;
+    *size = st.st_size;
+    return (0);
+}
+
+/************************************************************************/
+/*                         cmor_copy_axis_def()                         */
+/************************************************************************/
+void cmor_copy_axis_def(cmor_axis_def_t * dst, cmor_axis_def_t * src,
+                        int table_id)
+{
+    *dst = *src;
+    dst->table_id = table_id;
+    if (src->requested != NULL) {
+        dst->requested = malloc(src->n_requested * sizeof(double));
+        memcpy(dst->requested, src->requested,
+               src->n_requested * sizeof(double));
+    }
+    if (src->requested_bounds != NULL) {
+        dst->requested_bounds = malloc(src->n_requested_bounds *
+                                       sizeof(double));
+        memcpy(dst->requested_bounds, src->requested_bounds,
+               src->n_requested_bounds * sizeof(double));
+    }
+    if (src->crequested != NULL) {
+        dst->crequested = strdup(src->crequested);
+    }
+}
+
+/************************************************************************/
+/*                       cmor_attach_companion()                        */
+/*                                                                      */
+/*      Adds the entries of an already parsed companion to table.       */
+/************************************************************************/
+int cmor_attach_companion(cmor_table_t * table, cmor_companion_t * companion)
+{
+    extern int cmor_ntables;
+    char msg[CMOR_MAX_STRING];
+    int i;
+
+    cmor_add_traceback("cmor_attach_companion");
+    memcpy(table->md5, companion->md5, 16);
+
+    for (i = 0; i < companion->naxes; i++) {
+        table->naxes++;
+        table->axes = cmor_grow_registry(table->axes, &table->axes_allocated,
+                                         table->naxes, sizeof(cmor_axis_def_t),
+                                         0);
+        if (table->naxes >= table->axes_allocated) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "Too many axes defined for table: %s",
+                     table->szTable_id);
+            cmor_handle_error(msg, CMOR_CRITICAL);
+            cmor_pop_traceback();
+            return (TABLE_ERROR);
+        }
+        cmor_copy_axis_def(&table->axes[table->naxes], &companion->axes[i],
+                           cmor_ntables);
+    }
+
+    for (i = 0; i < companion->nformula; i++) {
+        table->nformula++;
+        table->formula = cmor_grow_registry(table->formula,
+                                            &table->formula_allocated,
+                                            table->nformula,
+                                            sizeof(cmor_var_def_t), 0);
+        if (table->nformula >= table->formula_allocated) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "Too many formula defined for table: %s",
+                     table->szTable_id);
+            cmor_handle_error(msg, CMOR_CRITICAL);
+            cmor_pop_traceback();
+            return (TABLE_ERROR);
+        }
+        table->formula[table->nformula] = companion->formula[i];
+        table->formula[table->nformula].table_id = cmor_ntables;
+    }
+
+    if (companion->CV != NULL) {
+        table->CV = companion->CV;
+        table->CV_index = companion->CV_index;
+        table->CV_shared = 1;
+    }
+    cmor_index_table(table);
+    cmor_pop_traceback();
+    return (TABLE_SUCCESS);
+}
+
+/************************************************************************/
+/*                     cmor_load_companion_table()                      */
+/*                                                                      */
+/*      Loads the coordinate, formula terms or CV file of a table.      */
+/*      Each version (path, mtime and size) of such a file is only      */
+/*      read and parsed once, later tables copy its axis and formula    */
+/*      entries and point to its CV.                                    */
+/************************************************************************/
+int cmor_load_companion_table(char szTable[CMOR_MAX_STRING], int *table_id)
+{
+    extern int cmor_ntables;
+    char szPath[CMOR_MAX_STRING];
+    time_t mtime;
+    off_t size;
+    cmor_table_t *table;
+    cmor_companion_t *companion;
+    int i, rc, naxes, nformula;
+
+    cmor_add_traceback("cmor_load_companion_table");
+    table = &cmor_tables[cmor_ntables];
+
+/* -------------------------------------------------------------------- */
+/*      a shared CV cannot be merged into the table's own CV            */
+/* -------------------------------------------------------------------- */
+    if ((cmor_find_table_file(szTable, szPath, &mtime, &size) != 0)
+        || (table->CV != NULL)) {
+        rc = cmor_load_table_internal(szTable, table_id);
+        cmor_pop_traceback();
+        return (rc);
+    }
+
+    for (i = 0; i < cmor_ncompanions; i++) {
+        companion = &cmor_companions[i];
+        if ((strcmp(companion->path, szPath) == 0)
+            && (companion->mtime == mtime) && (companion->size == size)
+            && ((companion->nformula == 0)
+                || (companion->table_naxes == table->naxes))) {
+            rc = cmor_attach_companion(table, companion);
+            cmor_pop_traceback();
+            return (rc);
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      first time we see this file, parse it and keep what it added    */
+/* -------------------------------------------------------------------- */
+    naxes = table->naxes;
+    nformula = table->nformula;
+    rc = cmor_load_table_internal(szTable, table_id);
+    if ((rc != TABLE_SUCCESS) || (cmor_table_shareable == 0)) {
+        cmor_pop_traceback();
+        return (rc);
+    }
+
+    cmor_companions = cmor_grow_registry(cmor_companions,
+                                         &cmor_companions_allocated,
+                                         cmor_ncompanions,
+                                         sizeof(cmor_companion_t), 0);
+    if (cmor_ncompanions >= cmor_companions_allocated) {
+        cmor_pop_traceback();
+        return (rc);
+    }
+    table = &cmor_tables[cmor_ntables];
+    companion = &cmor_companions[cmor_ncompanions++];
+    memset(companion, 0, sizeof(cmor_companion_t));
+    strncpy(companion->path, szPath, CMOR_MAX_STRING);
+    companion->mtime = mtime;
+    companion->size = size;
+    memcpy(companion->md5, table->md5, 16);
+
+    companion->naxes = table->naxes - naxes;
+    if (companion->naxes > 0) {
+        companion->axes = malloc(companion->naxes * sizeof(cmor_axis_def_t));
+        for (i = 0; i < companion->naxes; i++) {
+            cmor_copy_axis_def(&companion->axes[i],
+                               &table->axes[naxes + 1 + i], cmor_ntables);
+        }
+    }
+    companion->nformula = table->nformula - nformula;
+    companion->table_naxes = naxes;
+    if (companion->nformula > 0) {
+        companion->formula = malloc(companion->nformula *
+                                    sizeof(cmor_var_def_t));
+        memcpy(companion->formula, &table->formula[nformula + 1],
+               companion->nformula * sizeof(cmor_var_def_t));
+    }
+    if (table->CV != NULL) {
+        companion->CV = table->CV;
+        companion->CV_index = table->CV_index;
+        table->CV_shared = 1;
+    }
+    cmor_pop_traceback();
+    return (rc);
+}
+
+/************************************************************************/
+/*                        cmor_free_companions()                        */
+/************************************************************************/
+void cmor_free_companions(void)
+{
+    int i, j;
+    cmor_companion_t *companion;
+
+    for (i = 0; i < cmor_ncompanions; i++) {
+        companion = &cmor_companions[i];
+        for (j = 0; j < companion->naxes; j++) {
+            free(companion->axes[j].requested);
+            free(companion->axes[j].requested_bounds);
+            free(companion->axes[j].crequested);
+        }
+        free(companion->axes);
+        free(companion->formula);
+        cmor_CV_free_index(&companion->CV_index);
+        if (companion->CV != NULL) {
+            for (j = 0; j < companion->CV->nbObjects; j++) {
+                cmor_CV_free(&companion->CV[j]);
+            }
+            free(companion->CV);
+        }
+    }
+    free(cmor_companions);
+    cmor_companions = NULL;
+    cmor_ncompanions = 0;
+    cmor_companions_allocated = 0;
+}
+
+/************************************************************************/
+/*                       cmor_table_cache_add()                         */
+/*                                                                      */
+/*      Appends a record to a table cache being built.  The record is  */
+/*      only valid until the next one is added, NULL on error or when   */
+/*      no cache is built.                                              */
+/************************************************************************/
+cmor_table_cache_record_t *cmor_table_cache_add(cmor_table_cache_builder_t *
+                                                cache, int kind,
+                                                const char *name,
+                                                const char *value)
+{
+    cmor_table_cache_record_t *record;
+    const char *str[2];
+    int offset[2];
+    int i, n;
+
+    if ((cache == NULL) || (cache->error != 0)) {
+        return (NULL);
+    }
+    str[0] = name;
+    str[1] = value;
+    for (i = 0; i < 2; i++) {
+        offset[i] = -1;
+        if (str[i][0] == '\0') {
+            continue;
+        }
+        n = strlen(str[i]) + 1;
+        cache->strings = cmor_grow_registry(cache->strings,
+                                            &cache->strings_allocated,
+                                            cache->strings_size + n, 1, 0);
+        if (cache->strings_size + n >= cache->strings_allocated) {
+            cache->error = 1;
+            return (NULL);
+        }
+        memcpy(&cache->strings[cache->strings_size], str[i], n);
+        offset[i] = cache->strings_size;
+        cache->strings_size += n;
+    }
+
+    cache->records = cmor_grow_registry(cache->records,
+                                        &cache->records_allocated,
+                                        cache->nrecords,
+                                        sizeof(cmor_table_cache_record_t), 0);
+    if (cache->nrecords >= cache->records_allocated) {
+        cache->error = 1;
+        return (NULL);
+    }
+    record = &cache->records[cache->nrecords++];
+    record->kind = kind;
+    record->name = offset[0];
+    record->value = offset[1];
+    record->type = CV_undef;
+    record->nobjects = -1;
+    record->nitems = -1;
+    record->nValue = -1;
+    record->dValue = 0.;
+    return (record);
+}
+
+/************************************************************************/
+/*                      cmor_table_cache_string()                       */
+/************************************************************************/
+char *cmor_table_cache_string(char *strings, int offset)
+{
+    if (offset < 0) {
+        return ("");
+    }
+    return (&strings[offset]);
+}
+
+/************************************************************************/
+/*                     cmor_get_table_cache_path()                      */
+/*                                                                      */
+/*      Cache file of a table, when the dataset sets _table_cache_dir.  */
+/*      The path hash keeps tables of the same name apart.              */
+/************************************************************************/
+int cmor_get_table_cache_path(char *szTable, char *szCache)
+{
+    char szDir[CMOR_MAX_STRING];
+    char szName[CMOR_MAX_STRING];
+
+    if (cmor_has_cur_dataset_attribute(CMOR_TABLE_CACHE_DIR) != 0) {
+        return (1);
+    }
+    cmor_get_cur_dataset_attribute(CMOR_TABLE_CACHE_DIR, szDir);
+    if (szDir[0] == '\0') {
+        return (1);
+    }
+    strncpy(szName, szTable, CMOR_MAX_STRING);
+    snprintf(szCache, CMOR_MAX_STRING, "%s/%s.%08x%s", szDir,
+             basename(szName), cmor_hash_string(szTable),
+             CMOR_TABLE_CACHE_SUFFIX);
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_write_table_cache()                       */
+/*                                                                      */
+/*      Writes the records collected while loading a table.  The file   */
+/*      is written aside and renamed so concurrent jobs never map a     */
+/*      partial cache.                                                  */
+/************************************************************************/
+int cmor_write_table_cache(char *szCache, unsigned char md5[16],
+                           cmor_table_cache_builder_t * cache)
+{
+    cmor_table_cache_header_t header;
+    char szTmp[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    FILE *cache_file;
+    int ierr;
+
+    cmor_add_traceback("cmor_write_table_cache");
+
+    ierr = cache->error;
+    if (ierr == 0) {
+        memcpy(header.magic, CMOR_TABLE_CACHE_MAGIC, 8);
+        memcpy(header.md5, md5, 16);
+        header.nrecords = cache->nrecords;
+        header.strings_size = cache->strings_size;
+
+        snprintf(szTmp, CMOR_MAX_STRING, "%s.%d", szCache, (int)getpid());
+        cache_file = fopen(szTmp, "wb");
+        if (cache_file == NULL) {
+            ierr = 1;
+        } else {
+            if ((fwrite(&header, sizeof(header), 1, cache_file) != 1)
+                || (fwrite(cache->records, sizeof(cmor_table_cache_record_t),
+                           cache->nrecords, cache_file) != cache->nrecords)
+                || (fwrite(cache->strings, 1, cache->strings_size,
+                           cache_file) != cache->strings_size)) {
+                ierr = 1;
+            }
+            if (fclose(cache_file) != 0) {
+                ierr = 1;
+            }
+            if ((ierr != 0) || (rename(szTmp, szCache) != 0)) {
+                remove(szTmp);
+                ierr = 1;
+            }
+        }
+    }
+
+    if (ierr != 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "Could not write table cache %s", szCache);
+        cmor_handle_error(msg, CMOR_WARNING);
+    }
+    cmor_pop_traceback();
+    return (ierr);
+}
+
+/************************************************************************/
+/*                       cmor_set_table_record()                        */
+/*                                                                      */
+/*      Sets one header attribute, experiment, entry or entry attribute */
+/*      of the table being loaded.  *axis and *var track the entry      */
+/*      that CACHE_ENTRY_ATT records belong to.                         */
+/************************************************************************/
+int cmor_set_table_record(cmor_table_t * table, int kind, char *name,
+                          char *value, cmor_axis_def_t ** axis,
+                          cmor_var_def_t ** var)
+{
+    int rc = TABLE_SUCCESS;
+
+    switch (kind) {
+      case CACHE_HEADER_ATT:
+          cmor_table_shareable = 0;
+          if (cmor_set_dataset_att(table, name, value) == 1) {
+              rc = TABLE_ERROR;
+          }
+          break;
+      case CACHE_EXPERIMENT:
+          cmor_table_shareable = 0;
+          if (cmor_set_experiments(table, name, value) == 1) {
+              rc = TABLE_ERROR;
+          }
+          break;
+      case CACHE_AXIS_ENTRY:
+          *var = NULL;
+          *axis = cmor_add_axis_entry(table, name);
+          if (*axis == NULL) {
+              rc = TABLE_ERROR;
+          }
+          break;
+      case CACHE_VARIABLE_ENTRY:
+          cmor_table_shareable = 0;
+          *axis = NULL;
+          *var = cmor_add_variable_entry(table, name);
+          if (*var == NULL) {
+              rc = TABLE_ERROR;
+          }
+          break;
+      case CACHE_FORMULA_ENTRY:
+          *axis = NULL;
+          *var = cmor_add_formula_entry(table, name);
+          if (*var == NULL) {
+              rc = TABLE_ERROR;
+          }
+          break;
+      case CACHE_ENTRY_ATT:
+          if (*axis != NULL) {
+              cmor_set_axis_def_att(*axis, name, value);
+          } else if (*var != NULL) {
+              cmor_set_var_def_att(*var, name, value);
+          }
+          break;
+    }
+    return (rc);
+}
+
+/************************************************************************/
+/*                       cmor_merge_duplicates()                        */
+/*                                                                      */
+/*      json-c keeps the last value of a key repeated in an object, in  */
+/*      place of the first.  Of the n entries of size bytes, the first  */
+/*      one of each name found at offset swaps contents with each       */
+/*      later one, so it ends up with the last definition, the one      */
+/*      lookups find.  twin, if any, is swapped alongside.              */
+/************************************************************************/
+void cmor_merge_duplicates(char *entries, char **twin, int n, size_t size,
+                           size_t offset)
+{
+    cmor_table_index_t index;
+    char *swap, *key, *tmp;
+    int i, j;
+
+    if (n < 2) {
+        return;
+    }
+    swap = (char *)malloc(size);
+    if (swap == NULL) {
+        cmor_handle_error("cannot allocate table entry", CMOR_CRITICAL);
+        return;
+    }
+    memset(&index, 0, sizeof(cmor_table_index_t));
+    cmor_build_index(&index, entries, n, size, offset);
+    for (i = 1; i < n; i++) {
+        key = *(char **)(entries + i * size + offset);
+        j = cmor_search_index(&index, entries, n, size, offset, key);
+        if ((j < 0) || (j == i)) {
+            continue;
+        }
+        memcpy(swap, entries + j * size, size);
+        memcpy(entries + j * size, entries + i * size, size);
+        memcpy(entries + i * size, swap, size);
+        if (twin != NULL) {
+            tmp = twin[j];
+            twin[j] = twin[i];
+            twin[i] = tmp;
+        }
+    }
+    cmor_free_index(&index);
+    free(swap);
+}
+
+/************************************************************************/
+/*                     cmor_merge_table_duplicates()                    */
+/*                                                                      */
+/*      Entries and experiments repeated in the table just loaded over  */
+/*      saved, see cmor_merge_duplicates().  Those that were already    */
+/*      in the table are left alone, the first one loaded still wins.   */
+/************************************************************************/
+void cmor_merge_table_duplicates(cmor_table_t * table, cmor_table_t * saved)
+{
+    cmor_merge_duplicates((char *)&table->axes[saved->naxes + 1], NULL,
+                          table->naxes - saved->naxes,
+                          sizeof(cmor_axis_def_t),
+                          offsetof(cmor_axis_def_t, id));
+    cmor_merge_duplicates((char *)&table->vars[saved->nvars + 1], NULL,
+                          table->nvars - saved->nvars,
+                          sizeof(cmor_var_def_t),
+                          offsetof(cmor_var_def_t, id));
+    cmor_merge_duplicates((char *)&table->formula[saved->nformula + 1], NULL,
+                          table->nformula - saved->nformula,
+                          sizeof(cmor_var_def_t),
+                          offsetof(cmor_var_def_t, id));
+    cmor_merge_duplicates((char *)&table->sht_expt_ids[saved->nexps + 1],
+                          &table->expt_ids[saved->nexps + 1],
+                          table->nexps - saved->nexps, sizeof(char *), 0);
+}
+
+/************************************************************************/
+/*                         cmor_rollback_table()                        */
+/*                                                                      */
+/*      Puts back a table saved before a load that failed half way, so  */
+/*      that it holds what it held before.  The entry arrays may have   */
+/*      moved since, they are kept and what the load added to them is   */
+/*      released.                                                       */
+/************************************************************************/
+void cmor_rollback_table(cmor_table_t * table, cmor_table_t * saved)
+{
+    cmor_table_t current;
+    int i, built_CV;
+
+    for (i = saved->naxes + 1; i <= table->naxes; i++) {
+        free(table->axes[i].requested);
+        free(table->axes[i].requested_bounds);
+        free(table->axes[i].crequested);
+        table->axes[i].requested = NULL;
+        table->axes[i].requested_bounds = NULL;
+        table->axes[i].crequested = NULL;
+    }
+/* -------------------------------------------------------------------- */
+/*      a CV built by this load goes, a table's own CV it replaced      */
+/*      cannot come back                                                */
+/* -------------------------------------------------------------------- */
+    built_CV = ((table->CV != NULL) && (table->CV_shared == 0)
+                && ((saved->CV == NULL) || (saved->CV_shared == 1)));
+    if (built_CV == 1) {
+        for (i = 0; i < table->CV->nbObjects; i++) {
+            cmor_CV_free(&table->CV[i]);
+        }
+        free(table->CV);
+        cmor_CV_free_index(&table->CV_index);
+    }
+
+    current = *table;
+    *table = *saved;
+    table->axes = current.axes;
+    table->vars = current.vars;
+    table->formula = current.formula;
+    table->mappings = current.mappings;
+    table->expt_ids = current.expt_ids;
+    table->sht_expt_ids = current.sht_expt_ids;
+    table->axes_allocated = current.axes_allocated;
+    table->vars_allocated = current.vars_allocated;
+    table->formula_allocated = current.formula_allocated;
+    table->mappings_allocated = current.mappings_allocated;
+    table->expts_allocated = current.expts_allocated;
+    table->axes_index = current.axes_index;
+    table->vars_index = current.vars_index;
+    table->out_names_index = current.out_names_index;
+    table->formula_index = current.formula_index;
+    table->forcings = current.forcings;
+    table->nforcings = current.nforcings;
+    table->generic_levels = current.generic_levels;
+    table->generic_levels_allocated = current.generic_levels_allocated;
+    if ((built_CV == 0) && (current.CV != saved->CV)) {
+        table->CV = current.CV;
+        table->CV_index = current.CV_index;
+        table->CV_shared = current.CV_shared;
+    }
+    cmor_index_table(table);
+}
+
+/************************************************************************/
+/*                       cmor_load_table_cache()                        */
+/*                                                                      */
+/*      Maps the compiled copy of a table and replays its records into  */
+/*      the table being loaded.  TABLE_NOTFOUND when there is no cache  */
+/*      or it was not compiled from the table with this md5.            */
+/************************************************************************/
+int cmor_load_table_cache(char *szCache, unsigned char md5[16])
+{
+    extern int cmor_ntables;
+    cmor_table_cache_header_t *header;
+    cmor_table_cache_record_t *records;
+    cmor_table_cache_record_t *record;
+    cmor_axis_def_t *axis = NULL;
+    cmor_var_def_t *var = NULL;
+    cmor_table_t *table;
+    char msg[CMOR_MAX_STRING];
+    char *map, *strings, *name, *value;
+    struct stat st;
+    size_t size;
+    int fd, i, rc, cv_end, corrupt = 0;
+
+    cmor_add_traceback("cmor_load_table_cache");
+
+    fd = open(szCache, O_RDONLY);
+    if (fd < 0) {
+        cmor_pop_traceback();
+        return (TABLE_NOTFOUND);
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < sizeof(*header))) {
+        close(fd);
+        cmor_pop_traceback();
+        return (TABLE_NOTFOUND);
+    }
+    size = st.st_size;
+/* -------------------------------------------------------------------- */
+/*      private writable mapping, the setters may touch their values    */
+/* -------------------------------------------------------------------- */
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cmor_pop_traceback();
+        return (TABLE_NOTFOUND);
+    }
+
+    header = (cmor_table_cache_header_t *) map;
+    records = (cmor_table_cache_record_t *) (map + sizeof(*header));
+    rc = TABLE_SUCCESS;
+    if ((memcmp(header->magic, CMOR_TABLE_CACHE_MAGIC, 8) != 0)
+        || (memcmp(header->md5, md5, 16) != 0)
+        || (header->nrecords < 0) || (header->strings_size < 0)
+        || (size != sizeof(*header)
+            + header->nrecords * sizeof(cmor_table_cache_record_t)
+            + header->strings_size)) {
+        rc = TABLE_NOTFOUND;
+    }
+    strings = NULL;
+    if (rc == TABLE_SUCCESS) {
+        strings = (char *)&records[header->nrecords];
+    }
+/* -------------------------------------------------------------------- */
+/*      a cache that does not hold together is compiled again from the  */
+/*      JSON table                                                      */
+/* -------------------------------------------------------------------- */
+    cv_end = 0;
+    for (i = 0; (i < header->nrecords) && (rc == TABLE_SUCCESS); i++) {
+        if ((records[i].kind < CACHE_HEADER_ATT)
+            || (records[i].kind > CACHE_CV_ITEM)
+            || (records[i].name >= header->strings_size)
+            || (records[i].value >= header->strings_size)) {
+            rc = TABLE_NOTFOUND;
+        } else if (records[i].kind == CACHE_CV_ROOT) {
+            cv_end = cmor_CV_check_cache(records, header->nrecords, i);
+            if (cv_end < 0) {
+                rc = TABLE_NOTFOUND;
+            }
+        } else if ((records[i].kind >= CACHE_CV_NODE) && (i >= cv_end)) {
+            rc = TABLE_NOTFOUND;
+        }
+    }
+    if ((rc == TABLE_SUCCESS) && (header->strings_size > 0)
+        && (strings[header->strings_size - 1] != '\0')) {
+        rc = TABLE_NOTFOUND;
+    }
+    if (rc != TABLE_SUCCESS) {
+        munmap(map, size);
+        cmor_pop_traceback();
+        return (rc);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      same records as cmor_load_table_internal() streams from JSON    */
+/* -------------------------------------------------------------------- */
+    table = &cmor_tables[cmor_ntables];
+    i = 0;
+    while ((i < header->nrecords) && (rc == TABLE_SUCCESS)) {
+        record = &records[i];
+        name = cmor_table_cache_string(strings, record->name);
+        value = cmor_table_cache_string(strings, record->value);
+        switch (record->kind) {
+          case CACHE_HEADER_ATT:
+          case CACHE_EXPERIMENT:
+          case CACHE_AXIS_ENTRY:
+          case CACHE_VARIABLE_ENTRY:
+          case CACHE_FORMULA_ENTRY:
+          case CACHE_ENTRY_ATT:
+              rc = cmor_set_table_record(table, record->kind, name, value,
+                                         &axis, &var);
+              break;
+          case CACHE_CV_ROOT:
+              i = cmor_CV_read_cache_root(records, header->nrecords, i,
+                                          strings);
+              if (i < 0) {
+                  corrupt = 1;
+                  rc = TABLE_ERROR;
+              }
+              continue;
+          default:
+              corrupt = 1;
+              rc = TABLE_ERROR;
+              break;
+        }
+        i++;
+    }
+    munmap(map, size);
+
+    if (corrupt == 1) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "Not enough memory to load table cache %s", szCache);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+    }
+    cmor_pop_traceback();
+    return (rc);
+}
+
+/************************************************************************/
+/*                        cmor_json_skip_space()                        */
+/************************************************************************/
+char *cmor_json_skip_space(char *p)
+{
+    while ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r')) {
+        p++;
+    }
+    return (p);
+}
+
+/************************************************************************/
+/*                       cmor_json_skip_string()                        */
+/*                                                                      */
+/*      End of the JSON string starting at p, NULL if it is truncated.  */
+/************************************************************************/
+char *cmor_json_skip_string(char *p)
+{
+    for (p++; *p != '"'; p++) {
+        if (*p == '\0') {
+            return (NULL);
+        }
+        if ((*p == '\\') && (*++p == '\0')) {
+            return (NULL);
+        }
+    }
+    return (p + 1);
+}
+
+/************************************************************************/
+/*                        cmor_json_skip_value()                        */
+/*                                                                      */
+/*      End of the JSON value starting at p, NULL if it is truncated.   */
+/*      Values are only delimited here, json-c checks what is parsed.   */
+/************************************************************************/
+char *cmor_json_skip_value(char *p)
+{
+    char *start = p;
+    int depth = 0;
+
+    if (*p == '"') {
+        return (cmor_json_skip_string(p));
+    }
+    if ((*p != '{') && (*p != '[')) {
+        while ((*p != '\0') && (strchr(",}] \t\n\r", *p) == NULL)) {
+            p++;
+        }
+        return ((p == start) ? NULL : p);
+    }
+    while (*p != '\0') {
+        if (*p == '"') {
+            p = cmor_json_skip_string(p);
+            if (p == NULL) {
+                return (NULL);
+            }
+            continue;
+        }
+        if ((*p == '{') || (*p == '[')) {
+            depth++;
+        } else if (((*p == '}') || (*p == ']')) && (--depth == 0)) {
+            return (p + 1);
+        }
+        p++;
+    }
+    return (NULL);
+}
+
+/************************************************************************/
+/*                       cmor_json_next_member()                        */
+/*                                                                      */
+/*      Steps *cursor over the next member of the JSON object it points */
+/*      to once *n members have been read.  Returns 1 with the member's */
+/*      key and value, 0 past the closing brace, -1 on a syntax error.  */
+/************************************************************************/
+int cmor_json_next_member(char **cursor, int *n, char key[CMOR_MAX_STRING],
+                          char **value)
+{
+    json_object *json;
+    char *p, *end;
+    int length;
+    char c;
+
+    p = cmor_json_skip_space(*cursor);
+    if (*n == 0) {
+        if (*p != '{') {
+            return (-1);
+        }
+        p = cmor_json_skip_space(p + 1);
+    }
+    if (*p == '}') {
+        *cursor = p + 1;
+        return (0);
+    }
+    if (*n > 0) {
+        if (*p != ',') {
+            return (-1);
+        }
+        p = cmor_json_skip_space(p + 1);
+    }
+    if (*p != '"') {
+        return (-1);
+    }
+    end = cmor_json_skip_string(p);
+    if (end == NULL) {
+        return (-1);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      keys with escapes are left to json-c                            */
+/* -------------------------------------------------------------------- */
+    length = end - p - 2;
+    if (memchr(p + 1, '\\', length) == NULL) {
+        if (length >= CMOR_MAX_STRING) {
+            length = CMOR_MAX_STRING - 1;
+        }
+        memcpy(key, p + 1, length);
+        key[length] = '\0';
+    } else {
+        c = *end;
+        *end = '\0';
+        json = json_tokener_parse(p);
+        *end = c;
+        if (json == NULL) {
+            return (-1);
+        }
+        strncpy(key, json_object_get_string(json), CMOR_MAX_STRING - 1);
+        key[CMOR_MAX_STRING - 1] = '\0';
+        json_object_put(json);
+    }
+
+    p = cmor_json_skip_space(end);
+    if (*p != ':') {
+        return (-1);
+    }
+    p = cmor_json_skip_space(p + 1);
+    end = cmor_json_skip_value(p);
+    if (end == NULL) {
+        return (-1);
+    }
+    *value = p;
+    *cursor = end;
+    (*n)++;
+    return (1);
+}
+
+/************************************************************************/
+/*                       cmor_json_parse_value()                        */
+/*                                                                      */
+/*      json-c object of the JSON value from start to end, which may be */
+/*      NULL for a JSON null.  *ierr is set on a syntax error.          */
+/************************************************************************/
+json_object *cmor_json_parse_value(json_tokener * tok, char *start, char *end,
+                                   int *ierr)
+{
+    json_object *json;
+    char c;
+
+    *ierr = 0;
+/* -------------------------------------------------------------------- */
+/*      most values are plain strings, no need for the tokener          */
+/* -------------------------------------------------------------------- */
+    if ((*start == '"')
+        && (memchr(start + 1, '\\', end - start - 2) == NULL)) {
+        return (json_object_new_string_len(start + 1, end - start - 2));
+    }
+    c = *end;
+    *end = '\0';
+    json_tokener_reset(tok);
+    json = json_tokener_parse_ex(tok, start, -1);
+    *end = c;
+    if (json_tokener_get_error(tok) != json_tokener_success) {
+        if (json != NULL) {
+            json_object_put(json);
+        }
+        *ierr = 1;
+        return (NULL);
+    }
+    return (json);
+}
+
+/************************************************************************/
+/*                     cmor_stream_table_section()                      */
+/*                                                                      */
+/*      Sets the header attributes, experiments or entries of the       */
+/*      JSON section at text section as they are read, and adds them to */
+/*      the cache being built if any.  kind is CACHE_HEADER_ATT,        */
+/*      CACHE_EXPERIMENT or the CACHE_*_ENTRY of the section's entries. */
+/*      Returns 1 if a setter failed, -1 on a syntax error.             */
+/************************************************************************/
+int cmor_stream_table_section(cmor_table_t * table, json_tokener * tok,
+                              char *section, int kind,
+                              cmor_table_cache_builder_t * cache)
+{
+    char name[CMOR_MAX_STRING];
+    char attr[CMOR_MAX_STRING];
+    cmor_axis_def_t *axis = NULL;
+    cmor_var_def_t *var = NULL;
+    json_object *json;
+    const char *szValue;
+    char *cursor, *value, *entry, *attrValue;
+    int n, nattrs, rc, ierr;
+
+    cursor = section;
+    n = 0;
+    while ((rc = cmor_json_next_member(&cursor, &n, name, &value)) == 1) {
+        if (name[0] == '#') {
+            continue;
+        }
+        if ((kind == CACHE_HEADER_ATT) || (kind == CACHE_EXPERIMENT)) {
+            json = cmor_json_parse_value(tok, value, cursor, &ierr);
+            if (ierr != 0) {
+                return (-1);
+            }
+            if (json == NULL) {
+                return (1);
+            }
+            szValue = json_object_get_string(json);
+            cmor_table_cache_add(cache, kind, name, szValue);
+            rc = cmor_set_table_record(table, kind, name, (char *)szValue,
+                                       &axis, &var);
+            json_object_put(json);
+            if (rc != TABLE_SUCCESS) {
+                return (1);
+            }
+            continue;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      one entry, its attributes are set as they are read              */
+/* -------------------------------------------------------------------- */
+        cmor_table_cache_add(cache, kind, name, "");
+        if (cmor_set_table_record(table, kind, name, "", &axis, &var)
+            != TABLE_SUCCESS) {
+            return (1);
+        }
+        entry = value;
+        nattrs = 0;
+        while ((rc = cmor_json_next_member(&entry, &nattrs, attr,
+                                           &attrValue)) == 1) {
+            if (attr[0] == '#') {
+                continue;
+            }
+            json = cmor_json_parse_value(tok, attrValue, entry, &ierr);
+            if (ierr != 0) {
+                return (-1);
+            }
+            if (json == NULL) {
+                return (1);
+            }
+            szValue = json_object_get_string(json);
+            cmor_table_cache_add(cache, CACHE_ENTRY_ATT, attr, szValue);
+            cmor_set_table_record(table, CACHE_ENTRY_ATT, attr,
+                                  (char *)szValue, &axis, &var);
+            json_object_put(json);
+        }
+        if (rc != 0) {
+            return (-1);
+        }
+    }
+    return (rc);
+}
+
+/************************************************************************/
+/*                      cmor_set_mapping_entry()                        */
+/************************************************************************/
+int cmor_set_mapping_entry(cmor_table_t * table, json_object * value)
+{
+    extern int cmor_ntables;
+    char msg[CMOR_MAX_STRING];
+    int n;
+
+    cmor_add_traceback("cmor_set_mapping_entry");
+    table->nmappings++;
+    table->mappings = cmor_grow_registry(table->mappings,
+                                         &table->mappings_allocated,
+                                         table->nmappings,
+                                         sizeof(cmor_mappings_t), 0);
+    if (table->nmappings >= table->mappings_allocated) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "Too many mappings defined for table: %s",
+                 table->szTable_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_ntables--;
+        cmor_pop_traceback();
+        return (TABLE_ERROR);
+    }
+    memset(&table->mappings[table->nmappings], 0, sizeof(cmor_mappings_t));
+    json_object_object_foreach(value, mapname, jsonValue) {
+
+        if (mapname[0] == '#') {
+            continue;
+        }
+        if (mapname == NULL) {
+            return (TABLE_ERROR);
+        }
+
+        char szLastMapID[CMOR_MAX_STRING];
+        char szCurrMapID[CMOR_MAX_STRING];
+        cmor_table_t *psCurrCmorTable;
+
+        psCurrCmorTable = table;
+
+        int nMap;
+        nMap = psCurrCmorTable->nmappings;
+
+        for (n = 0; n < nMap - 1; n++) {
+
+            strcpy(szLastMapID, psCurrCmorTable->mappings[nMap].id);
+            strcpy(szCurrMapID, psCurrCmorTable->mappings[n].id);
+
+            if (strcmp(szLastMapID, szCurrMapID) == 0) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "mapping: %s already defined within this table (%s)",
+                         table->mappings[n].id, table->szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+            };
+        }
+/* -------------------------------------------------------------------- */
+/*      init the variable def                                           */
+/* -------------------------------------------------------------------- */
+        cmor_init_grid_mapping(&psCurrCmorTable->mappings[nMap],
+                               mapname);
+        json_object_object_foreach(jsonValue, key, mappar) {
+
+            if (key[0] == '#') {
+                continue;
+            }
+            if (mapname == NULL) {
+                return (TABLE_ERROR);
+            }
+
+            char param[CMOR_MAX_STRING];
+
+            strcpy(param, json_object_get_string(mappar));
+
+            cmor_set_mapping_attribute(&psCurrCmorTable->mappings
+                                       [psCurrCmorTable->nmappings],
+                                       key, param);
+
+        }
+
+    }
+    cmor_pop_traceback();
+    return (TABLE_SUCCESS);
+}
+
+/************************************************************************/
+/*                   cmor_load_table_internal()                         */
+/************************************************************************/
+int cmor_load_table_internal(char szTable[CMOR_MAX_STRING], int *table_id)
+{
+    FILE *table_file;
+    char word[CMOR_MAX_STRING];
+    int n;
+    extern int CMOR_TABLE, cmor_ntables;
+    extern char cmor_input_path[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    char key[CMOR_MAX_STRING];
+    char *buffer = NULL;
+    char *cursor, *value;
+    int nTableSize, read_size;
+    json_object *json_obj;
+    json_tokener *tok;
+    cmor_table_t *table;
+    cmor_table_t saved;
+    cmor_table_cache_builder_t cache;
+    cmor_table_cache_builder_t *pCache;
+    char szCache[CMOR_MAX_STRING];
+    int cacheable = 1;
+    int rc, ierr;
+
+    cmor_add_traceback("cmor_load_table_internal");
+    cmor_is_setup();
+    cmor_table_shareable = 1;
+
+    table_file = fopen(szTable, "r");
+    if (table_file == NULL) {
+        if (szTable[0] != '/') {
+            snprintf(word, CMOR_MAX_STRING, "%s/%s", cmor_input_path, szTable);
+            table_file = fopen(word, "r");
+        }
+        if (table_file == NULL) {
+            snprintf(word, CMOR_MAX_STRING, "%s/share/%s", CMOR_PREFIX,
+                     szTable);
+            table_file = fopen(word, "r");
+        }
+        if (table_file == NULL) {
             snprintf(word, CMOR_MAX_STRING, "Could not find file: %s", szTable);
             cmor_handle_error(word, CMOR_NORMAL);
             cmor_ntables -= 1;
@@ -712,6 +2271,33 @@ int cmor_load_table_internal(char szTable[CMOR_MAX_STRING], int *table_id)
 /* -------------------------------------------------------------------- */
     cmor_md5(table_file, cmor_tables[cmor_ntables].md5);
 
+/* -------------------------------------------------------------------- */
+/*      what the table held before, for a load that fails half way      */
+/* -------------------------------------------------------------------- */
+    table = &cmor_tables[cmor_ntables];
+    saved = *table;
+
+/* -------------------------------------------------------------------- */
+/*      replay the compiled copy of this version of the table if any    */
+/* -------------------------------------------------------------------- */
+    szCache[0] = '\0';
+    if (cmor_get_table_cache_path(szTable, szCache) == 0) {
+        rc = cmor_load_table_cache(szCache, table->md5);
+        if (rc != TABLE_NOTFOUND) {
+            fclose(table_file);
+            if (rc == TABLE_SUCCESS) {
+                cmor_merge_table_duplicates(table, &saved);
+                cmor_index_table(table);
+                *table_id = cmor_ntables;
+                CMOR_TABLE = cmor_ntables;
+            } else {
+                cmor_rollback_table(table, &saved);
+            }
+            cmor_pop_traceback();
+            return (rc);
+        }
+    }
+
 /* -------------------------------------------------------------------- */
 /*      Read the entire table in memory                                 */
 /* -------------------------------------------------------------------- */
@@ -752,229 +2338,112 @@ int cmor_load_table_internal(char szTable[CMOR_MAX_STRING], int *table_id)
     }
 
 /* -------------------------------------------------------------------- */
-/*     parse buffer into json object                                    */
+/*      stream the sections into the table, json-c only parses the      */
+/*      values that are stored so the file is never held as a tree     */
 /* -------------------------------------------------------------------- */
-    json_obj = json_tokener_parse(buffer);
-    if (json_obj == NULL) {
-        snprintf(msg, CMOR_MAX_STRING,
-                 "Please validate JSON File!\n"
-                 "USE: http://jsonlint.com/\n"
-                 "Syntax Error in table: %s\n " "%s", szTable, buffer);
-        cmor_handle_error(msg, CMOR_CRITICAL);
-        cmor_pop_traceback();
-        return (TABLE_ERROR);
-    }
-
-    json_object_object_foreach(json_obj, key, value) {
+    memset(&cache, 0, sizeof(cmor_table_cache_builder_t));
+    pCache = (szCache[0] != '\0') ? &cache : NULL;
+    tok = json_tokener_new();
+    cursor = buffer;
+    n = 0;
+    while ((ierr = cmor_json_next_member(&cursor, &n, key, &value)) == 1) {
 
         if (key[0] == '#') {
             continue;
         }
-        if (value == 0) {
-            return (TABLE_ERROR);
-        }
-        strcpy(szVal, json_object_get_string(value));
 /* -------------------------------------------------------------------- */
 /*      Now let's see what we found                                     */
 /* -------------------------------------------------------------------- */
         if (strcmp(key, JSON_KEY_HEADER) == 0) {
-/* -------------------------------------------------------------------- */
-/*      Fill up all global attributer found in header section           */
-/* -------------------------------------------------------------------- */
-            json_object_object_foreach(value, key, globalAttr) {
-                if (key[0] == '#') {
-                    continue;
-                }
-                if (globalAttr == NULL) {
-                    return (TABLE_ERROR);
-                }
-                strcpy(szVal, json_object_get_string(globalAttr));
-                if (cmor_set_dataset_att(&cmor_tables[cmor_ntables], key,
-                                         szVal) == 1) {
-                    cmor_pop_traceback();
-                    return (TABLE_ERROR);
-                }
-            }
-            done = 1;
-
+            cmor_table_shareable = 0;
+            ierr = cmor_stream_table_section(table, tok, value,
+                                             CACHE_HEADER_ATT, pCache);
         } else if (strcmp(key, JSON_KEY_EXPERIMENT) == 0) {
-            json_object_object_foreach(value, shortname, experiment) {
-                if (shortname[0] == '#') {
-                    continue;
-                }
-                if (experiment == NULL) {
-                    return (TABLE_ERROR);
-                }
-
-                strcpy(szVal, json_object_get_string(experiment));
-                if (cmor_set_experiments(&cmor_tables[cmor_ntables],
-                                         shortname, szVal) == 1) {
-                    cmor_pop_traceback();
-                    return (TABLE_ERROR);
-                }
-            }
-            done = 1;
+            cmor_table_shareable = 0;
+            ierr = cmor_stream_table_section(table, tok, value,
+                                             CACHE_EXPERIMENT, pCache);
         } else if (strcmp(key, JSON_KEY_AXIS_ENTRY) == 0) {
-            json_object_object_foreach(value, axisname, attributes) {
-
-                if (axisname[0] == '#') {
-                    continue;
-                }
-                if (attributes == NULL) {
-                    return (TABLE_ERROR);
-                }
-                if (cmor_set_axis_entry(&cmor_tables[cmor_ntables],
-                                        axisname, attributes) == 1) {
-                    cmor_pop_traceback();
-                    return (TABLE_ERROR);
-                }
-            }
-            done = 1;
+            ierr = cmor_stream_table_section(table, tok, value,
+                                             CACHE_AXIS_ENTRY, pCache);
         } else if (strcmp(key, JSON_KEY_FORMULA_ENTRY) == 0) {
-            json_object_object_foreach(value, formulaname, attributes) {
-
-                if (formulaname[0] == '#') {
-                    continue;
-                }
-                if (attributes == NULL) {
-                    return (TABLE_ERROR);
-                }
-                if (cmor_set_formula_entry(&cmor_tables[cmor_ntables],
-                                           formulaname, attributes) == 1) {
-                    cmor_pop_traceback();
-                    return (TABLE_ERROR);
-                }
-            }
-            done = 1;
+            ierr = cmor_stream_table_section(table, tok, value,
+                                             CACHE_FORMULA_ENTRY, pCache);
         } else if (strcmp(key, JSON_KEY_VARIABLE_ENTRY) == 0) {
-            json_object_object_foreach(value, varname, attributes) {
-
-                if (varname[0] == '#') {
-                    continue;
-                }
-                if (attributes == NULL) {
-                    return (TABLE_ERROR);
-                }
-                if (cmor_set_variable_entry(&cmor_tables[cmor_ntables],
-                                            varname, attributes) == 1) {
-                    cmor_pop_traceback();
-                    return (TABLE_ERROR);
-                }
-            }
-            done = 1;
+            cmor_table_shareable = 0;
+            ierr = cmor_stream_table_section(table, tok, value,
+                                             CACHE_VARIABLE_ENTRY, pCache);
         } else if (strncmp(key, JSON_KEY_CV_ENTRY, 2) == 0) {
-
-            if (cmor_CV_set_entry(&cmor_tables[cmor_ntables], value) == 1) {
-                cmor_pop_traceback();
-                return (TABLE_ERROR);
+            ierr = cmor_CV_stream_entry(table, tok, value);
+            if (ierr == 0) {
+                cmor_CV_write_cache_root(pCache, table->CV);
             }
-            done = 1;
-
-        } else if (strcmp(key, JSON_KEY_MAPPING_ENTRY) == 0) {
+        } else {
+/* -------------------------------------------------------------------- */
+/*      other sections are small enough to be parsed whole              */
 /* -------------------------------------------------------------------- */
-/*      Work on mapping entries                                         */
+            cmor_table_shareable = 0;
+            cacheable = 0;
+            json_obj = cmor_json_parse_value(tok, value, cursor, &ierr);
+            if (ierr != 0) {
+                ierr = -1;
+            } else if (strcmp(key, JSON_KEY_MAPPING_ENTRY) == 0) {
+                ierr = cmor_set_mapping_entry(table, json_obj);
+            } else {
+/* -------------------------------------------------------------------- */
+/*      nothing known we will not be setting any attributes!            */
 /* -------------------------------------------------------------------- */
-            cmor_tables[cmor_ntables].nmappings++;
-            if (cmor_tables[cmor_ntables].nmappings >= CMOR_MAX_ELEMENTS) {
                 snprintf(msg, CMOR_MAX_STRING,
-                         "Too many mappings defined for table: %s",
+                         "unknown section: %s, for table: %s", key,
                          cmor_tables[cmor_ntables].szTable_id);
-                cmor_handle_error(msg, CMOR_CRITICAL);
-                cmor_ntables--;
-                cmor_pop_traceback();
-                return (TABLE_ERROR);
+                cmor_handle_error(msg, CMOR_WARNING);
+                snprintf(msg, CMOR_MAX_STRING,
+                         "attribute for unknown section: %s,%s (table: %s)",
+                         key, json_object_get_string(json_obj),
+                         cmor_tables[cmor_ntables].szTable_id);
+                cmor_handle_error(msg, CMOR_WARNING);
             }
-            json_object_object_foreach(value, mapname, jsonValue) {
-
-                if (mapname[0] == '#') {
-                    continue;
-                }
-                if (mapname == NULL) {
-                    return (TABLE_ERROR);
-                }
-
-                char szLastMapID[CMOR_MAX_STRING];
-                char szCurrMapID[CMOR_MAX_STRING];
-                cmor_table_t *psCurrCmorTable;
-
-                psCurrCmorTable = &cmor_tables[cmor_ntables];
-
-                int nMap;
-                nMap = psCurrCmorTable->nmappings;
-
-                for (n = 0; n < nMap - 1; n++) {
-
-                    strcpy(szLastMapID, psCurrCmorTable->mappings[nMap].id);
-                    strcpy(szCurrMapID, psCurrCmorTable->mappings[n].id);
-
-                    if (strcmp(szLastMapID, szCurrMapID) == 0) {
-                        snprintf(msg, CMOR_MAX_STRING,
-                                 "mapping: %s already defined within this table (%s)",
-                                 cmor_tables[cmor_ntables].mappings[n].id,
-                                 cmor_tables[cmor_ntables].szTable_id);
-                        cmor_handle_error(msg, CMOR_CRITICAL);
-                    };
-                }
-/* -------------------------------------------------------------------- */
-/*      init the variable def                                           */
-/* -------------------------------------------------------------------- */
-                cmor_init_grid_mapping(&psCurrCmorTable->mappings[nMap],
-                                       mapname);
-                json_object_object_foreach(jsonValue, key, mappar) {
-
-                    if (key[0] == '#') {
-                        continue;
-                    }
-                    if (mapname == NULL) {
-                        return (TABLE_ERROR);
-                    }
-
-                    char param[CMOR_MAX_STRING];
-
-                    strcpy(param, json_object_get_string(mappar));
-
-                    cmor_set_mapping_attribute(&psCurrCmorTable->mappings
-                                               [psCurrCmorTable->nmappings],
-                                               key, param);
-
-                }
-
+            if (json_obj != NULL) {
+                json_object_put(json_obj);
             }
-            done = 1;
-
-        } else {
-/* -------------------------------------------------------------------- */
-/*      nothing known we will not be setting any attributes!            */
-/* -------------------------------------------------------------------- */
-
-            snprintf(msg, CMOR_MAX_STRING,
-                     "unknown section: %s, for table: %s", key,
-                     cmor_tables[cmor_ntables].szTable_id);
-            cmor_handle_error(msg, CMOR_WARNING);
         }
+        if (ierr != 0) {
+            break;
+        }
+    }
+    json_tokener_free(tok);
 
-/* -------------------------------------------------------------------- */
-/*      First check for table/dataset mode values                       */
-/* -------------------------------------------------------------------- */
-
-        if (done == 1) {
-            done = 0;
-        } else {
+    if (ierr != 0) {
+        cmor_rollback_table(table, &saved);
+        free(cache.records);
+        free(cache.strings);
+        if (ierr < 0) {
             snprintf(msg, CMOR_MAX_STRING,
-                     "attribute for unknown section: %s,%s (table: %s)",
-                     key, szVal, cmor_tables[cmor_ntables].szTable_id);
-            cmor_handle_error(msg, CMOR_WARNING);
-            /*printf("attribute for unknown section\n"); */
+                     "Please validate JSON File!\n"
+                     "USE: http://jsonlint.com/\n"
+                     "Syntax Error in table: %s\n " "%s", szTable, buffer);
+            cmor_handle_error(msg, CMOR_CRITICAL);
         }
+        free(buffer);
+        fclose(table_file);
+        cmor_pop_traceback();
+        return (TABLE_ERROR);
     }
+
+    cmor_merge_table_duplicates(table, &saved);
+    cmor_index_table(table);
     *table_id = cmor_ntables;
     CMOR_TABLE = cmor_ntables;
+    if ((cacheable == 1) && (pCache != NULL)) {
+        cmor_write_table_cache(szCache, cmor_tables[cmor_ntables].md5,
+                               pCache);
+    }
+    free(cache.records);
+    free(cache.strings);
     if (table_file != NULL) {
         fclose(table_file);
         table_file = NULL;
     }
     cmor_pop_traceback();
     free(buffer);
-    json_object_put(json_obj);
     return (TABLE_SUCCESS);
 }
@@ -7,6 +7,13 @@
 #include <stdlib.h>
 #include <math.h>
 #include <signal.h>
+#include <stdint.h>
+#include <limits.h>
+#include <float.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CMOR_X86_SIMD
+#include <immintrin.h>
+#endif
 
 float fvalue;
 
@@ -58,7 +65,6 @@ int cmor_is_required_variable_attribute(cmor_var_def_t var,
 /************************************************************************/
 int cmor_has_required_variable_attributes(int var_id)
 {
-    extern cmor_var_t cmor_vars[];
     char astr[CMOR_MAX_STRING];
     char msg[CMOR_MAX_STRING];
     int i, j;
@@ -68,7 +74,8 @@ int cmor_has_required_variable_attributes(int var_id)
     cmor_add_traceback("cmor_has_required_variable_attributes");
 
     pTable = &cmor_tables[cmor_vars[var_id].ref_table_id];
-    var = pTable->vars[cmor_vars[var_id].ref_var_id];
+    var = *cmor_get_var_def(cmor_vars[var_id].ref_table_id,
+                            cmor_vars[var_id].ref_var_id);
 
     if (var.required[0] == '\0') {
         cmor_pop_traceback();
@@ -117,7 +124,6 @@ int cmor_has_required_variable_attributes(int var_id)
 int cmor_set_variable_attribute_internal(int id, char *attribute_name,
                                          char type, void *value)
 {
-    extern cmor_var_t cmor_vars[];
     int i, index;
     char msg[CMOR_MAX_STRING];
 
@@ -136,21 +142,22 @@ int cmor_set_variable_attribute_internal(int id, char *attribute_name,
     if (index == -1) {
         index = cmor_vars[id].nattributes;
         cmor_vars[id].nattributes += 1;
+        cmor_vars[id].attributes_values_char[index] = cmor_intern("");
     }
 
     /*stores the name */
 
-    strncpy(cmor_vars[id].attributes[index], msg, CMOR_MAX_STRING);
+    cmor_vars[id].attributes[index] = cmor_intern(msg);
 
     cmor_vars[id].attributes_type[index] = type;
     cmor_vars[id].attributes_values_num[index] = (double)*(float *)value;
     if (type == 'c') {
 
         if (strlen(value) > 0) {
-            strncpytrim(cmor_vars[id].attributes_values_char[index], value,
-                        CMOR_MAX_STRING);
+            strncpytrim(msg, value, CMOR_MAX_STRING);
+            cmor_vars[id].attributes_values_char[index] = cmor_intern(msg);
         } else {
-            strcpy(cmor_vars[id].attributes[index], "");
+            cmor_vars[id].attributes[index] = cmor_intern("");
         }
 
     } else if (type == 'f') {
@@ -196,8 +203,10 @@ int cmor_set_variable_attribute(int id, char *attribute_name, char type,
                                 void *value)
 {
     char msg[CMOR_MAX_STRING];
+    int ierr;
 
     cmor_add_traceback("cmor_set_variable_attribute");
+    cmor_lock();
 
 /* -------------------------------------------------------------------- */
 /*       First of all we need to see if it is not one of the args       */
@@ -223,6 +232,7 @@ int cmor_set_variable_attribute(int id, char *attribute_name, char type,
                  attribute_name, cmor_vars[id].id,
                  cmor_tables[cmor_vars[id].ref_table_id].szTable_id);
         cmor_handle_error_var(msg, CMOR_NORMAL, id);
+        cmor_unlock();
         cmor_pop_traceback();
         return (1);
     }
@@ -239,12 +249,15 @@ int cmor_set_variable_attribute(int id, char *attribute_name, char type,
                  attribute_name, cmor_vars[id].id,
                  cmor_tables[cmor_vars[id].ref_table_id].szTable_id);
         cmor_handle_error_var(msg, CMOR_NORMAL, id);
+        cmor_unlock();
         cmor_pop_traceback();
         return (1);
     }
+    ierr = cmor_set_variable_attribute_internal(id, attribute_name, type,
+                                                value);
+    cmor_unlock();
     cmor_pop_traceback();
-    return (cmor_set_variable_attribute_internal(id, attribute_name, type,
-                                                 value));
+    return (ierr);
 }
 
 /************************************************************************/
@@ -252,7 +265,6 @@ int cmor_set_variable_attribute(int id, char *attribute_name, char type,
 /************************************************************************/
 int cmor_get_variable_attribute(int id, char *attribute_name, void *value)
 {
-    extern cmor_var_t cmor_vars[];
     int i, index;
     char msg[CMOR_MAX_STRING];
     char type;
@@ -296,7 +308,6 @@ int cmor_get_variable_attribute(int id, char *attribute_name, void *value)
 /************************************************************************/
 int cmor_has_variable_attribute(int id, char *attribute_name)
 {
-    extern cmor_var_t cmor_vars[];
     int i, index;
     char type;
     char msg[CMOR_MAX_STRING];
@@ -335,7 +346,6 @@ int cmor_get_variable_attribute_names(int id, int *nattributes,
                                       char attributes_names[]
                                       [CMOR_MAX_STRING])
 {
-    extern cmor_var_t cmor_vars[];
     int i;
 
     cmor_add_traceback("cmor_get_variable_attribute_names");
@@ -355,7 +365,6 @@ int cmor_get_variable_attribute_names(int id, int *nattributes,
 int cmor_get_variable_attribute_type(int id, char *attribute_name, char *type)
 {
 
-    extern cmor_var_t cmor_vars[];
     int i, index;
     char msg[CMOR_MAX_STRING];
 
@@ -388,9 +397,9 @@ int cmor_get_variable_attribute_type(int id, char *attribute_name, char *type)
 /************************************************************************/
 /*                            cmor_zfactor()                            */
 /************************************************************************/
-int cmor_zfactor(int *zvar_id, int axis_id, char *name, char *units,
-                 int ndims, int axes_ids[], char type, void *values,
-                 void *bounds)
+static int cmor_zfactor_internal(int *zvar_id, int axis_id, char *name,
+                                 char *units, int ndims, int axes_ids[],
+                                 char type, void *values, void *bounds)
 {
 
     extern int cmor_nvars;
@@ -972,6 +981,22 @@ int cmor_zfactor(int *zvar_id, int axis_id, char *name, char *units,
     return (stop);
 }
 
+/************************************************************************/
+/*                            cmor_zfactor()                            */
+/************************************************************************/
+int cmor_zfactor(int *zvar_id, int axis_id, char *name, char *units,
+                 int ndims, int axes_ids[], char type, void *values,
+                 void *bounds)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_zfactor_internal(zvar_id, axis_id, name, units, ndims,
+                                 axes_ids, type, values, bounds);
+    cmor_unlock();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                        cmor_update_history()                         */
 /************************************************************************/
@@ -1027,15 +1052,15 @@ int cmor_history_contains(int var_id, char *add)
 /************************************************************************/
 /*                           cmor_variable()                            */
 /************************************************************************/
-int cmor_variable(int *var_id, char *name, char *units, int ndims,
-                  int axes_ids[], char type, void *missing,
-                  double *tolerance, char *positive, char *original_name,
-                  char *history, char *comment)
+static int cmor_variable_internal(int *var_id, char *name, char *units,
+                                  int ndims, int axes_ids[], char type,
+                                  void *missing, double *tolerance,
+                                  char *positive, char *original_name,
+                                  char *history, char *comment)
 {
 
     extern int cmor_nvars, cmor_naxes;
     extern int CMOR_TABLE;
-    extern cmor_var_t cmor_vars[];
 
     int i, iref, j, k, l;
     char msg[CMOR_MAX_STRING];
@@ -1057,12 +1082,6 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
         cmor_handle_error("You did not define a table yet!", CMOR_CRITICAL);
     }
 
-    if (cmor_nvars == CMOR_MAX_VARIABLES - 1) {
-        cmor_handle_error("Too many variables defined", CMOR_CRITICAL);
-        cmor_pop_traceback();
-        return (1);
-    }
-
 /* -------------------------------------------------------------------- */
 /*      ok now look which variable is corresponding in table if not     */
 /*      found then error                                                */
@@ -1070,20 +1089,11 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
     iref = -1;
     cmor_trim_string(name, ctmp);
     if ((comment != NULL) && strcmp(comment, COMMENT_VARIABLE_ZFACTOR) == 0) {
-        for (i = 0; i < cmor_tables[CMOR_TABLE].nformula + 1; i++) {
-            if (strcmp(cmor_tables[CMOR_TABLE].formula[i].id, ctmp) == 0) {
-                iref = i + CMOR_MAX_ELEMENTS;
-                break;
-            }
-        }
-
+        i = cmor_get_table_formula_id(CMOR_TABLE, ctmp);
+        if (i != -1)
+            iref = i + CMOR_MAX_ELEMENTS;
     } else {
-        for (i = 0; i < cmor_tables[CMOR_TABLE].nvars + 1; i++) {
-            if (strcmp(cmor_tables[CMOR_TABLE].vars[i].id, ctmp) == 0) {
-                iref = i;
-                break;
-            }
-        }
+        iref = cmor_get_table_var_id(CMOR_TABLE, ctmp);
     }
 
     if (iref == -1) {
@@ -1092,17 +1102,11 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
         cmor_handle_error(msg, CMOR_CRITICAL);
     }
 
-    if (iref > CMOR_MAX_ELEMENTS) {
-        refvar = cmor_tables[CMOR_TABLE].formula[iref - CMOR_MAX_ELEMENTS];
-    } else {
-        refvar = cmor_tables[CMOR_TABLE].vars[iref];
-
-    }
-    for (i = 0; i < CMOR_MAX_VARIABLES; i++) {
-        if (cmor_vars[i].self == -1) {
-            vrid = i;
-            break;
-        }
+    refvar = *cmor_get_var_def(CMOR_TABLE, iref);
+    vrid = cmor_get_free_variable();
+    if (vrid == -1) {
+        cmor_pop_traceback();
+        return (1);
     }
 
     if (vrid > cmor_nvars)
@@ -1349,19 +1353,9 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
     k = 0;
     for (i = 0; i < refvar.ndims; i++) {
 
-        for (j = 0; j < cmor_tables[cmor_vars[vrid].ref_table_id].naxes; j++) {
-
-            if (strcmp
-                (cmor_tables[cmor_vars[vrid].ref_table_id].axes
-                 [refvar.dimensions[i]].id,
-                 cmor_tables[cmor_vars[vrid].ref_table_id].axes[j].id) == 0) {
-
-                if (cmor_tables[cmor_vars[vrid].ref_table_id].axes
-                    [refvar.dimensions[i]].must_call_cmor_grid == 1)
-                    k = 1;
-                break;
-            }
-        }
+        if (cmor_get_axis_def(cmor_vars[vrid].ref_table_id,
+                              refvar.dimensions[i])->must_call_cmor_grid == 1)
+            k = 1;
     }
 
 /* -------------------------------------------------------------------- */
@@ -1425,13 +1419,13 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
 /* -------------------------------------------------------------------- */
             k = 0;
             for (j = 0; j < refvar.ndims; j++) {
-                if (strcmp
-                    (cmor_tables[refvar.table_id].axes[refvar.dimensions[j]].id,
-                     DIMENSION_LONGITUDE) == 0)
+                if (strcmp(cmor_get_axis_def(refvar.table_id,
+                                             refvar.dimensions[j])->id,
+                           DIMENSION_LONGITUDE) == 0)
                     k++;
-                if (strcmp
-                    (cmor_tables[refvar.table_id].axes[refvar.dimensions[j]].id,
-                     DIMENSION_LATITUDE) == 0)
+                if (strcmp(cmor_get_axis_def(refvar.table_id,
+                                             refvar.dimensions[j])->id,
+                           DIMENSION_LATITUDE) == 0)
                     k++;
                 if (refvar.dimensions[j] == -CMOR_MAX_GRIDS)
                     k++;
@@ -1472,8 +1466,8 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
 
         j = refvar.ndims - olndims + aint;
         for (i = 0; i < refvar.ndims; i++) {
-            if (cmor_tables[CMOR_TABLE].axes[refvar.dimensions[i]].value
-                != 1.e20) {
+            if (cmor_get_axis_def(CMOR_TABLE, refvar.dimensions[i])->value !=
+                1.e20) {
 /* -------------------------------------------------------------------- */
 /*      ok it could be a dummy but we need to check if the user         */
 /*      already defined this dummy dimension or notd                    */
@@ -1492,9 +1486,9 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
                     }
 
                     if (strcmp(msg,
-                               cmor_tables[CMOR_TABLE].
-                               axes[refvar.dimensions[i]].standard_name)
-                        == 0) {
+                               cmor_get_axis_def(CMOR_TABLE,
+                                                 refvar.dimensions[i])->
+                               standard_name) == 0) {
 /* -------------------------------------------------------------------- */
 /*       ok user did define this one on its own                         */
 /* -------------------------------------------------------------------- */
@@ -1515,7 +1509,7 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
 /*      of the axes                                                     */
 /* -------------------------------------------------------------------- */
                     cmor_axis_def_t *pAxis;
-                    pAxis = &cmor_tables[CMOR_TABLE].axes[refvar.dimensions[i]];
+                    pAxis = cmor_get_axis_def(CMOR_TABLE, refvar.dimensions[i]);
 
                     if (pAxis->bounds_value[0] != 1.e20) {
 
@@ -1584,7 +1578,8 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
             if ((strcmp
                  (cmor_tables[cmor_axes[laxes_ids[i]].ref_table_id].axes
                   [cmor_axes[laxes_ids[i]].ref_axis_id].id,
-                  cmor_tables[CMOR_TABLE].axes[refvar.dimensions[j]].id) == 0)
+                  cmor_get_axis_def(CMOR_TABLE,
+                                    refvar.dimensions[j])->id) == 0)
                 ||
                 ((cmor_tables[cmor_axes[laxes_ids[i]].ref_table_id].axes
                   [cmor_axes[laxes_ids[i]].ref_axis_id].axis == 'Z')
@@ -1615,7 +1610,7 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
                      axes[cmor_axes[laxes_ids[i]].ref_axis_id].id);
             for (i = 0; i < refvar.ndims; i++) {
                 strcat(msg,
-                       cmor_tables[CMOR_TABLE].axes[refvar.dimensions[i]].id);
+                       cmor_get_axis_def(CMOR_TABLE, refvar.dimensions[i])->id);
                 strcat(msg, " ");
             }
             strcat(msg, ")");
@@ -1695,12 +1690,13 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
 
     for (i = 0; i < lndims; i++) {
 
-        if (((strcmp(cmor_tables[refvar.table_id].axes[refvar.dimensions[i]].id,
+        if (((strcmp(cmor_get_axis_def(refvar.table_id,
+                                       refvar.dimensions[i])->id,
                      "latitude") == 0)
              ||
-             (strcmp
-              (cmor_tables[refvar.table_id].axes[refvar.dimensions[i]].id,
-               "longitude") == 0)) && (grid_id != 1000)) {
+             (strcmp(cmor_get_axis_def(refvar.table_id,
+                                       refvar.dimensions[i])->id,
+                     "longitude") == 0)) && (grid_id != 1000)) {
 
 /* -------------------------------------------------------------------- */
 /*      ok we are  dealing with a "grid" type of data                   */
@@ -1714,8 +1710,9 @@ int cmor_variable(int *var_id, char *name, char *units, int ndims,
             }
             did_grid_reorder = 1;
         } else if ((refvar.dimensions[i] == -2)
-                   || (cmor_tables[CMOR_TABLE].axes[refvar.dimensions[i]].value
-                       == 1.e20)) {
+                   || (cmor_get_axis_def(CMOR_TABLE,
+                                         refvar.dimensions[i])->value ==
+                       1.e20)) {
 /* -------------------------------------------------------------------- */
 /*      not a singleton dim                                             */
 /* -------------------------------------------------------------------- */
@@ -1855,20 +1852,22 @@ void cmor_init_var_def(cmor_var_def_t * var, int table_id)
 
     cmor_is_setup();
     var->table_id = table_id;
-    var->standard_name[0] = '\0';
-    var->units[0] = '\0';
-    var->cell_methods[0] = '\0';
-    var->cell_measures[0] = '\0';
+    var->id = cmor_intern("");
+    var->required = cmor_intern("");
+    var->standard_name = cmor_intern("");
+    var->units = cmor_intern("");
+    var->cell_methods = cmor_intern("");
+    var->cell_measures = cmor_intern("");
     var->positive = '\0';
-    var->long_name[0] = '\0';
-    var->comment[0] = '\0';
-    var->realm[0] = '\0';
-    var->frequency[0] = '\0';
-    var->out_name[0] = '\0';
+    var->long_name = cmor_intern("");
+    var->comment = cmor_intern("");
+    var->realm = cmor_intern("");
+    var->frequency = cmor_intern("");
+    var->out_name = cmor_intern("");
     var->ndims = 0;
-    var->flag_values[0] = '\0';
-    var->flag_meanings[0] = '\0';
-    var->chunking_dimensions[0] = '\0';
+    var->flag_values = cmor_intern("");
+    var->flag_meanings = cmor_intern("");
+    var->chunking_dimensions = cmor_intern("");
     for (n = 0; n < CMOR_MAX_DIMENSIONS; n++)
         var->dimensions[n] = -1;
     var->type = 'f';
@@ -1881,6 +1880,24 @@ void cmor_init_var_def(cmor_var_def_t * var, int table_id)
     var->deflate_level = 1;
 }
 
+/************************************************************************/
+/*                           cmor_variable()                            */
+/************************************************************************/
+int cmor_variable(int *var_id, char *name, char *units, int ndims,
+                  int axes_ids[], char type, void *missing,
+                  double *tolerance, char *positive, char *original_name,
+                  char *history, char *comment)
+{
+    int ierr;
+
+    cmor_lock();
+    ierr = cmor_variable_internal(var_id, name, units, ndims, axes_ids, type,
+                                  missing, tolerance, positive, original_name,
+                                  history, comment);
+    cmor_unlock();
+    return (ierr);
+}
+
 /************************************************************************/
 /*                        cmor_set_var_def_att()                        */
 /************************************************************************/
@@ -1900,23 +1917,23 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
     }
     if (strcmp(att, VARIABLE_ATT_REQUIRED) == 0) {
 
-        strncpy(var->required, val, CMOR_MAX_STRING);
+        var->required = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_ID) == 0) {
 
-        strncpy(var->id, val, CMOR_MAX_STRING);
+        var->id = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_STANDARDNAME) == 0) {
 
-        strncpy(var->standard_name, val, CMOR_MAX_STRING);
+        var->standard_name = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_LONGNAME) == 0) {
 
-        strncpy(var->long_name, val, CMOR_MAX_STRING);
+        var->long_name = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_COMMENT) == 0) {
 
-        strncpy(var->comment, val, CMOR_MAX_STRING);
+        var->comment = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_DIMENSIONS) == 0) {
 
@@ -1943,21 +1960,14 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
 /* -------------------------------------------------------------------- */
 /*      check that the dimension as been defined in the table           */
 /* -------------------------------------------------------------------- */
-            n = -1;             /* not found yet */
-            for (j = 0; j <= cmor_tables[var->table_id].naxes; j++) {
-                if (strcmp(dim, cmor_tables[var->table_id].axes[j].id) == 0) {
-                    n = j;
-                    break;
-                }
-            }
+            n = cmor_get_table_axis_id(var->table_id, dim);
 
             if (n == -1) {
                 j = strcmp(DIMENSION_ZLEVEL, dim);
                 j *= strcmp(DIMENSION_ALEVEL, dim);
                 j *= strcmp(DIMENSION_OLEVEL, dim);
-                for (k = 0; k < CMOR_MAX_ELEMENTS; k++) {
-                    if (cmor_tables[var->table_id].generic_levels[k][0] == '\0')
-                        break;
+                for (k = 0; k < cmor_tables[var->table_id].ngeneric_levels;
+                     k++) {
                     j *= strcmp(dim,
                                 cmor_tables[var->table_id].generic_levels[k]);
                 }
@@ -2002,19 +2012,19 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
 
     } else if (strcmp(att, VARIABLE_ATT_UNITS) == 0) {
 
-        strncpy(var->units, val, CMOR_MAX_STRING);
+        var->units = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_CELLMETHODS) == 0) {
 
-        strncpy(var->cell_methods, val, CMOR_MAX_STRING);
+        var->cell_methods = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_EXTCELLMEASURES) == 0) {
 
-        strncpy(var->cell_measures, val, CMOR_MAX_STRING);
+        var->cell_measures = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_CELLMEASURES) == 0) {
 
-        strncpy(var->cell_measures, val, CMOR_MAX_STRING);
+        var->cell_measures = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_POSITIVE) == 0) {
 
@@ -2050,7 +2060,7 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
 
         var->ok_max_mean_abs = atof(val);
     } else if (strcmp(att, VARIABLE_ATT_CHUNKING) == 0) {
-        strncpy(var->chunking_dimensions, val, CMOR_MAX_STRING);
+        var->chunking_dimensions = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_SHUFFLE) == 0) {
 
@@ -2102,23 +2112,23 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
 
     } else if (strcmp(att, VARIABLE_ATT_MODELINGREALM) == 0) {
 
-        strncpy(var->realm, val, CMOR_MAX_STRING);
+        var->realm = cmor_intern(val);
 
     } else if (strcmp(att, VARIALBE_ATT_FREQUENCY) == 0) {
 
-        strncpy(var->frequency, val, CMOR_MAX_STRING);
+        var->frequency = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_FLAGVALUES) == 0) {
 
-        strncpy(var->flag_values, val, CMOR_MAX_STRING);
+        var->flag_values = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_FLAGMEANINGS) == 0) {
 
-        strncpy(var->flag_meanings, val, CMOR_MAX_STRING);
+        var->flag_meanings = cmor_intern(val);
 
     } else if (strcmp(att, VARIABLE_ATT_OUTNAME) == 0) {
 
-        strncpy(var->out_name, val, CMOR_MAX_STRING);
+        var->out_name = cmor_intern(val);
 
     } else {
         snprintf(msg, CMOR_MAX_STRING,
@@ -2131,91 +2141,322 @@ int cmor_set_var_def_att(cmor_var_def_t * var, char att[CMOR_MAX_STRING],
 }
 
 /************************************************************************/
-/*                      cmor_set_var_chunking()                         */
+/*                         cmor_chunk_balance()                         */
+/*                                                                      */
+/*      Shrinks the dimensions in idx by a common factor so that their  */
+/*      product fits in budget elements.  Dimensions that would drop    */
+/*      below one element are pinned to one and the rest share what is  */
+/*      left.  Dimensions of length one are always one and take no      */
+/*      part in the sharing.                                            */
 /************************************************************************/
-int cmor_set_chunking(int var_id, int nTableID, size_t nc_dim_chunking[])
+static void cmor_chunk_balance(int n, int *idx, size_t * length,
+                               size_t budget, size_t * chunk)
+{
+    int i, nfree, changed;
+    double total, f;
+
+    for (i = 0; i < n; i++)
+        chunk[idx[i]] = length[idx[i]];
+    do {
+        changed = 0;
+        total = 1.;
+        nfree = 0;
+        for (i = 0; i < n; i++) {
+            if (chunk[idx[i]] > 1) {
+                total *= (double)length[idx[i]];
+                nfree++;
+            }
+        }
+        if ((nfree == 0) || (total <= (double)budget))
+            return;
+        f = pow((double)budget / total, 1. / nfree);
+        for (i = 0; i < n; i++) {
+            if (chunk[idx[i]] <= 1)
+                continue;
+            chunk[idx[i]] = (size_t) (length[idx[i]] * f);
+            if (chunk[idx[i]] < 1) {
+                chunk[idx[i]] = 1;
+                changed = 1;
+            }
+        }
+    } while (changed == 1);
+
+/* -------------------------------------------------------------------- */
+/*      rounding down wastes budget, give it back innermost first       */
+/* -------------------------------------------------------------------- */
+    for (i = n - 1; i >= 0; i--) {
+        total = 1.;
+        for (nfree = 0; nfree < n; nfree++)
+            if (nfree != i)
+                total *= (double)chunk[idx[nfree]];
+        f = floor((double)budget / total);
+        if (f > (double)length[idx[i]])
+            f = (double)length[idx[i]];
+        if (f > (double)chunk[idx[i]])
+            chunk[idx[i]] = (size_t) f;
+    }
+}
+
+/************************************************************************/
+/*                          cmor_chunk_shape()                          */
+/*                                                                      */
+/*      Picks a chunk shape of about target bytes for a variable of     */
+/*      ndims dimensions, in output order.  A time axis of length 0     */
+/*      (not known yet) gets one step per chunk for CMOR_CHUNK_MAP and  */
+/*      is treated as unlimited otherwise.                              */
+/*                                                                      */
+/*      CMOR_CHUNK_MAP        whole horizontal slabs, one time step     */
+/*      CMOR_CHUNK_TIMESERIES as many time steps as fit, on small tiles */
+/*      CMOR_CHUNK_BALANCED   every dimension cut by the same factor    */
+/************************************************************************/
+void cmor_chunk_shape(int ndims, size_t * length, char *axis, size_t elsize,
+                      size_t target, int access, size_t * chunk)
+{
+    size_t len[CMOR_MAX_DIMENSIONS];
+    size_t budget, tile, ntile, maxtime;
+    int idx[CMOR_MAX_DIMENSIONS];
+    int i, n, itime;
+
+    budget = target / ((elsize > 0) ? elsize : 1);
+    if (budget < 1)
+        budget = 1;
+/* -------------------------------------------------------------------- */
+/*      reading one point's time series should still touch a tile of    */
+/*      about the cube root of the budget, not a single value           */
+/* -------------------------------------------------------------------- */
+    tile = (size_t) cbrt((double)budget);
+    if (tile < 1)
+        tile = 1;
+    maxtime = budget / tile;
+
+    itime = -1;
+    for (i = 0; i < ndims; i++) {
+        len[i] = (length[i] > 0) ? length[i] : 1;
+        if ((axis[i] == 'T') && (itime == -1)) {
+            itime = i;
+            if (length[i] == 0)
+                len[i] = maxtime;
+        }
+        chunk[i] = 1;
+    }
+    if ((itime == -1) && (access == CMOR_CHUNK_TIMESERIES))
+        access = CMOR_CHUNK_BALANCED;
+
+    if (access == CMOR_CHUNK_MAP) {
+/* -------------------------------------------------------------------- */
+/*      fastest varying dimensions first, time gets what is left        */
+/* -------------------------------------------------------------------- */
+        for (i = ndims - 1; i >= 0; i--) {
+            if (i == itime)
+                continue;
+            chunk[i] = (len[i] < budget) ? len[i] : budget;
+            budget /= chunk[i];
+        }
+        if ((itime != -1) && (length[itime] > 0))
+            chunk[itime] = (len[itime] < budget) ? len[itime] : budget;
+        return;
+    }
+
+    n = 0;
+    if (access == CMOR_CHUNK_TIMESERIES) {
+        ntile = 1;
+        for (i = 0; i < ndims; i++)
+            if (i != itime)
+                ntile *= len[i];
+        if (ntile > tile)
+            ntile = tile;
+        chunk[itime] = budget / ntile;
+        if (chunk[itime] > len[itime])
+            chunk[itime] = len[itime];
+        budget /= chunk[itime];
+    }
+    for (i = 0; i < ndims; i++) {
+        if ((access == CMOR_CHUNK_TIMESERIES) && (i == itime))
+            continue;
+        idx[n++] = i;
+    }
+    cmor_chunk_balance(n, idx, len, budget, chunk);
+}
+
+/************************************************************************/
+/*                        cmor_chunk_cache_size()                       */
+/*                                                                      */
+/*      Bytes of chunk cache needed to write a variable chunked as      */
+/*      chunk, ntimes time steps per call.  When a call does not fill   */
+/*      the chunks it touches along time, the whole row of chunks       */
+/*      across the other dimensions stays live until the next call.     */
+/*      nchunks returns how many chunks that is.                        */
+/************************************************************************/
+size_t cmor_chunk_cache_size(int ndims, size_t * length, char *axis,
+                             size_t * chunk, size_t elsize, int ntimes,
+                             size_t * nchunks)
+{
+    size_t bytes, row, ct;
+    int i;
+
+    bytes = elsize;
+    row = 1;
+    ct = 1;
+    for (i = 0; i < ndims; i++) {
+        bytes *= chunk[i];
+        if (axis[i] == 'T')
+            ct = chunk[i];
+        else if (length[i] > chunk[i])
+            row *= (length[i] + chunk[i] - 1) / chunk[i];
+    }
+    if (ntimes < 1)
+        ntimes = 1;
+    if ((ct <= 1) || ((ntimes % ct) == 0))
+        row = 1;
+    *nchunks = row;
+    return (row * bytes);
+}
+
+/************************************************************************/
+/*                        cmor_chunk_access_id()                        */
+/************************************************************************/
+int cmor_chunk_access_id(char *name)
 {
+    if (strcmp(name, "map") == 0)
+        return (CMOR_CHUNK_MAP);
+    if (strcmp(name, "timeseries") == 0)
+        return (CMOR_CHUNK_TIMESERIES);
+    if (strcmp(name, "balanced") == 0)
+        return (CMOR_CHUNK_BALANCED);
+    return (-1);
+}
 
+/************************************************************************/
+/*                         cmor_set_chunking()                          */
+/*                                                                      */
+/*      The table's chunk_dimensions may hold the legacy "T Z Y X"      */
+/*      sizes, one size per output dimension, or an access pattern      */
+/*      name.  Otherwise the shape comes from cmor_chunk_shape() with   */
+/*      the "_chunk_access" and "_chunk_size" dataset attributes.       */
+/************************************************************************/
+int cmor_set_chunking(int var_id, int nTableID, size_t nc_dim_chunking[])
+{
     char chunk_dimensions[CMOR_MAX_STRING];
-    char *token;
-    int n;
+    char value[CMOR_MAX_STRING];
+    char msg[CMOR_MAX_STRING];
+    char *token, *end;
+    char axis[CMOR_MAX_DIMENSIONS];
+    size_t length[CMOR_MAX_DIMENSIONS];
+    size_t target;
+    long nChunks[CMOR_MAX_DIMENSIONS + 1];
+    int n, i, access, explicit;
     int ndims = cmor_vars[var_id].ndims;
-    int nChunks[CMOR_MAX_DIMENSIONS];   // T, Z, Y,X
-    int nAxisID;
+    cmor_axis_t *pAxis;
 
     cmor_add_traceback("cmor_set_chunking");
     cmor_is_setup();
 
-    strcpy(chunk_dimensions, cmor_vars[var_id].chunking_dimensions);
-    if (chunk_dimensions[0] == '\0') {
+    if (ndims == 0) {
         cmor_pop_traceback();
         return (-1);
     }
 
-    token = strtok(chunk_dimensions, " ");
+    access = CMOR_CHUNK_MAP;
+    if (cmor_has_cur_dataset_attribute(CMOR_CHUNK_ACCESS) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_CHUNK_ACCESS, value);
+        access = cmor_chunk_access_id(value);
+        if (access == -1) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "%s must be \"map\", \"timeseries\" or \"balanced\", "
+                     "you passed \"%s\", using \"map\"",
+                     CMOR_CHUNK_ACCESS, value);
+            cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+            access = CMOR_CHUNK_MAP;
+        }
+    }
+    target = CMOR_DEFAULT_CHUNK_SIZE;
+    if (cmor_has_cur_dataset_attribute(CMOR_CHUNK_SIZE) == 0) {
+        cmor_get_cur_dataset_attribute(CMOR_CHUNK_SIZE, value);
+        if (atol(value) > 0)
+            target = atol(value);
+    }
+
+    for (i = 0; i < ndims; i++) {
+        pAxis = &cmor_axes[cmor_vars[var_id].axes_ids[i]];
+        axis[i] = pAxis->axis;
+        length[i] = (pAxis->length > 0) ? pAxis->length : 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      what did the table ask for?                                     */
+/* -------------------------------------------------------------------- */
+    strncpy(chunk_dimensions, cmor_vars[var_id].chunking_dimensions,
+            CMOR_MAX_STRING);
+    chunk_dimensions[CMOR_MAX_STRING - 1] = '\0';
+    explicit = 0;
     n = 0;
-    // Read in all chunks
+    token = strtok(chunk_dimensions, " ");
     while (token != NULL) {
-        nChunks[n] = atoi(token);
+        if (cmor_chunk_access_id(token) != -1) {
+            access = cmor_chunk_access_id(token);
+            n = -1;
+            break;
+        }
+        if (n > CMOR_MAX_DIMENSIONS)
+            break;
+        nChunks[n] = strtol(token, &end, 10);
+        if (*end != '\0') {
+            n = CMOR_MAX_DIMENSIONS + 1;
+            break;
+        }
         n++;
         token = strtok(NULL, " ");
     }
-    // We need 4 dimensions corresponding to T, Z, Y,X
-    if (n != 4) {
-        return (-1);
-    }
-    // Validate Chunks size.
-    for (n = 0; n < ndims; n++) {
-        nAxisID = cmor_vars[var_id].axes_ids[n];
-        if (cmor_axes[nAxisID].axis == 'X') {
-            if (nChunks[3] > cmor_axes[nAxisID].length) {
-                nChunks[3] = cmor_axes[nAxisID].length;
-            } else if (nChunks[3] <= 0) {
-                nChunks[3] = 1;
-            }
-        }
-        if (cmor_axes[nAxisID].axis == 'Y') {
-            if (nChunks[2] > cmor_axes[nAxisID].length) {
-                nChunks[2] = cmor_axes[nAxisID].length;
-            } else if (nChunks[2] <= 0) {
-                nChunks[2] = 1;
-            }
-        }
-        if (cmor_axes[nAxisID].axis == 'Z') {
-            if (nChunks[1] > cmor_axes[nAxisID].length) {
-                nChunks[1] = cmor_axes[nAxisID].length;
-            } else if (nChunks[1] <= 0) {
-                nChunks[1] = 1;
-            }
-        }
-        if (cmor_axes[nAxisID].axis == 'T') {
-            if (nChunks[0] > cmor_axes[nAxisID].length) {
-                nChunks[0] = cmor_axes[nAxisID].length;
-            } else if (nChunks[0] <= 0) {
-                nChunks[0] = 1;
-            }
+    if (n == 4) {
+/* -------------------------------------------------------------------- */
+/*      legacy T Z Y X sizes, other axes get one                        */
+/* -------------------------------------------------------------------- */
+        explicit = 1;
+        for (i = 0; i < ndims; i++) {
+            if (axis[i] == 'T')
+                nc_dim_chunking[i] = nChunks[0];
+            else if (axis[i] == 'Z')
+                nc_dim_chunking[i] = nChunks[1];
+            else if (axis[i] == 'Y')
+                nc_dim_chunking[i] = nChunks[2];
+            else if (axis[i] == 'X')
+                nc_dim_chunking[i] = nChunks[3];
+            else
+                nc_dim_chunking[i] = 1;
         }
+    } else if (n == ndims) {
+        explicit = 1;
+        for (i = 0; i < ndims; i++)
+            nc_dim_chunking[i] = nChunks[i];
+    } else if (n > 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "chunk_dimensions \"%s\" of variable %s (table: %s) is "
+                 "neither an access pattern nor a list of %i sizes, "
+                 "CMOR will pick the chunk shape",
+                 cmor_vars[var_id].chunking_dimensions,
+                 cmor_vars[var_id].id, cmor_tables[nTableID].szTable_id,
+                 ndims);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
     }
-    // Assign chunks;
-    n = 0;
-    while (n < ndims) {
-        nAxisID = cmor_vars[var_id].axes_ids[n];
-        if (cmor_axes[nAxisID].axis == 'X') {
-            nc_dim_chunking[n] = nChunks[3];
-        } else if (cmor_axes[nAxisID].axis == 'Y') {
-            nc_dim_chunking[n] = nChunks[2];
-        } else if (cmor_axes[nAxisID].axis == 'Z') {
-            nc_dim_chunking[n] = nChunks[1];
-        } else if (cmor_axes[nAxisID].axis == 'T') {
-            nc_dim_chunking[n] = nChunks[0];
-        } else {
-            nc_dim_chunking[n] = 1;
+
+    if (explicit == 1) {
+/* -------------------------------------------------------------------- */
+/*      netCDF wants 1 <= size <= length, time is unlimited             */
+/* -------------------------------------------------------------------- */
+        for (i = 0; i < ndims; i++) {
+            if ((long)nc_dim_chunking[i] <= 0)
+                nc_dim_chunking[i] = 1;
+            else if ((length[i] > 0) && (nc_dim_chunking[i] > length[i]))
+                nc_dim_chunking[i] = length[i];
         }
-        n++;
+    } else {
+        cmor_chunk_shape(ndims, length, axis,
+                         (cmor_vars[var_id].type == 'd') ? 8 : 4,
+                         target, access, nc_dim_chunking);
     }
+
     cmor_pop_traceback();
     return (0);
-
 }
 
 /************************************************************************/
@@ -2245,6 +2486,132 @@ int cmor_set_deflate(int var_id, int shuffle, int deflate, int deflate_level)
     return (0);
 }
 
+/************************************************************************/
+/*                        cmor_set_compression()                        */
+/*                                                                      */
+/*      Everything on top of shuffle/deflate: fletcher32 checksums,     */
+/*      one HDF5 filter plugin (e.g. zstd 32015, lz4 32004,             */
+/*      bitshuffle 32008) and bit grooming to significant_digits        */
+/*      decimal digits, 0 keeping every bit.                            */
+/************************************************************************/
+int cmor_set_compression(int var_id, int fletcher32, unsigned int filter_id,
+                         int nparams, unsigned int *params,
+                         int significant_digits)
+{
+    char msg[CMOR_MAX_STRING];
+    int i;
+
+    cmor_add_traceback("cmor_set_compression");
+    cmor_is_setup();
+
+    if (cmor_vars[var_id].self != var_id) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to compress variable id(%d) which was "
+                 "not initialized", var_id);
+        cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+        cmor_pop_traceback();
+        return (-1);
+    }
+    if ((nparams < 0) || (nparams > CMOR_MAX_FILTER_PARAMS)
+        || ((nparams > 0) && (params == NULL))) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "variable %s: HDF5 filter %u takes at most %i "
+                 "parameters, you passed %i", cmor_vars[var_id].id,
+                 filter_id, CMOR_MAX_FILTER_PARAMS, nparams);
+        cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+        cmor_pop_traceback();
+        return (-1);
+    }
+    if (significant_digits < 0)
+        significant_digits = 0;
+    if ((significant_digits > 0) && (cmor_vars[var_id].type != 'f')
+        && (cmor_vars[var_id].type != 'd')) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "variable %s is not stored as floating point, "
+                 "significant digits (%i) are ignored",
+                 cmor_vars[var_id].id, significant_digits);
+        cmor_handle_error_var(msg, CMOR_WARNING, var_id);
+        significant_digits = 0;
+    }
+
+    cmor_vars[var_id].fletcher32 = fletcher32;
+    cmor_vars[var_id].filter_id = filter_id;
+    cmor_vars[var_id].filter_nparams = nparams;
+    for (i = 0; i < nparams; i++)
+        cmor_vars[var_id].filter_params[i] = params[i];
+    cmor_vars[var_id].significant_digits = significant_digits;
+    if (significant_digits > 0)
+        cmor_set_variable_attribute_internal(var_id, "quantization_nsd",
+                                             'i', &significant_digits);
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                         cmor_groom_floats()                          */
+/*                                                                      */
+/*      Bit grooming (Zender, 2016): keep the mantissa bits needed for  */
+/*      nsd decimal digits, then alternately clear and set the rest so  */
+/*      the rounding errors average out.  The parity comes from first,  */
+/*      the value's index in the whole write, so tiling does not show.  */
+/*      Missing values, zeros, infinities and NaN are left alone.       */
+/************************************************************************/
+void cmor_groom_floats(float *values, char *mask, int n, long first, int nsd)
+{
+    union {
+        float f;
+        uint32_t u;
+    } v;
+    uint32_t shave, set;
+    int k, keep;
+
+    keep = (int)ceil(nsd * M_LN10 / M_LN2) + 1;
+    if (keep >= 23)
+        return;
+    set = ((uint32_t) 1 << (23 - keep)) - 1;
+    shave = ~set;
+    for (k = 0; k < n; k++) {
+        if ((mask[k] != 0) || (values[k] == 0.f) || !isfinite(values[k]))
+            continue;
+        v.f = values[k];
+        if (((first + k) & 1) == 0)
+            v.u &= shave;
+        else
+            v.u |= set;
+        values[k] = v.f;
+    }
+}
+
+/************************************************************************/
+/*                         cmor_groom_doubles()                         */
+/************************************************************************/
+void cmor_groom_doubles(double *values, char *mask, int n, long first,
+                        int nsd)
+{
+    union {
+        double d;
+        uint64_t u;
+    } v;
+    uint64_t shave, set;
+    int k, keep;
+
+    keep = (int)ceil(nsd * M_LN10 / M_LN2) + 1;
+    if (keep >= 52)
+        return;
+    set = ((uint64_t) 1 << (52 - keep)) - 1;
+    shave = ~set;
+    for (k = 0; k < n; k++) {
+        if ((mask[k] != 0) || (values[k] == 0.) || !isfinite(values[k]))
+            continue;
+        v.d = values[k];
+        if (((first + k) & 1) == 0)
+            v.u &= shave;
+        else
+            v.u |= set;
+        values[k] = v.d;
+    }
+}
+
 /************************************************************************/
 /*                   cmor_get_variable_time_length()                    */
 /************************************************************************/
@@ -2301,66 +2668,1186 @@ int cmor_get_original_shape(int *var_id, int *shape_array, int *rank,
 }
 
 /************************************************************************/
-/*                       cmor_write_var_to_file()                       */
+/*                          cmor_reorder_init()                         */
+/*                                                                      */
+/*      Describes how to walk the user array in output order.  For      */
+/*      each output axis we get its length, its stride in the user      */
+/*      array, its direction and its (longitude) offset.  Axes of       */
+/*      length 1 are dropped and neighbouring axes that are laid out    */
+/*      the same way in both orders are merged, so that the innermost   */
+/*      axis is as long as possible.                                    */
 /************************************************************************/
-int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
-                           char itype, int ntimes_passed,
-                           double *time_vals, double *time_bounds)
+void cmor_reorder_init(cmor_reorder_t * reorder, int ndims, int *length,
+                       long *stride, int *revert, int *offset)
 {
+    int i, n, first, edge;
 
-    size_t counts[CMOR_MAX_DIMENSIONS];
-    size_t counts2[CMOR_MAX_DIMENSIONS];
-    int counter[CMOR_MAX_DIMENSIONS];
-    int counter_orig[CMOR_MAX_DIMENSIONS];
-    int counter_orig2[CMOR_MAX_DIMENSIONS];
-    int counter2[CMOR_MAX_DIMENSIONS];
-    size_t starts[CMOR_MAX_DIMENSIONS];
-    int nelements, loc, add, nelts;
-    double *data_tmp = NULL, tmp = 0., tmp2, amean;
-    int *idata_tmp = NULL;
-    long *ldata_tmp = NULL;
-    float *fdata_tmp = NULL;
-    char mtype;
-    int i, j, ierr = 0, dounits = 1;
-    char msg[CMOR_MAX_STRING];
-    char msg2[CMOR_MAX_STRING];
-    double *tmp_vals;
-    ut_unit *user_units = NULL, *cmor_units = NULL;
-    cv_converter *ut_cmor_converter = NULL;
-    char local_unit[CMOR_MAX_STRING];
-    int n_lower_min = 0, n_greater_max = 0;
-    double emax, emin, first_time;
-    char msg_min[CMOR_MAX_STRING];
-    char msg_max[CMOR_MAX_STRING];
-    extern ut_system *ut_read;
-    int tmpindex = 0;
-    int index;
+    n = 0;
+    reorder->nelements = 1;
 
-    cmor_add_traceback("cmor_write_var_to_file");
-    cmor_is_setup();
+    for (i = 0; i < ndims; i++) {
+        reorder->nelements *= length[i];
+        if (length[i] == 1)
+            continue;
 
-    emax = 0.;
-    emin = 0.;
+/* -------------------------------------------------------------------- */
+/*      source index written at output index 0                          */
+/* -------------------------------------------------------------------- */
+        first = ((offset[i] % length[i]) + length[i]) % length[i];
+        if (revert[i] == -1)
+            first = (length[i] - 1 + first) % length[i];
 
-    if (strcmp(avar->ounits, avar->iunits) == 0)
-        dounits = 0;
-    mtype = avar->type;
+        edge = (revert[i] == 1) ? 0 : length[i] - 1;
+
+        if ((n > 0)
+            && (reorder->revert[n - 1] == revert[i])
+            && (reorder->first[n - 1] == ((revert[i] == 1) ? 0 :
+                                          reorder->length[n - 1] - 1))
+            && (first == edge)
+            && (reorder->stride[n - 1] == stride[i] * length[i])) {
 /* -------------------------------------------------------------------- */
-/*       This counts how many elements there is in each dimension and   */
-/*      the total number of elements written at this time This needs    */
-/*      to be passed to NetCDF.                                         */
-/*                                                                      */
-/*      do we have times ?                                              */
+/*      contiguous with the previous axis, merge them                   */
 /* -------------------------------------------------------------------- */
-    if (ntimes_passed != 0) {
-        counts[0] = ntimes_passed;
-        if (cmor_axes[avar->axes_ids[0]].axis != 'T') {
-            snprintf(msg, CMOR_MAX_STRING,
-                     "you are passing %i time steps for a static "
-                     "(no time dimension) variable (%s, table: %s), "
-                     "please pass 0 (zero) as the number of times",
-                     ntimes_passed, avar->id,
-                     cmor_tables[avar->ref_table_id].szTable_id);
+            reorder->length[n - 1] *= length[i];
+            reorder->stride[n - 1] = stride[i];
+            reorder->first[n - 1] = (revert[i] == 1) ? 0 :
+              reorder->length[n - 1] - 1;
+        } else {
+            reorder->length[n] = length[i];
+            reorder->stride[n] = stride[i];
+            reorder->revert[n] = revert[i];
+            reorder->first[n] = first;
+            n++;
+        }
+    }
+
+    if (n == 0) {
+        reorder->length[0] = 1;
+        reorder->stride[0] = 0;
+        reorder->revert[0] = 1;
+        reorder->first[0] = 0;
+        n = 1;
+    }
+
+    reorder->ndims = n;
+    for (i = 0; i < n; i++) {
+        reorder->index[i] = 0;
+        reorder->source[i] = reorder->first[i];
+    }
+    reorder->segment = 0;
+    reorder->position = 0;
+    reorder->done = 0;
+}
+
+/************************************************************************/
+/*                       cmor_reorder_contiguous()                      */
+/*                                                                      */
+/*      1 when the user array already is in output order.               */
+/************************************************************************/
+int cmor_reorder_contiguous(cmor_reorder_t * reorder)
+{
+    if ((reorder->ndims == 1)
+        && (reorder->revert[0] == 1)
+        && (reorder->first[0] == 0)
+        && ((reorder->stride[0] == 1) || (reorder->length[0] == 1)))
+        return (1);
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_passthrough_type()                        */
+/*                                                                      */
+/*      1 when netCDF may convert user values of type itype to otype    */
+/*      the way cmor would: the same type or a widening one.  2 for a   */
+/*      narrowing one (double to float, long to int...), which netCDF   */
+/*      fails with NC_ERANGE where cmor casts silently, so the values   */
+/*      must be checked with cmor_passthrough_fits() first.             */
+/************************************************************************/
+int cmor_passthrough_type(char itype, char otype)
+{
+    if (itype == otype)
+        return (1);
+    if (itype == 'i')
+        return ((otype == 'l') || (otype == 'f') || (otype == 'd'));
+    if ((itype == 'f') || (itype == 'l'))
+        return ((otype == 'd') ? 1 : 2);
+    if (itype == 'd')
+        return (2);
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_passthrough_fits()                        */
+/*                                                                      */
+/*      1 when all n values of data, of type itype, convert to otype    */
+/*      without leaving its range, so that netCDF casts them exactly    */
+/*      as the staging loop would.  Longs beyond 2^53 would be rounded  */
+/*      twice by the staging loop and never fit a float.                */
+/************************************************************************/
+int cmor_passthrough_fits(void *data, char itype, char otype, int n)
+{
+    double lo, hi, x;
+    long *ldata;
+    int i;
+
+    if (otype == 'i') {
+        lo = (double)INT_MIN;
+        hi = (double)INT_MAX;
+    } else if (otype == 'l') {
+        lo = (double)LONG_MIN;
+        hi = nextafter((double)LONG_MAX, 0.);
+    } else if (itype == 'l') {
+        lo = -9007199254740992.;
+        hi = 9007199254740992.;
+    } else {
+        lo = -FLT_MAX;
+        hi = FLT_MAX;
+    }
+
+    if (itype == 'l') {
+        ldata = (long *)data;
+        for (i = 0; i < n; i++) {
+            if ((ldata[i] < (long)lo) || (ldata[i] > (long)hi))
+                return (0);
+        }
+        return (1);
+    }
+    for (i = 0; i < n; i++) {
+        x = (itype == 'f') ? ((float *)data)[i] : ((double *)data)[i];
+/* -------------------------------------------------------------------- */
+/*      NaN goes into a float as it is, not into an integer             */
+/* -------------------------------------------------------------------- */
+        if ((x < lo) || (x > hi) || ((x != x) && (otype != 'f')))
+            return (0);
+    }
+    return (1);
+}
+
+/************************************************************************/
+/*                          cmor_reorder_next()                         */
+/*                                                                      */
+/*      Copies the next run of at most CMOR_REORDER_TILE values, in     */
+/*      output order, from the user array into tile (as doubles).       */
+/*      A row of the innermost axis is split at most in two pieces      */
+/*      (before and after the longitude wrap), each of which is read    */
+/*      with a constant stride.  Returns the number of values copied,   */
+/*      0 once everything has been read.                                */
+/************************************************************************/
+int cmor_reorder_next(cmor_reorder_t * reorder, void *data, char itype,
+                      double *tile)
+{
+    int i, k, n, inner, length, revert, start, count, count1;
+    long base, step;
+
+    if (reorder->done >= reorder->nelements)
+        return (0);
+
+    inner = reorder->ndims - 1;
+    length = reorder->length[inner];
+    revert = reorder->revert[inner];
+
+    if (revert == 1)
+        count1 = length - reorder->first[inner];
+    else
+        count1 = reorder->first[inner] + 1;
+
+    if (reorder->segment == 0) {
+        start = reorder->first[inner];
+        count = count1;
+    } else {
+        start = (revert == 1) ? 0 : length - 1;
+        count = length - count1;
+    }
+    start += revert * reorder->position;
+    n = count - reorder->position;
+    if (n > CMOR_REORDER_TILE)
+        n = CMOR_REORDER_TILE;
+
+    base = start * reorder->stride[inner];
+    for (i = 0; i < inner; i++)
+        base += reorder->source[i] * reorder->stride[i];
+    step = revert * reorder->stride[inner];
+
+/* -------------------------------------------------------------------- */
+/*      one loop per type, nothing but the copy inside                  */
+/* -------------------------------------------------------------------- */
+    if (itype == 'd') {
+        double *pData = (double *)data + base;
+        if (step == 1) {
+            memcpy(tile, pData, n * sizeof(double));
+        } else {
+            for (k = 0; k < n; k++)
+                tile[k] = pData[k * step];
+        }
+    } else if (itype == 'f') {
+        float *pData = (float *)data + base;
+        for (k = 0; k < n; k++)
+            tile[k] = (double)pData[k * step];
+    } else if (itype == 'i') {
+        int *pData = (int *)data + base;
+        for (k = 0; k < n; k++)
+            tile[k] = (double)pData[k * step];
+    } else if (itype == 'l') {
+        long *pData = (long *)data + base;
+        for (k = 0; k < n; k++)
+            tile[k] = (double)pData[k * step];
+    }
+
+    reorder->done += n;
+    reorder->position += n;
+    if (reorder->position < count)
+        return (n);
+
+    reorder->position = 0;
+    if ((reorder->segment == 0) && (count1 < length)) {
+        reorder->segment = 1;
+        return (n);
+    }
+    reorder->segment = 0;
+
+/* -------------------------------------------------------------------- */
+/*      row is done, move on to the next one                            */
+/* -------------------------------------------------------------------- */
+    for (i = inner - 1; i >= 0; i--) {
+        reorder->index[i]++;
+        if (reorder->index[i] < reorder->length[i]) {
+            reorder->source[i] += reorder->revert[i];
+            if (reorder->source[i] == reorder->length[i])
+                reorder->source[i] = 0;
+            else if (reorder->source[i] < 0)
+                reorder->source[i] = reorder->length[i] - 1;
+            break;
+        }
+        reorder->index[i] = 0;
+        reorder->source[i] = reorder->first[i];
+    }
+    return (n);
+}
+
+/* -------------------------------------------------------------------- */
+/*      Block kernels used by cmor_write_var_to_file().  Each one has   */
+/*      a plain C version and, on x86, SSE2 and AVX2 versions picked    */
+/*      at run time.                                                    */
+/* -------------------------------------------------------------------- */
+static void cmor_block_missing_c(double *tile, int n, double missing,
+                                 double tolerance, char *mask)
+{
+    int k;
+
+    for (k = 0; k < n; k++)
+        mask[k] = (fabs(tile[k] - missing) <= tolerance * fabs(tile[k]));
+}
+
+static void cmor_block_stats_c(double *tile, int n, char *mask, double scale,
+                               double offset, double omissing, double valid_min,
+                               double valid_max, cmor_block_stats_t * stats)
+{
+    int k;
+    double x;
+
+    for (k = 0; k < n; k++) {
+        if (mask[k]) {
+            tile[k] = omissing;
+            continue;
+        }
+        x = tile[k] * scale + offset;
+        stats->sum_abs += fabs(x);
+        stats->nelts++;
+        if (x < valid_min)
+            stats->n_lower_min++;
+        if (x > valid_max)
+            stats->n_greater_max++;
+        if (x < stats->vmin)
+            stats->vmin = x;
+        if (x > stats->vmax)
+            stats->vmax = x;
+        tile[k] = x;
+    }
+}
+
+#ifdef CMOR_X86_SIMD
+__attribute__ ((target("sse2")))
+static void cmor_block_missing_sse2(double *tile, int n, double missing,
+                                    double tolerance, char *mask)
+{
+    int k, bits;
+    __m128d vmiss = _mm_set1_pd(missing);
+    __m128d vtol = _mm_set1_pd(tolerance);
+    __m128d vabs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+
+    for (k = 0; k + 2 <= n; k += 2) {
+        __m128d x = _mm_loadu_pd(tile + k);
+        __m128d d = _mm_and_pd(_mm_sub_pd(x, vmiss), vabs);
+        __m128d t = _mm_mul_pd(vtol, _mm_and_pd(x, vabs));
+        bits = _mm_movemask_pd(_mm_cmple_pd(d, t));
+        mask[k] = bits & 1;
+        mask[k + 1] = (bits >> 1) & 1;
+    }
+    cmor_block_missing_c(tile + k, n - k, missing, tolerance, mask + k);
+}
+
+__attribute__ ((target("sse2")))
+static void cmor_block_stats_sse2(double *tile, int n, char *mask,
+                                  double scale, double offset, double omissing,
+                                  double valid_min, double valid_max,
+                                  cmor_block_stats_t * stats)
+{
+    int k;
+    double lane[2];
+    __m128d vscale = _mm_set1_pd(scale);
+    __m128d voffset = _mm_set1_pd(offset);
+    __m128d vomiss = _mm_set1_pd(omissing);
+    __m128d vlo = _mm_set1_pd(valid_min);
+    __m128d vhi = _mm_set1_pd(valid_max);
+    __m128d vabs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+    __m128d vsum = _mm_setzero_pd();
+    __m128d vmin = _mm_set1_pd(stats->vmin);
+    __m128d vmax = _mm_set1_pd(stats->vmax);
+
+    for (k = 0; k + 2 <= n; k += 2) {
+        __m128d keep = _mm_castsi128_pd(_mm_set_epi64x(mask[k + 1] ? 0 : -1,
+                                                       mask[k] ? 0 : -1));
+        __m128d x = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(tile + k), vscale),
+                               voffset);
+
+        vsum = _mm_add_pd(vsum, _mm_and_pd(keep, _mm_and_pd(x, vabs)));
+        stats->nelts += __builtin_popcount(_mm_movemask_pd(keep));
+        stats->n_lower_min +=
+          __builtin_popcount(_mm_movemask_pd(_mm_and_pd(keep,
+                                                        _mm_cmplt_pd(x,
+                                                                     vlo))));
+        stats->n_greater_max +=
+          __builtin_popcount(_mm_movemask_pd(_mm_and_pd(keep,
+                                                        _mm_cmpgt_pd(x,
+                                                                     vhi))));
+        vmin = _mm_min_pd(_mm_or_pd(_mm_and_pd(keep, x),
+                                    _mm_andnot_pd(keep, vmin)), vmin);
+        vmax = _mm_max_pd(_mm_or_pd(_mm_and_pd(keep, x),
+                                    _mm_andnot_pd(keep, vmax)), vmax);
+        _mm_storeu_pd(tile + k, _mm_or_pd(_mm_and_pd(keep, x),
+                                          _mm_andnot_pd(keep, vomiss)));
+    }
+    _mm_storeu_pd(lane, vsum);
+    stats->sum_abs += lane[0] + lane[1];
+    _mm_storeu_pd(lane, vmin);
+    stats->vmin = (lane[0] < lane[1]) ? lane[0] : lane[1];
+    _mm_storeu_pd(lane, vmax);
+    stats->vmax = (lane[0] > lane[1]) ? lane[0] : lane[1];
+    cmor_block_stats_c(tile + k, n - k, mask + k, scale, offset, omissing,
+                       valid_min, valid_max, stats);
+}
+
+__attribute__ ((target("avx2")))
+static void cmor_block_missing_avx2(double *tile, int n, double missing,
+                                    double tolerance, char *mask)
+{
+    int k, bits;
+    __m256d vmiss = _mm256_set1_pd(missing);
+    __m256d vtol = _mm256_set1_pd(tolerance);
+    __m256d vabs =
+      _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+
+    for (k = 0; k + 4 <= n; k += 4) {
+        __m256d x = _mm256_loadu_pd(tile + k);
+        __m256d d = _mm256_and_pd(_mm256_sub_pd(x, vmiss), vabs);
+        __m256d t = _mm256_mul_pd(vtol, _mm256_and_pd(x, vabs));
+        bits = _mm256_movemask_pd(_mm256_cmp_pd(d, t, _CMP_LE_OQ));
+        mask[k] = bits & 1;
+        mask[k + 1] = (bits >> 1) & 1;
+        mask[k + 2] = (bits >> 2) & 1;
+        mask[k + 3] = (bits >> 3) & 1;
+    }
+    cmor_block_missing_c(tile + k, n - k, missing, tolerance, mask + k);
+}
+
+__attribute__ ((target("avx2")))
+static void cmor_block_stats_avx2(double *tile, int n, char *mask,
+                                  double scale, double offset, double omissing,
+                                  double valid_min, double valid_max,
+                                  cmor_block_stats_t * stats)
+{
+    int k, m;
+    double lane[4];
+    __m256d vscale = _mm256_set1_pd(scale);
+    __m256d voffset = _mm256_set1_pd(offset);
+    __m256d vomiss = _mm256_set1_pd(omissing);
+    __m256d vlo = _mm256_set1_pd(valid_min);
+    __m256d vhi = _mm256_set1_pd(valid_max);
+    __m256d vabs =
+      _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    __m256d vsum = _mm256_setzero_pd();
+    __m256d vmin = _mm256_set1_pd(stats->vmin);
+    __m256d vmax = _mm256_set1_pd(stats->vmax);
+
+    for (k = 0; k + 4 <= n; k += 4) {
+        memcpy(&m, mask + k, sizeof(int));
+        __m256d keep =
+          _mm256_castsi256_pd(_mm256_cmpeq_epi64
+                              (_mm256_cvtepi8_epi64(_mm_cvtsi32_si128(m)),
+                               _mm256_setzero_si256()));
+        __m256d x =
+          _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(tile + k), vscale),
+                        voffset);
+
+        vsum = _mm256_add_pd(vsum, _mm256_and_pd(keep,
+                                                 _mm256_and_pd(x, vabs)));
+        stats->nelts += __builtin_popcount(_mm256_movemask_pd(keep));
+        stats->n_lower_min +=
+          __builtin_popcount(_mm256_movemask_pd
+                             (_mm256_and_pd
+                              (keep, _mm256_cmp_pd(x, vlo, _CMP_LT_OQ))));
+        stats->n_greater_max +=
+          __builtin_popcount(_mm256_movemask_pd
+                             (_mm256_and_pd
+                              (keep, _mm256_cmp_pd(x, vhi, _CMP_GT_OQ))));
+        vmin = _mm256_min_pd(_mm256_blendv_pd(vmin, x, keep), vmin);
+        vmax = _mm256_max_pd(_mm256_blendv_pd(vmax, x, keep), vmax);
+        _mm256_storeu_pd(tile + k, _mm256_blendv_pd(vomiss, x, keep));
+    }
+    _mm256_storeu_pd(lane, vsum);
+    stats->sum_abs += (lane[0] + lane[1]) + (lane[2] + lane[3]);
+    _mm256_storeu_pd(lane, vmin);
+    for (m = 0; m < 4; m++)
+        if (lane[m] < stats->vmin)
+            stats->vmin = lane[m];
+    _mm256_storeu_pd(lane, vmax);
+    for (m = 0; m < 4; m++)
+        if (lane[m] > stats->vmax)
+            stats->vmax = lane[m];
+    cmor_block_stats_c(tile + k, n - k, mask + k, scale, offset, omissing,
+                       valid_min, valid_max, stats);
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+/*      Kernels picked once for the CPU, write workers and threads      */
+/*      converting outside the lock reach them concurrently.            */
+/* -------------------------------------------------------------------- */
+static pthread_once_t cmor_block_kernels_once = PTHREAD_ONCE_INIT;
+static void (*cmor_block_missing_kernel) (double *, int, double, double,
+                                          char *);
+static void (*cmor_block_stats_kernel) (double *, int, char *, double,
+                                        double, double, double, double,
+                                        cmor_block_stats_t *);
+
+/************************************************************************/
+/*                       cmor_pick_block_kernels()                      */
+/************************************************************************/
+static void cmor_pick_block_kernels(void)
+{
+    cmor_block_missing_kernel = cmor_block_missing_c;
+    cmor_block_stats_kernel = cmor_block_stats_c;
+#ifdef CMOR_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        cmor_block_missing_kernel = cmor_block_missing_avx2;
+        cmor_block_stats_kernel = cmor_block_stats_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        cmor_block_missing_kernel = cmor_block_missing_sse2;
+        cmor_block_stats_kernel = cmor_block_stats_sse2;
+    }
+#endif
+}
+
+/************************************************************************/
+/*                          cmor_block_missing()                        */
+/*                                                                      */
+/*      Flags (mask[k] = 1) the values of tile that match the user's    */
+/*      missing value.                                                  */
+/************************************************************************/
+void cmor_block_missing(double *tile, int n, double missing,
+                        double tolerance, char *mask)
+{
+    pthread_once(&cmor_block_kernels_once, cmor_pick_block_kernels);
+    cmor_block_missing_kernel(tile, n, missing, tolerance, mask);
+}
+
+/************************************************************************/
+/*                           cmor_block_stats()                         */
+/*                                                                      */
+/*      Single sweep over a block of values: applies x * scale +        */
+/*      offset (affine units conversion and sign), puts omissing where  */
+/*      mask is set and                                                 */
+/*      accumulates sum(|x|), the number of valid values, the number    */
+/*      of values out of [valid_min, valid_max] and the extremes.       */
+/*      Pass -HUGE_VAL/HUGE_VAL to turn the range checks off.           */
+/************************************************************************/
+void cmor_block_stats(double *tile, int n, char *mask, double scale,
+                      double offset, double omissing, double valid_min,
+                      double valid_max, cmor_block_stats_t * stats)
+{
+    pthread_once(&cmor_block_kernels_once, cmor_pick_block_kernels);
+    cmor_block_stats_kernel(tile, n, mask, scale, offset, omissing,
+                            valid_min, valid_max, stats);
+}
+
+/************************************************************************/
+/*                          cmor_affine_units()                         */
+/*                                                                      */
+/*      Returns 1 if converter is y = scale * x + offset (checked on    */
+/*      a few points) and sets scale and offset, 0 otherwise.           */
+/************************************************************************/
+int cmor_affine_units(cv_converter * converter, double *scale,
+                      double *offset)
+{
+    int k;
+    double y, yref;
+    double probes[5] = { 1., -1., 273.15, 1.e4, -3.5e5 };
+
+    *offset = cv_convert_double(converter, 0.);
+    *scale = (cv_convert_double(converter, 1.e4)
+              - cv_convert_double(converter, -1.e4)) / 2.e4;
+
+    if ((ut_get_status() != UT_SUCCESS) || !isfinite(*scale)
+        || !isfinite(*offset) || (*scale == 0.))
+        return (0);
+
+    for (k = 0; k < 5; k++) {
+        y = cv_convert_double(converter, probes[k]);
+        yref = *scale * probes[k] + *offset;
+        if (!isfinite(y) || (fabs(y - yref) > 1.e-12 *
+                             (fabs(*scale * probes[k]) + fabs(*offset))))
+            return (0);
+    }
+    return (1);
+}
+
+/************************************************************************/
+/*                         cmor_append_location()                       */
+/*                                                                      */
+/*      Appends " axis: index/value" for each axis of the element at    */
+/*      linear output position i to msg.                                */
+/************************************************************************/
+void cmor_append_location(char *msg, cmor_var_t * avar, int *counter, int i,
+                          double *time_vals)
+{
+    int j, loc;
+    int counter2[CMOR_MAX_DIMENSIONS];
+    char msg2[CMOR_MAX_STRING];
+    cmor_axis_t *pAxis;
+
+    loc = (avar->isbounds) ? i / 2 : i;
+    for (j = 0; j < avar->ndims; j++) {
+        counter2[j] = loc / counter[j + 1];
+        loc = loc - counter2[j] * counter[j + 1];
+    }
+
+    for (j = 0; j < avar->ndims; j++) {
+        pAxis = &cmor_axes[avar->axes_ids[j]];
+        if (pAxis->values != NULL) {
+            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
+                     pAxis->id, counter2[j], pAxis->values[counter2[j]]);
+        } else {
+            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
+                     pAxis->id, counter2[j], time_vals[counter2[j]]);
+        }
+        strncat(msg, msg2, CMOR_MAX_STRING - strlen(msg) - 1);
+    }
+}
+
+/************************************************************************/
+/*                        cmor_free_units_cache()                       */
+/*                                                                      */
+/*      Releases the units and converter cached on a variable by        */
+/*      cmor_write_var_to_file().                                       */
+/************************************************************************/
+void cmor_free_units_cache(cmor_var_t * avar)
+{
+    char msg[CMOR_MAX_STRING];
+
+    if (avar->units_converter != NULL) {
+        cv_free(avar->units_converter);
+        if (ut_get_status() != UT_SUCCESS) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "Udunits: Error freeing converter, variable %s "
+                     "(table: %s)", avar->id,
+                     cmor_tables[avar->ref_table_id].szTable_id);
+            cmor_handle_error(msg, CMOR_CRITICAL);
+        }
+    }
+    if (avar->cmor_units != NULL) {
+        ut_free(avar->cmor_units);
+        if (ut_get_status() != UT_SUCCESS) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "Udunits: Error freeing units, variable %s (table: %s)",
+                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
+            cmor_handle_error(msg, CMOR_CRITICAL);
+        }
+    }
+    if (avar->user_units != NULL) {
+        ut_free(avar->user_units);
+        if (ut_get_status() != UT_SUCCESS) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "Udunits: Error freeing units, variable %s (table: %s)",
+                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
+            cmor_handle_error(msg, CMOR_CRITICAL);
+        }
+    }
+    avar->units_converter = NULL;
+    avar->cmor_units = NULL;
+    avar->user_units = NULL;
+    avar->units_affine = -1;
+}
+
+/************************************************************************/
+/*                        cmor_staging_buffer()                         */
+/*                                                                      */
+/*      Buffer for one converted slice, kept on the variable and only   */
+/*      grown so slice-by-slice writers do not malloc a slab per call.  */
+/*      With write workers the variable rotates between two buffers,    */
+/*      waiting while both are queued.  Called with cmor_write_mutex    */
+/*      held.                                                           */
+/************************************************************************/
+void *cmor_staging_buffer(int var_id, size_t size, int *slot)
+{
+    void *tmp;
+    int k;
+
+    *slot = -1;
+    k = 0;
+    if (cmor_nwrite_threads > 0) {
+        k = cmor_vars[var_id].next_staging;
+        while (cmor_vars[var_id].staging_busy[k] == 1)
+            pthread_cond_wait(&cmor_write_done, &cmor_write_mutex);
+    }
+
+    if (cmor_vars[var_id].staging_size[k] < size) {
+        tmp = realloc(cmor_vars[var_id].staging[k], size);
+        if (tmp == NULL)
+            return (NULL);
+        cmor_vars[var_id].staging[k] = tmp;
+        cmor_vars[var_id].staging_size[k] = size;
+    }
+    if (cmor_nwrite_threads > 0)
+        cmor_vars[var_id].next_staging = 1 - k;
+    *slot = k;
+    return (cmor_vars[var_id].staging[k]);
+}
+
+/************************************************************************/
+/*                          cmor_time_buffer()                          */
+/************************************************************************/
+double *cmor_time_buffer(cmor_var_t * avar, size_t n)
+{
+    double *tmp;
+
+    if (avar->time_staging_size < n) {
+        tmp = realloc(avar->time_staging, n * sizeof(double));
+        if (tmp == NULL)
+            return (NULL);
+        avar->time_staging = tmp;
+        avar->time_staging_size = n;
+    }
+    return (avar->time_staging);
+}
+
+/************************************************************************/
+/*                          cmor_preallocate()                          */
+/*                                                                      */
+/*      Sizes the staging buffers of a defined variable for slabs of    */
+/*      ntimes time steps, so the first writes do not grow them.        */
+/************************************************************************/
+int cmor_preallocate(int var_id, int ntimes)
+{
+    cmor_var_t *avar;
+    char msg[CMOR_MAX_STRING];
+    char value[CMOR_MAX_STRING];
+    size_t nelements, size;
+    void *tmp;
+    int i, k, nslots;
+
+    cmor_add_traceback("cmor_preallocate");
+    cmor_is_setup();
+    cmor_lock();
+    if (cmor_valid_var_id(var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to preallocate variable id(%d) which was "
+                 "not initialized", var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_unlock();
+        cmor_pop_traceback();
+        return (-1);
+    }
+    avar = &cmor_vars[var_id];
+
+    if (ntimes < 1)
+        ntimes = 1;
+    nelements = 1;
+    for (i = 0; i < avar->ndims; i++) {
+        if (cmor_axes[avar->axes_ids[i]].axis == 'T')
+            nelements *= ntimes;
+        else
+            nelements *= cmor_axes[avar->axes_ids[i]].length;
+    }
+    if (avar->isbounds == 1)
+        nelements *= 2;
+
+    if (avar->type == 'd')
+        size = nelements * sizeof(double);
+    else if (avar->type == 'l')
+        size = nelements * sizeof(long);
+    else if (avar->type == 'i')
+        size = nelements * sizeof(int);
+    else
+        size = nelements * sizeof(float);
+
+/* -------------------------------------------------------------------- */
+/*      the second buffer is only used once write workers run           */
+/* -------------------------------------------------------------------- */
+    nslots = 1;
+    if (cmor_nwrite_threads > 0)
+        nslots = 2;
+    else if ((cmor_nwrite_threads < 0)
+             && (cmor_has_cur_dataset_attribute(CMOR_WRITE_THREADS) == 0)) {
+        cmor_get_cur_dataset_attribute(CMOR_WRITE_THREADS, value);
+        if (atoi(value) > 0)
+            nslots = 2;
+    }
+
+    for (k = 0; k < nslots; k++) {
+        if ((avar->staging_busy[k] == 1) || (avar->staging_size[k] >= size))
+            continue;
+        tmp = realloc(avar->staging[k], size);
+        if (tmp == NULL) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "cannot allocate %lu bytes of staging buffer for "
+                     "variable '%s' (table: %s)", (unsigned long)size,
+                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
+            cmor_handle_error_var(msg, CMOR_CRITICAL, var_id);
+            cmor_unlock();
+            cmor_pop_traceback();
+            return (1);
+        }
+        avar->staging[k] = tmp;
+        avar->staging_size[k] = size;
+    }
+    cmor_time_buffer(avar, (ntimes + 1) * 2);
+
+    cmor_unlock();
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                         cmor_free_staging()                          */
+/************************************************************************/
+void cmor_free_staging(cmor_var_t * avar)
+{
+    int k;
+
+    for (k = 0; k < 2; k++) {
+        if (avar->staging[k] != NULL)
+            free(avar->staging[k]);
+        avar->staging[k] = NULL;
+        avar->staging_size[k] = 0;
+        avar->staging_busy[k] = 0;
+    }
+    avar->next_staging = 0;
+    if (avar->time_staging != NULL)
+        free(avar->time_staging);
+    avar->time_staging = NULL;
+    avar->time_staging_size = 0;
+}
+
+/************************************************************************/
+/*                         cmor_track_written()                         */
+/*                                                                      */
+/*      Records the block of avar just written, in output order.  A     */
+/*      cmor_write() covers whole time steps, a cmor_write_region()     */
+/*      block is kept so cmor_check_written() can count the distinct    */
+/*      values of overlapping blocks.  Static variables use step 0.     */
+/************************************************************************/
+void cmor_track_written(cmor_var_t * avar, size_t * starts, size_t * counts)
+{
+    char *tmp;
+    int *blocks;
+    int i, n, t0, nt;
+
+    if ((avar->ndims > 0) && (cmor_axes[avar->axes_ids[0]].axis == 'T')) {
+        t0 = (int)starts[0];
+        nt = (int)counts[0];
+    } else {
+        t0 = 0;
+        nt = 1;
+    }
+    if (avar->written == NULL) {
+        avar->written_first = t0;
+        avar->written_size = 0;
+    }
+    if (t0 < avar->written_first)
+        return;
+    n = t0 + nt - avar->written_first;
+    if (n > avar->written_size) {
+        if (n < 2 * avar->written_size)
+            n = 2 * avar->written_size;
+        tmp = realloc(avar->written, n);
+        if (tmp == NULL)
+            return;
+        for (i = avar->written_size; i < n; i++)
+            tmp[i] = 0;
+        avar->written = tmp;
+        avar->written_size = n;
+    }
+    if (avar->region == 0) {
+        for (i = 0; i < nt; i++)
+            avar->written[t0 - avar->written_first + i] = 1;
+        return;
+    }
+/* -------------------------------------------------------------------- */
+/*      room for twice as many blocks each time a power of two is hit   */
+/* -------------------------------------------------------------------- */
+    n = avar->nwritten_blocks;
+    if ((n & (n - 1)) == 0) {
+        blocks = realloc(avar->written_blocks,
+                         2 * ((n > 0) ? 2 * n : 1) * avar->ndims *
+                         sizeof(int));
+        if (blocks == NULL)
+            return;
+        avar->written_blocks = blocks;
+    }
+    blocks = &avar->written_blocks[2 * n * avar->ndims];
+    for (i = 0; i < avar->ndims; i++) {
+        blocks[2 * i] = (int)starts[i];
+        blocks[2 * i + 1] = (int)counts[i];
+    }
+    avar->nwritten_blocks++;
+}
+
+/************************************************************************/
+/*                        cmor_count_covered()                          */
+/*                                                                      */
+/*      Number of distinct values of time step t (any step if itime is  */
+/*      -1) written by avar's region blocks, marked in mask of slab     */
+/*      bits.                                                           */
+/************************************************************************/
+static long cmor_count_covered(cmor_var_t * avar, int itime, int t,
+                               unsigned char *mask, long slab)
+{
+    int idx[CMOR_MAX_DIMENSIONS];
+    int *block;
+    long covered, offset, stride;
+    int b, i, d0;
+
+    memset(mask, 0, (slab + 7) / 8);
+    covered = 0;
+    d0 = itime + 1;
+    for (b = 0; b < avar->nwritten_blocks; b++) {
+        block = &avar->written_blocks[2 * b * avar->ndims];
+        if ((itime == 0)
+            && ((t < block[0]) || (t >= block[0] + block[1])))
+            continue;
+        for (i = d0; i < avar->ndims; i++)
+            idx[i] = 0;
+/* -------------------------------------------------------------------- */
+/*      walk the block, last dimension fastest                          */
+/* -------------------------------------------------------------------- */
+        for (;;) {
+            offset = 0;
+            stride = 1;
+            for (i = avar->ndims - 1; i >= d0; i--) {
+                offset += (block[2 * i] + idx[i]) * stride;
+                stride *= cmor_axes[avar->axes_ids[i]].length;
+            }
+            if ((mask[offset / 8] & (1 << (offset % 8))) == 0) {
+                mask[offset / 8] |= (1 << (offset % 8));
+                covered++;
+            }
+            for (i = avar->ndims - 1; i >= d0; i--) {
+                if (++idx[i] < block[2 * i + 1])
+                    break;
+                idx[i] = 0;
+            }
+            if (i < d0)
+                break;
+        }
+    }
+    return (covered);
+}
+
+/************************************************************************/
+/*                        cmor_check_coverage()                         */
+/*                                                                      */
+/*      Counts the time steps of avar written in this session that did  */
+/*      not receive every value of a slab, then forgets what was        */
+/*      written.  nofill tells whether the file is in NC_NOFILL mode.   */
+/************************************************************************/
+static int cmor_check_coverage(cmor_var_t * avar, int nofill)
+{
+    char msg[CMOR_MAX_STRING];
+    unsigned char *mask;
+    long slab;
+    int i, k, nt, itime, nbad, first_bad;
+
+    if (avar->written == NULL)
+        return (0);
+
+    slab = 1;
+    nt = 1;
+    itime = -1;
+    for (i = 0; i < avar->ndims; i++) {
+        if ((i == 0) && (cmor_axes[avar->axes_ids[i]].axis == 'T')) {
+            nt = avar->ntimes_written;
+            itime = 0;
+        } else {
+            slab *= cmor_axes[avar->axes_ids[i]].length;
+        }
+    }
+    mask = NULL;
+    if (avar->nwritten_blocks > 0) {
+        mask = malloc((slab + 7) / 8);
+        if (mask == NULL) {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "variable %s (table: %s): cannot allocate %ld bytes "
+                     "to check that every value was written",
+                     avar->id, cmor_tables[avar->ref_table_id].szTable_id,
+                     (slab + 7) / 8);
+            cmor_handle_error(msg, CMOR_WARNING);
+            cmor_free_written(avar);
+            return (0);
+        }
+    }
+
+    nbad = 0;
+    first_bad = -1;
+    for (i = avar->written_first; i < nt; i++) {
+        k = i - avar->written_first;
+        if ((k < avar->written_size) && (avar->written[k] == 1))
+            continue;
+        if ((mask != NULL)
+            && (cmor_count_covered(avar, itime, i, mask, slab) == slab))
+            continue;
+        if (nbad == 0)
+            first_bad = i;
+        nbad++;
+    }
+    if (mask != NULL)
+        free(mask);
+    if (nbad != 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "variable %s (table: %s): %i time step(s) were not "
+                 "fully written, starting at index %i%s",
+                 avar->id, cmor_tables[avar->ref_table_id].szTable_id,
+                 nbad, first_bad,
+                 (nofill == 1) ?
+                 ", they hold unset values (no fill mode)" : "");
+        cmor_handle_error(msg, (nofill == 1) ? CMOR_CRITICAL : CMOR_WARNING);
+    }
+    cmor_free_written(avar);
+    return (nbad != 0);
+}
+
+/************************************************************************/
+/*                         cmor_check_written()                         */
+/*                                                                      */
+/*      Before closing: every time step written in this session to      */
+/*      var_id's file, by var_id or the variables stored with it, must  */
+/*      have received a whole slab.  A gap holds whatever was on disk   */
+/*      in NC_NOFILL mode.                                              */
+/************************************************************************/
+int cmor_check_written(int var_id)
+{
+    cmor_var_t *avar = &cmor_vars[var_id];
+    int i, nbad;
+
+    cmor_add_traceback("cmor_check_written");
+    nbad = cmor_check_coverage(avar, avar->nofill);
+    for (i = 0; i < 10; i++) {
+        if (avar->associated_ids[i] != -1)
+            nbad += cmor_check_coverage(&cmor_vars[avar->associated_ids[i]],
+                                        avar->nofill);
+    }
+    if ((avar->grid_id > -1)
+        && (cmor_grids[avar->grid_id].istimevarying == 1)) {
+        for (i = 0; i < 4; i++) {
+            if (cmor_grids[avar->grid_id].associated_variables[i] != -1)
+                nbad += cmor_check_coverage(&cmor_vars[cmor_grids
+                                                       [avar->grid_id].
+                                                       associated_variables
+                                                       [i]], avar->nofill);
+        }
+    }
+    cmor_pop_traceback();
+    return (nbad != 0);
+}
+
+/************************************************************************/
+/*                         cmor_free_written()                          */
+/************************************************************************/
+void cmor_free_written(cmor_var_t * avar)
+{
+    if (avar->written != NULL)
+        free(avar->written);
+    avar->written = NULL;
+    avar->written_first = 0;
+    avar->written_size = 0;
+    if (avar->written_blocks != NULL)
+        free(avar->written_blocks);
+    avar->written_blocks = NULL;
+    avar->nwritten_blocks = 0;
+}
+
+/************************************************************************/
+/*                      cmor_get_units_cache_hits()                     */
+/*                                                                      */
+/*      Number of writes that reused the cached units converter.        */
+/************************************************************************/
+int cmor_get_units_cache_hits(int *var_id, int *hits)
+{
+    char msg[CMOR_MAX_STRING];
+
+    *hits = 0;
+    if (cmor_valid_var_id(*var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to get the units cache hits of variable "
+                 "id(%d) which was not initialized", *var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        return (-1);
+    }
+    *hits = cmor_vars[*var_id].units_cache_hits;
+    return (0);
+}
+
+/************************************************************************/
+/*                        cmor_get_chunk_cache()                        */
+/*                                                                      */
+/*      Size in bytes of the chunk cache of the variable's file, 0      */
+/*      before the file is created or for netCDF-3 files.               */
+/************************************************************************/
+int cmor_get_chunk_cache(int *var_id, size_t * size)
+{
+    char msg[CMOR_MAX_STRING];
+
+    *size = 0;
+    if (cmor_valid_var_id(*var_id) == 0) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "You attempt to get the chunk cache of variable "
+                 "id(%d) which was not initialized", *var_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        return (-1);
+    }
+    *size = cmor_vars[*var_id].chunk_cache;
+    return (0);
+}
+
+/************************************************************************/
+/*                         cmor_put_var_data()                          */
+/*                                                                      */
+/*      nc_put_vara of one converted slice, shared by the serial path   */
+/*      and the write workers.                                          */
+/************************************************************************/
+int cmor_put_var_data(int ncid, cmor_var_t * avar, char mtype,
+                      size_t * starts, size_t * counts, void *data)
+{
+    int ierr = NC_NOERR;
+    char msg[CMOR_MAX_STRING];
+
+    cmor_add_traceback("cmor_put_var_data");
+
+    if (mtype == 'd') {
+        ierr = nc_put_vara_double(ncid, avar->nc_var_id, starts, counts,
+                                  (double *)data);
+    } else if (mtype == 'f') {
+        ierr = nc_put_vara_float(ncid, avar->nc_var_id, starts, counts,
+                                 (float *)data);
+    } else if (mtype == 'l') {
+        ierr = nc_put_vara_long(ncid, avar->nc_var_id, starts, counts,
+                                (long *)data);
+    } else if (mtype == 'i') {
+        ierr = nc_put_vara_int(ncid, avar->nc_var_id, starts, counts,
+                               (int *)data);
+    }
+
+    if (ierr != NC_NOERR) {
+        snprintf(msg, CMOR_MAX_STRING,
+                 "NetCDF Error (%i: %s), writing variable '%s' (table %s) to file",
+                 ierr, nc_strerror(ierr), avar->id,
+                 cmor_tables[avar->ref_table_id].szTable_id);
+        cmor_handle_error(msg, CMOR_CRITICAL);
+        cmor_pop_traceback();
+        return (1);
+    }
+    cmor_pop_traceback();
+    return (0);
+}
+
+/************************************************************************/
+/*                       cmor_write_var_to_file()                       */
+/************************************************************************/
+int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
+                           char itype, int ntimes_passed,
+                           double *time_vals, double *time_bounds)
+{
+
+    size_t counts[CMOR_MAX_DIMENSIONS];
+    size_t counts2[CMOR_MAX_DIMENSIONS];
+    int counter[CMOR_MAX_DIMENSIONS];
+    int counter_orig[CMOR_MAX_DIMENSIONS];
+    int counter_orig2[CMOR_MAX_DIMENSIONS];
+    size_t starts[CMOR_MAX_DIMENSIONS];
+    int nelements, nelts;
+    double *data_tmp = NULL, amean;
+    int *idata_tmp = NULL;
+    long *ldata_tmp = NULL;
+    float *fdata_tmp = NULL;
+    char mtype;
+    int i, j, ierr = 0, dounits = 1;
+    char msg[CMOR_MAX_STRING];
+    char msg2[CMOR_MAX_STRING];
+    double *tmp_vals;
+    cv_converter *ut_cmor_converter = NULL;
+    char local_unit[CMOR_MAX_STRING];
+    int n_lower_min = 0, n_greater_max = 0;
+    double emax, emin, first_time;
+    char msg_min[CMOR_MAX_STRING];
+    char msg_max[CMOR_MAX_STRING];
+    extern ut_system *ut_read;
+    int tmpindex = 0;
+    int index;
+    cmor_reorder_t reorder;
+    double tile[CMOR_REORDER_TILE];
+    int rlength[CMOR_MAX_DIMENSIONS];
+    long rstride[CMOR_MAX_DIMENSIONS];
+    int rrevert[CMOR_MAX_DIMENSIONS];
+    int roffset[CMOR_MAX_DIMENSIONS];
+    char rtype;
+    int k, ntile;
+    char mask[CMOR_REORDER_TILE];
+    cmor_block_stats_t stats;
+    double check_min, check_max, scale, offset;
+    int imin = 0, imax = 0;
+    int unlocked, self, nomissing, staging, passthrough, rewrite, nsd;
+    int affine, async, status;
+    double missing, tolerance, omissing;
+    void *buffer;
+
+    cmor_add_traceback("cmor_write_var_to_file");
+    cmor_is_setup();
+
+    self = avar->self;
+    async = (cmor_nwrite_threads > 0) && (avar->async == 1);
+
+    emax = 0.;
+    emin = 0.;
+
+    if (strcmp(avar->ounits, avar->iunits) == 0)
+        dounits = 0;
+    mtype = avar->type;
+/* -------------------------------------------------------------------- */
+/*       This counts how many elements there is in each dimension and   */
+/*      the total number of elements written at this time This needs    */
+/*      to be passed to NetCDF.                                         */
+/*                                                                      */
+/*      do we have times ?                                              */
+/* -------------------------------------------------------------------- */
+    if (ntimes_passed != 0) {
+        counts[0] = ntimes_passed;
+        if (cmor_axes[avar->axes_ids[0]].axis != 'T') {
+            snprintf(msg, CMOR_MAX_STRING,
+                     "you are passing %i time steps for a static "
+                     "(no time dimension) variable (%s, table: %s), "
+                     "please pass 0 (zero) as the number of times",
+                     ntimes_passed, avar->id,
+                     cmor_tables[avar->ref_table_id].szTable_id);
             cmor_handle_error(msg, CMOR_CRITICAL);
         }
     } else {
@@ -2378,6 +3865,20 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
         counts[i] = cmor_axes[avar->axes_ids[i]].length;
         nelements = nelements * counts[i];
     }
+/* -------------------------------------------------------------------- */
+/*      cmor_write_region() only passes a block of each axis            */
+/* -------------------------------------------------------------------- */
+    rewrite = 0;
+    if (avar->region == 1) {
+        nelements = 1;
+        for (i = 0; i < avar->ndims; i++) {
+            if (cmor_axes[avar->axes_ids[i]].axis != 'T')
+                counts[i] = avar->region_count[i];
+            else if (avar->region_start[i] < avar->ntimes_written)
+                rewrite = 1;
+            nelements = nelements * counts[i];
+        }
+    }
     if (avar->isbounds == 1)
         nelements *= 2;
 /* -------------------------------------------------------------------- */
@@ -2394,15 +3895,11 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 /*      the order the user defined its variable                         */
 /* -------------------------------------------------------------------- */
 
-        if (cmor_axes[avar->axes_ids[i]].axis != 'T')
-            counter[i] = cmor_axes[avar->axes_ids[i]].length * counter[i + 1];
-        else
-            counter[i] = counts[0] * counter[i + 1];
-        if (cmor_axes[avar->original_order[i]].axis != 'T')
-            counter_orig[i] = cmor_axes[avar->original_order[i]].length
-              * counter_orig[i + 1];
-        else
-            counter_orig[i] = counts[0] * counter_orig[i + 1];
+        counter[i] = counts[i] * counter[i + 1];
+        for (j = 0; j < avar->ndims; j++) {
+            if (avar->axes_ids[j] == avar->original_order[i])
+                counter_orig[i] = counts[j] * counter_orig[i + 1];
+        }
     }
 /* -------------------------------------------------------------------- */
 /*       Now we need to map, i.e going ahead by 2 elements of final     */
@@ -2418,13 +3915,73 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
         }
     }
 
+    amean = 0.;
+    nelts = 0;
+
+/* -------------------------------------------------------------------- */
+/*      Describe each output axis as seen from the user's array         */
+/* -------------------------------------------------------------------- */
+    if (avar->isbounds) {
+        rlength[0] = nelements;
+        rstride[0] = 1;
+        rrevert[0] = cmor_axes[avar->axes_ids[0]].revert;
+        roffset[0] = 0;
+        cmor_reorder_init(&reorder, 1, rlength, rstride, rrevert, roffset);
+        rtype = 'd';
+    } else {
+        for (j = 0; j < avar->ndims; j++) {
+            cmor_axis_t *pAxis;
+            pAxis = &cmor_axes[avar->axes_ids[j]];
+            rlength[j] = counts[j];
+            rstride[j] = counter_orig2[j];
+            rrevert[j] = pAxis->revert;
+            roffset[j] = pAxis->offset;
+        }
+        cmor_reorder_init(&reorder, avar->ndims, rlength, rstride, rrevert,
+                          roffset);
+        rtype = itype;
+    }
+
+    if (avar->valid_min != (float)1.e20)
+        check_min = avar->valid_min;
+    else
+        check_min = -HUGE_VAL;
+    if (avar->valid_max != (float)1.e20)
+        check_max = avar->valid_max;
+    else
+        check_max = HUGE_VAL;
+
+/* -------------------------------------------------------------------- */
+/*      Nothing to reorder, convert or check: hand the user's array     */
+/*      to netCDF as is, letting it widen or narrow the type.  Not      */
+/*      for cmor_write_async(), the caller may reuse data on return.    */
+/* -------------------------------------------------------------------- */
+    passthrough = 0;
+    if ((async == 0)
+        && (cmor_reorder_contiguous(&reorder) == 1)
+        && (dounits == 0)
+        && (avar->sign == 1)
+        && (avar->nomissing == 1)
+        && (check_min == -HUGE_VAL) && (check_max == HUGE_VAL)
+        && (avar->ok_min_mean_abs == (float)1.e20)
+        && (avar->ok_max_mean_abs == (float)1.e20)
+        && (avar->significant_digits == 0)
+        && (cmor_passthrough_type(rtype, mtype) != 0))
+        passthrough = 1;
+    if ((passthrough == 1) && (cmor_passthrough_type(rtype, mtype) == 2)
+        && (cmor_passthrough_fits(data, rtype, mtype, nelements) == 0))
+        passthrough = 0;
+
 /* -------------------------------------------------------------------- */
 /*      Allocates the memory to store data to be written after          */
 /*      reordering and scaling/off-setting needs to figure out if we    */
 /*      need to touch the variable...                                   */
 /* -------------------------------------------------------------------- */
-    if (mtype == 'i') {
-        idata_tmp = malloc(sizeof(int) * nelements);
+    if (passthrough == 1) {
+        staging = -1;
+    } else if (mtype == 'i') {
+        idata_tmp = cmor_staging_buffer(self, sizeof(int) * nelements,
+                                        &staging);
         if (idata_tmp == NULL) {
             snprintf(msg, CMOR_MAX_STRING,
                      "cannot allocate memory for %i int tmp elts var '%s' "
@@ -2436,7 +3993,8 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 
     } else if (mtype == 'l') {
 
-        ldata_tmp = malloc(sizeof(long) * nelements);
+        ldata_tmp = cmor_staging_buffer(self, sizeof(long) * nelements,
+                                        &staging);
         if (ldata_tmp == NULL) {
             snprintf(msg, CMOR_MAX_STRING,
                      "cannot allocate memory for %i long tmp elts var '%s' "
@@ -2448,7 +4006,8 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 
     } else if (mtype == 'd') {
 
-        data_tmp = malloc(sizeof(double) * nelements);
+        data_tmp = cmor_staging_buffer(self, sizeof(double) * nelements,
+                                       &staging);
         if (data_tmp == NULL) {
             snprintf(msg, CMOR_MAX_STRING,
                      "cannot allocate memory for %i double tmp elts var '%s' "
@@ -2460,7 +4019,8 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 
     } else {
 
-        fdata_tmp = malloc(sizeof(float) * nelements);
+        fdata_tmp = cmor_staging_buffer(self, sizeof(float) * nelements,
+                                        &staging);
         if (fdata_tmp == NULL) {
             snprintf(msg, CMOR_MAX_STRING,
                      "cannot allocate memory for %i float tmp elts var '%s' "
@@ -2470,245 +4030,225 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
             cmor_handle_error(msg, CMOR_CRITICAL);
         }
     }
+    avar = &cmor_vars[self];
 
 /* -------------------------------------------------------------------- */
 /*      Reorder data, applies scaling, etc...                           */
 /* -------------------------------------------------------------------- */
     if (dounits == 1) {
 
-        strncpy(local_unit, avar->ounits, CMOR_MAX_STRING);
-        ut_trim(local_unit, UT_ASCII);
-        cmor_units = ut_parse(ut_read, local_unit, UT_ASCII);
-
-        if (ut_get_status() != UT_SUCCESS) {
-            snprintf(msg, CMOR_MAX_STRING,
-                     "in udunits analyzing units from cmor table "
-                     "(%s) for variable %s (table: %s)",
-                     local_unit, avar->id,
-                     cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-            cmor_pop_traceback();
-            return (1);
-        }
-
-        strncpy(local_unit, avar->iunits, CMOR_MAX_STRING);
-        ut_trim(local_unit, UT_ASCII);
-        user_units = ut_parse(ut_read, local_unit, UT_ASCII);
-
-        if (ut_get_status() != UT_SUCCESS) {
-            snprintf(msg, CMOR_MAX_STRING,
-                     "in udunits analyzing units from user (%s) "
-                     "for variable %s (table: %s)",
-                     local_unit, avar->id,
-                     cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-            cmor_pop_traceback();
-            return (1);
-        }
-
-        if (ut_are_convertible(cmor_units, user_units) == 0) {
-            snprintf(msg, CMOR_MAX_STRING,
-                     "variable: %s, cmor and user units are incompatible: "
-                     "%s and %s for variable %s (table: %s)",
-                     avar->id, avar->ounits, avar->iunits, avar->id,
-                     cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-            cmor_pop_traceback();
-            return (1);
-        }
-
-        ut_cmor_converter = ut_get_converter(user_units, cmor_units);
-
-        if (ut_get_status() != UT_SUCCESS) {
-            snprintf(msg, CMOR_MAX_STRING,
-                     " in udunits, getting converter for variable %s "
-                     "(table: %s)",
-                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-            cmor_pop_traceback();
-            return (1);
-        }
-    }
-
-    amean = 0.;
-    nelts = 0;
-
-    for (i = 0; i < nelements; i++) {
-        loc = i;
 /* -------------------------------------------------------------------- */
-/*      first figures out the coeff in final order                      */
-/*      puts the result in counter2                                     */
+/*      units and converter are kept on the variable until it is        */
+/*      closed, no need to parse them at each write                     */
 /* -------------------------------------------------------------------- */
-        for (j = 0; j < avar->ndims; j++) {
-            counter2[j] = (int)loc / (int)counter[j + 1];
+        if (avar->units_converter != NULL) {
+            avar->units_cache_hits++;
+        } else {
+            cmor_free_units_cache(avar);
+            strncpy(local_unit, avar->ounits, CMOR_MAX_STRING);
+            ut_trim(local_unit, UT_ASCII);
+            avar->cmor_units = ut_parse(ut_read, local_unit, UT_ASCII);
 
-/* -------------------------------------------------------------------- */
-/*      this is the reverse part doing it this way to avoid if test     */
-/* -------------------------------------------------------------------- */
-            loc = loc - counter2[j] * counter[j + 1];
-        }
+            if (ut_get_status() != UT_SUCCESS) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "in udunits analyzing units from cmor table "
+                         "(%s) for variable %s (table: %s)",
+                         local_unit, avar->id,
+                         cmor_tables[avar->ref_table_id].szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+                cmor_pop_traceback();
+                return (1);
+            }
 
-/* -------------------------------------------------------------------- */
-/*      now figures out what these indices meant in the original order  */
-/* -------------------------------------------------------------------- */
-        loc = 0;
-        for (j = 0; j < avar->ndims; j++) {
-            cmor_axis_t *pAxis;
-            pAxis = &cmor_axes[avar->axes_ids[j]];
-            if (pAxis->axis != 'T') {
+            strncpy(local_unit, avar->iunits, CMOR_MAX_STRING);
+            ut_trim(local_unit, UT_ASCII);
+            avar->user_units = ut_parse(ut_read, local_unit, UT_ASCII);
 
-                add = counter2[j] * pAxis->revert + (pAxis->length - 1) *
-                  (1 - pAxis->revert) / 2;
+            if (ut_get_status() != UT_SUCCESS) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "in udunits analyzing units from user (%s) "
+                         "for variable %s (table: %s)",
+                         local_unit, avar->id,
+                         cmor_tables[avar->ref_table_id].szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+                cmor_pop_traceback();
+                return (1);
+            }
 
-                loc = loc + (int)fmod(add + pAxis->offset, pAxis->length)
-                  * counter_orig2[j];
+            if (ut_are_convertible(avar->cmor_units, avar->user_units) == 0) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         "variable: %s, cmor and user units are incompatible: "
+                         "%s and %s for variable %s (table: %s)",
+                         avar->id, avar->ounits, avar->iunits, avar->id,
+                         cmor_tables[avar->ref_table_id].szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+                cmor_pop_traceback();
+                return (1);
+            }
 
-            } else {
+            avar->units_converter = ut_get_converter(avar->user_units,
+                                                     avar->cmor_units);
 
-                add = counter2[j] * pAxis->revert + (counts[0] - 1) *
-                  (1 - pAxis->revert) / 2;
-                loc = loc + (int)fmod(add + pAxis->offset, counts[0])
-                  * counter_orig2[j];
+            if (ut_get_status() != UT_SUCCESS) {
+                snprintf(msg, CMOR_MAX_STRING,
+                         " in udunits, getting converter for variable %s "
+                         "(table: %s)",
+                         avar->id, cmor_tables[avar->ref_table_id].szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+                cmor_pop_traceback();
+                return (1);
             }
-
         }
+        ut_cmor_converter = avar->units_converter;
 
 /* -------------------------------------------------------------------- */
-/*      Copy from user's data into our data                             */
+/*      most conversions are affine, find out once per variable         */
 /* -------------------------------------------------------------------- */
-        if (itype == 'd')
-            tmp = (double)((double *)data)[loc];
-        else if (itype == 'f')
-            tmp = (double)((float *)data)[loc];
-        else if (itype == 'i')
-            tmp = (double)((int *)data)[loc];
-        else if (itype == 'l')
-            tmp = (double)((long *)data)[loc];
-        if (avar->isbounds) {
+        if (avar->units_affine == -1)
+            avar->units_affine = cmor_affine_units(ut_cmor_converter,
+                                                   &avar->units_scale,
+                                                   &avar->units_offset);
+    }
 
-/* -------------------------------------------------------------------- */
-/*      ok here's the code to flip the code if necessary                */
-/* -------------------------------------------------------------------- */
-            if (cmor_axes[avar->axes_ids[0]].revert == -1) {
-                loc = nelements - i - 1;
-            } else {
-                loc = i;
-            }
-            tmp = (double)((double *)data)[loc];
-        }
+    scale = avar->sign;
+    offset = 0.;
+    if ((dounits == 1) && (avar->units_affine == 1)) {
+        scale = avar->units_scale * avar->sign;
+        offset = avar->units_offset * avar->sign;
+    }
 
-        tmp2 = (double)fabs(tmp - avar->missing);
+/* -------------------------------------------------------------------- */
+/*      With write threads the reorder/convert loop below only touches  */
+/*      its own buffers, so let other threads write or define           */
+/*      variables; cmor_vars may be reallocated meanwhile, hence the    */
+/*      copies.  udunits keeps a global status so non-affine units      */
+/*      stay locked, and so does a write nested in another entry point. */
+/* -------------------------------------------------------------------- */
+    nomissing = avar->nomissing;
+    missing = avar->missing;
+    tolerance = avar->tolerance;
+    omissing = avar->omissing;
+    nsd = avar->significant_digits;
+    affine = avar->units_affine;
+    unlocked = 0;
+    if ((cmor_nwrite_threads > 0) && (cmor_lock_depth == 1)
+        && !((dounits == 1) && (affine != 1))) {
+        unlocked = 1;
+        cmor_unlock();
+    }
 
-        if ((avar->nomissing == 0)
-            && (tmp2 <= avar->tolerance * (double)fabs(tmp))) {
-            tmp = avar->omissing;
+    i = 0;
+    while ((passthrough == 0)
+           && ((ntile = cmor_reorder_next(&reorder, data, rtype, tile)) > 0)) {
 
-        } else {
-            if (dounits == 1) {
+        if (nomissing == 0)
+            cmor_block_missing(tile, ntile, missing, tolerance, mask);
+        else
+            memset(mask, 0, ntile);
 
-                tmp = cv_convert_double(ut_cmor_converter, tmp);
+        if ((dounits == 1) && (affine != 1)) {
+            cv_convert_doubles(ut_cmor_converter, tile, ntile, tile);
 
-                if (ut_get_status() != UT_SUCCESS) {
-                    snprintf(msg, CMOR_MAX_STRING,
-                             "in udunits, converting values from %s to %s "
-                             "for variable %s (table: %s)",
-                             avar->iunits, avar->ounits, avar->id,
-                             cmor_tables[avar->ref_table_id].szTable_id);
-                    cmor_handle_error(msg, CMOR_CRITICAL);
-                    cmor_pop_traceback();
-                    return (1);
+            if (ut_get_status() != UT_SUCCESS) {
+                if (unlocked == 1) {
+                    cmor_lock();
+                    avar = &cmor_vars[self];
                 }
+                snprintf(msg, CMOR_MAX_STRING,
+                         "in udunits, converting values from %s to %s "
+                         "for variable %s (table: %s)",
+                         avar->iunits, avar->ounits, avar->id,
+                         cmor_tables[avar->ref_table_id].szTable_id);
+                cmor_handle_error(msg, CMOR_CRITICAL);
+                cmor_pop_traceback();
+                return (1);
             }
+        }
 
-            tmp = tmp * avar->sign;     /* do we need to change the sign ? */
-            amean += fabs(tmp);
-            nelts += 1;
-
-            if ((avar->valid_min != (float)1.e20) && (tmp < avar->valid_min)) {
-
-                n_lower_min += 1;
-                if ((n_lower_min == 1) || (tmp < emin)) {       /*minimum val */
-                    emin = tmp;
-                    snprintf(msg_min, CMOR_MAX_STRING,
-                             "Invalid value(s) detected for variable '%s' "
-                             "(table: %s): %%i values were lower than minimum "
-                             "valid value (%.4g). Minimum encountered bad "
-                             "value (%.5g) was at (axis: index/value):",
-                             avar->id,
-                             cmor_tables[avar->ref_table_id].szTable_id,
-                             avar->valid_min, tmp);
-
-                    for (j = 0; j < avar->ndims; j++) {
-                        cmor_axis_t *pAxis;
-                        pAxis = &cmor_axes[avar->axes_ids[j]];
-                        if (pAxis->values != NULL) {
-                            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
-                                     pAxis->id, counter2[j],
-                                     pAxis->values[counter2[j]]);
-
-                        } else {
-                            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
-                                     pAxis->id, counter2[j],
-                                     time_vals[counter2[j]]);
-                        }
-                        strncat(msg_min, msg2, CMOR_MAX_STRING - strlen(msg));
-                    }
-                }
+        stats.sum_abs = 0.;
+        stats.nelts = 0;
+        stats.n_lower_min = 0;
+        stats.n_greater_max = 0;
+        stats.vmin = HUGE_VAL;
+        stats.vmax = -HUGE_VAL;
+        cmor_block_stats(tile, ntile, mask, scale, offset, omissing,
+                         check_min, check_max, &stats);
+        amean += stats.sum_abs;
+        nelts += stats.nelts;
+
+/* -------------------------------------------------------------------- */
+/*      remember where the worst values are, messages are built later   */
+/* -------------------------------------------------------------------- */
+        if (stats.n_lower_min != 0) {
+            if ((n_lower_min == 0) || (stats.vmin < emin)) {
+                emin = stats.vmin;
+                for (k = 0; k < ntile; k++)
+                    if ((mask[k] == 0) && (tile[k] == emin))
+                        break;
+                imin = i + k;
             }
-            if ((avar->valid_max != (float)1.e20) && (tmp > avar->valid_max)) {
-
-                n_greater_max += 1;
-
-                if ((n_greater_max == 1) || (tmp > emax)) {
-
-                    emax = tmp;
-                    snprintf(msg_max, CMOR_MAX_STRING,
-                             "Invalid value(s) detected for variable '%s' "
-                             "(table: %s): %%i values were greater than "
-                             "maximum valid value (%.4g).Maximum encountered "
-                             "bad value (%.5g) was at (axis: index/value):",
-                             avar->id,
-                             cmor_tables[avar->ref_table_id].szTable_id,
-                             avar->valid_max, tmp);
-
-                    for (j = 0; j < avar->ndims; j++) {
-                        cmor_axis_t *pAxis;
-                        pAxis = &cmor_axes[avar->axes_ids[j]];
-
-                        if (pAxis->values != NULL) {
-                            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
-                                     pAxis->id, counter2[j],
-                                     pAxis->values[counter2[j]]);
-                        } else {
-                            snprintf(msg2, CMOR_MAX_STRING, " %s: %i/%.5g",
-                                     pAxis->id, counter2[j],
-                                     time_vals[counter2[j]]);
-                        }
-
-                        strncat(msg_max, msg2, CMOR_MAX_STRING - strlen(msg));
-                    }
-                }
+            n_lower_min += stats.n_lower_min;
+        }
+        if (stats.n_greater_max != 0) {
+            if ((n_greater_max == 0) || (stats.vmax > emax)) {
+                emax = stats.vmax;
+                for (k = 0; k < ntile; k++)
+                    if ((mask[k] == 0) && (tile[k] == emax))
+                        break;
+                imax = i + k;
             }
+            n_greater_max += stats.n_greater_max;
         }
 
-        if (mtype == 'i')
-            idata_tmp[i] = (int)tmp;
-        else if (mtype == 'l')
-            ldata_tmp[i] = (long)tmp;
-        else if (mtype == 'f')
-            fdata_tmp[i] = (float)tmp;
-        else if (mtype == 'd')
-            data_tmp[i] = (double)tmp;
-
+        if (mtype == 'i') {
+            for (k = 0; k < ntile; k++)
+                idata_tmp[i + k] = (int)tile[k];
+        } else if (mtype == 'l') {
+            for (k = 0; k < ntile; k++)
+                ldata_tmp[i + k] = (long)tile[k];
+        } else if (mtype == 'f') {
+            for (k = 0; k < ntile; k++)
+                fdata_tmp[i + k] = (float)tile[k];
+            if (nsd > 0)
+                cmor_groom_floats(&fdata_tmp[i], mask, ntile, i, nsd);
+        } else if (mtype == 'd') {
+            memcpy(&data_tmp[i], tile, ntile * sizeof(double));
+            if (nsd > 0)
+                cmor_groom_doubles(&data_tmp[i], mask, ntile, i, nsd);
+        }
+        i += ntile;
     }
+    if (unlocked == 1) {
+        cmor_lock();
+        avar = &cmor_vars[self];
+    }
+
     if (n_lower_min != 0) {
 
+        snprintf(msg_min, CMOR_MAX_STRING,
+                 "Invalid value(s) detected for variable '%s' "
+                 "(table: %s): %%i values were lower than minimum "
+                 "valid value (%.4g). Minimum encountered bad "
+                 "value (%.5g) was at (axis: index/value):",
+                 avar->id,
+                 cmor_tables[avar->ref_table_id].szTable_id,
+                 avar->valid_min, emin);
+        cmor_append_location(msg_min, avar, counter, imin, time_vals);
         snprintf(msg, CMOR_MAX_STRING, msg_min, n_lower_min);
         cmor_handle_error(msg, CMOR_WARNING);
 
     }
     if (n_greater_max != 0) {
 
+        snprintf(msg_max, CMOR_MAX_STRING,
+                 "Invalid value(s) detected for variable '%s' "
+                 "(table: %s): %%i values were greater than "
+                 "maximum valid value (%.4g).Maximum encountered "
+                 "bad value (%.5g) was at (axis: index/value):",
+                 avar->id,
+                 cmor_tables[avar->ref_table_id].szTable_id,
+                 avar->valid_max, emax);
+        cmor_append_location(msg_max, avar, counter, imax, time_vals);
         snprintf(msg, CMOR_MAX_STRING, msg_max, n_greater_max);
         cmor_handle_error(msg, CMOR_WARNING);
 
@@ -2760,40 +4300,6 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 
         }
     }
-    if (dounits == 1) {
-
-        cv_free(ut_cmor_converter);
-
-        if (ut_get_status() != UT_SUCCESS) {
-
-            snprintf(msg, CMOR_MAX_STRING,
-                     "Udunits: Error freeing converter, variable %s "
-                     "(table: %s)", avar->id,
-                     cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-
-        }
-
-        ut_free(cmor_units);
-        if (ut_get_status() != UT_SUCCESS) {
-
-            snprintf(msg, CMOR_MAX_STRING,
-                     "Udunits: Error freeing units, variable %s (table: %s)",
-                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-
-        }
-
-        ut_free(user_units);
-        if (ut_get_status() != UT_SUCCESS) {
-
-            snprintf(msg, CMOR_MAX_STRING,
-                     "Udunits: Error freeing units, variable %s (table: %s)",
-                     avar->id, cmor_tables[avar->ref_table_id].szTable_id);
-            cmor_handle_error(msg, CMOR_CRITICAL);
-
-        }
-    }
 /* -------------------------------------------------------------------- */
 /*      Initialize the start index in each dimensions                   */
 /* -------------------------------------------------------------------- */
@@ -2806,7 +4312,11 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 /*      Write the times passed by user                                  */
 /* -------------------------------------------------------------------- */
 
-    if (ntimes_passed != 0) {
+    if (rewrite == 1) {
+/* -------------------------------------------------------------------- */
+/*      another block of time steps already written, times are there    */
+/* -------------------------------------------------------------------- */
+    } else if (ntimes_passed != 0) {
         if (time_vals != NULL) {
             if (cmor_axes[avar->axes_ids[0]].values != NULL) {
                 snprintf(msg, CMOR_MAX_STRING,
@@ -2824,7 +4334,7 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
                 cmor_get_axis_attribute(avar->axes_ids[0], "units", 'c', &msg);
                 cmor_get_cur_dataset_attribute("calendar", msg2);
 
-                tmp_vals = malloc((ntimes_passed + 1) * 2 * sizeof(double));
+                tmp_vals = cmor_time_buffer(avar, (ntimes_passed + 1) * 2);
                 if (tmp_vals == NULL) {
                     snprintf(msg, CMOR_MAX_STRING,
                              "cannot malloc %i tmp bounds time vals "
@@ -2988,7 +4498,6 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
 
                 avar->last_time = tmp_vals[ntimes_passed - 1];
 
-                free(tmp_vals);
             } else {
 /* -------------------------------------------------------------------- */
 /*      checks if you need bounds or not                                */
@@ -3012,7 +4521,7 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
                 cmor_get_axis_attribute(avar->axes_ids[0], "units", 'c', &msg);
                 cmor_get_cur_dataset_attribute("calendar", msg2);
 
-                tmp_vals = malloc(ntimes_passed * sizeof(double));
+                tmp_vals = cmor_time_buffer(avar, ntimes_passed);
 
                 if (tmp_vals == NULL) {
                     snprintf(msg, CMOR_MAX_STRING,
@@ -3039,7 +4548,6 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
                 }
                 avar->last_time = tmp_vals[ntimes_passed - 1];
 
-                free(tmp_vals);
                 if (ierr != NC_NOERR) {
                     snprintf(msg, CMOR_MAX_STRING,
                              "NetCDF error (%i: %s) writing times for variable '%s' "
@@ -3225,44 +4733,53 @@ int cmor_write_var_to_file(int ncid, cmor_var_t * avar, void *data,
         }
     }
 
+/* -------------------------------------------------------------------- */
+/*      the time writes above reuse starts                              */
+/* -------------------------------------------------------------------- */
+    if (avar->region == 1) {
+        for (i = 0; i < avar->ndims; i++)
+            starts[i] = avar->region_start[i];
+    }
+
     if (avar->isbounds) {
         counts[avar->ndims] = 2;
         starts[avar->ndims] = 0;
     }
 
-    if (mtype == 'd') {
-        ierr = nc_put_vara_double(ncid, avar->nc_var_id, starts, counts,
-                                  data_tmp);
-    } else if (mtype == 'f') {
-        ierr = nc_put_vara_float(ncid, avar->nc_var_id, starts, counts,
-                                 fdata_tmp);
-    } else if (mtype == 'l') {
-        ierr = nc_put_vara_long(ncid, avar->nc_var_id, starts, counts,
-                                ldata_tmp);
-    } else if (mtype == 'i') {
-        ierr = nc_put_vara_int(ncid, avar->nc_var_id, starts, counts,
-                               idata_tmp);
-    }
+    if (passthrough == 1)
+        buffer = data;
+    else if (mtype == 'd')
+        buffer = data_tmp;
+    else if (mtype == 'f')
+        buffer = fdata_tmp;
+    else if (mtype == 'l')
+        buffer = ldata_tmp;
+    else
+        buffer = idata_tmp;
 
-    if (ierr != NC_NOERR) {
-        snprintf(msg, CMOR_MAX_STRING,
-                 "NetCDF Error (%i: %s), writing variable '%s' (table %s) to file",
-                 ierr, nc_strerror(ierr), avar->id,
-                 cmor_tables[avar->ref_table_id].szTable_id);
-        cmor_handle_error(msg, CMOR_CRITICAL);
+    status = 0;
+    if (async == 1) {
+/* -------------------------------------------------------------------- */
+/*      the worker frees or releases the buffer from here on            */
+/* -------------------------------------------------------------------- */
+        cmor_queue_write(ncid, avar, mtype, starts, counts, buffer, staging);
+        avar = &cmor_vars[self];
+    } else {
+/* -------------------------------------------------------------------- */
+/*      slices queued by earlier cmor_write_async() calls go first      */
+/* -------------------------------------------------------------------- */
+        cmor_wait_writes(ncid);
+        avar = &cmor_vars[self];
+        status = cmor_put_var_data(ncid, avar,
+                                   (passthrough == 1) ? rtype : mtype,
+                                   starts, counts, buffer);
     }
 
-    avar->ntimes_written += ntimes_passed;
+    cmor_track_written(avar, starts, counts);
 
-    if (mtype == 'd')
-        free(data_tmp);
-    else if (mtype == 'f')
-        free(fdata_tmp);
-    else if (mtype == 'l')
-        free(ldata_tmp);
-    else if (mtype == 'i')
-        free(idata_tmp);
+    if (rewrite == 0)
+        avar->ntimes_written += ntimes_passed;
 
     cmor_pop_traceback();
-    return (0);
+    return (status);
 }
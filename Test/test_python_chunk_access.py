@@ -0,0 +1,61 @@
+import cmor
+import unittest
+import subprocess
+import re
+from test_python_latlon_common import *
+
+ntimes = 12
+
+
+def chunk_sizes(path, name):
+    header = subprocess.check_output(["ncdump", "-hs", path])
+    match = re.search(name + r':_ChunkSizes = ([0-9, ]+) ;', header)
+    return [int(v) for v in match.group(1).split(",")]
+
+
+class TestCase(LatLonTestCase):
+
+    netcdf_file_action = cmor.CMOR_REPLACE_4
+
+    def writeTas(self, ntimes=ntimes):
+        ivar = define_variable(ntimes=ntimes)
+        cmor.write(ivar, random_tas(ntimes))
+        path = cmor.close(ivar, True)
+        cmor.close()
+        return path
+
+    def testMap(self):
+        # whole maps, the small file fits in a single chunk
+        path = self.writeTas()
+        self.assertEqual(chunk_sizes(path, "tas"), [ntimes, nlat, nlon])
+
+    def testTimeSeries(self):
+        cmor.set_cur_dataset_attribute("_chunk_access", "timeseries")
+        cmor.set_cur_dataset_attribute("_chunk_size", "40000")
+        path = self.writeTas()
+        t, y, x = chunk_sizes(path, "tas")
+        self.assertEqual(t, ntimes)
+        self.assertTrue(y * x < nlat * nlon)
+        self.assertTrue(t * y * x * 4 <= 40000)
+
+    def testBalanced(self):
+        cmor.set_cur_dataset_attribute("_chunk_access", "balanced")
+        cmor.set_cur_dataset_attribute("_chunk_size", "4000")
+        path = self.writeTas()
+        t, y, x = chunk_sizes(path, "tas")
+        self.assertTrue(t < ntimes and y < nlat and x < nlon)
+        self.assertTrue(t * y * x * 4 <= 4000)
+
+    def testBalancedSingleStep(self):
+        # a length one dimension stays one, the others share the budget
+        cmor.set_cur_dataset_attribute("_chunk_access", "balanced")
+        cmor.set_cur_dataset_attribute("_chunk_size", "4000")
+        path = self.writeTas(1)
+        t, y, x = chunk_sizes(path, "tas")
+        self.assertEqual(t, 1)
+        self.assertTrue(y < nlat and x < nlon)
+        self.assertTrue(y * x * 4 <= 4000)
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,61 @@
+import cmor
+import numpy
+import unittest
+import shutil
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 24
+
+
+class TestCase(unittest.TestCase):
+
+    def writeTas(self, attribute=None, **kwargs):
+        setup(cmor.CMOR_REPLACE_4, **kwargs)
+        if attribute is not None:
+            cmor.set_cur_dataset_attribute("_chunk_cache", attribute)
+        # chunks span many time steps, written one step at a time
+        cmor.set_cur_dataset_attribute("_chunk_access", "timeseries")
+        cmor.set_cur_dataset_attribute("_chunk_size", "40000")
+        ivar = define_variable(ntimes=ntimes)
+        data = random_tas(ntimes)
+        for i in range(ntimes):
+            cmor.write(ivar, data[i:i + 1], ntimes_passed=1)
+        size = cmor.get_chunk_cache(ivar)
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas, data, rtol=1.e-5))
+        f.close()
+        return size
+
+    def testSized(self):
+        # every chunk of a time step is held between writes
+        self.assertTrue(self.writeTas() >= nlat * nlon * 4)
+
+    def testSetup(self):
+        size = 8 * 1024 * 1024
+        self.assertEqual(self.writeTas(chunk_cache=size), size)
+
+    def testAttribute(self):
+        size = 3 * 1024 * 1024 + 1
+        self.assertEqual(self.writeTas(attribute=str(size)), size)
+
+    def testBadAttribute(self):
+        # a bad size is ignored, the cache is sized as if it was not set
+        sized = self.writeTas()
+        self.assertEqual(self.writeTas(attribute="-1"), sized)
+        self.assertEqual(self.writeTas(attribute="4M"), sized)
+
+    def testBadSetup(self):
+        self.assertRaises(Exception, cmor.setup, inpath='Tables',
+                          chunk_cache=-1)
+
+    def tearDown(self):
+        shutil.rmtree("./CMIP6", ignore_errors=True)
+
+
+if __name__ == '__main__':
+    run()
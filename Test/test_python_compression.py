@@ -0,0 +1,39 @@
+import cmor
+import numpy
+import unittest
+import subprocess
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 2
+
+
+class TestCase(LatLonTestCase):
+
+    netcdf_file_action = cmor.CMOR_REPLACE_4
+
+    def testGroomAndChecksum(self):
+        ivar = define_variable()
+        cmor.set_compression(ivar, fletcher32=True, significant_digits=3)
+
+        data = random_tas(ntimes)
+        cmor.write(ivar, data, time_vals=numpy.arange(ntimes) + .5,
+                   time_bnds=numpy.arange(ntimes + 1))
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        header = subprocess.check_output(["ncdump", "-hs", path])
+        self.assertIn('tas:_Fletcher32 = "true"', header)
+        self.assertIn("tas:quantization_nsd = 3", header)
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        # 3 digits are kept, the trailing bits are gone
+        self.assertTrue(numpy.allclose(tas, data, rtol=5.e-3, atol=0.))
+        self.assertFalse(numpy.allclose(tas, data.astype("f"), rtol=1.e-6,
+                                        atol=0.))
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
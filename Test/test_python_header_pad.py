@@ -0,0 +1,54 @@
+import cmor
+import numpy
+import unittest
+import os
+import shutil
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 2
+
+
+class TestCase(unittest.TestCase):
+
+    def writeTas(self, pad, align=None):
+        setup(cmor.CMOR_REPLACE_3)
+        if pad is not None:
+            cmor.set_cur_dataset_attribute("_header_pad", pad)
+        if align is not None:
+            cmor.set_cur_dataset_attribute("_var_align", align)
+        ivar = define_variable()
+        self.data = random_tas(ntimes)
+        cmor.write(ivar, self.data, time_vals=numpy.arange(ntimes) + .5,
+                   time_bnds=numpy.arange(ntimes + 1))
+        path = cmor.close(ivar, True)
+        cmor.close()
+        size = os.path.getsize(path)
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas, self.data, rtol=1.e-5))
+        f.close()
+        return size
+
+    def testHeaderPad(self):
+        # the padded file carries the free space between header and data
+        small = self.writeTas("0")
+        large = self.writeTas("65536")
+        self.assertTrue(large - small >= 65536 - 4)
+        aligned = self.writeTas("0", "65536")
+        self.assertTrue(aligned >= 65536)
+
+    def testBadHeaderPad(self):
+        # sizes that are not plain numbers are ignored with a warning
+        default = self.writeTas(None)
+        self.assertEqual(self.writeTas("64k"), default)
+        self.assertEqual(self.writeTas("-1"), default)
+        self.assertEqual(self.writeTas(None, "4k"), default)
+
+    def tearDown(self):
+        shutil.rmtree("./CMIP6")
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,65 @@
+import cmor
+import numpy
+import shutil
+import unittest
+
+# shared set up of the tests writing a single field on a 4 x 4 degree
+# global grid, tas from the Amon table unless told otherwise
+nlat = 45
+nlon = 90
+
+
+def run():
+    unittest.main()
+
+
+def setup(netcdf_file_action=cmor.CMOR_REPLACE, **kwargs):
+    cmor.setup(inpath='Tables', netcdf_file_action=netcdf_file_action,
+               **kwargs)
+    cmor.dataset_json("Test/common_user_input.json")
+
+
+def axes(ntimes=None, north_to_south=False):
+    # time, latitude and longitude of the current table, time only gets
+    # its values up front when ntimes is given
+    dlat = 180. / nlat
+    dlon = 360. / nlon
+    alats = numpy.arange(-90 + dlat / 2., 90, dlat)
+    bnds_lat = numpy.arange(-90, 90 + dlat, dlat)
+    if north_to_south:
+        alats = alats[::-1]
+        bnds_lat = bnds_lat[::-1]
+    alons = numpy.arange(0 + dlon / 2., 360., dlon)
+    bnds_lon = numpy.arange(0, 360. + dlon, dlon)
+    if ntimes is None:
+        itim = cmor.axis(table_entry='time', units='days since 2010-1-1')
+    else:
+        itim = cmor.axis(table_entry='time', units='days since 2010-1-1',
+                         coord_vals=numpy.arange(ntimes) + .5,
+                         cell_bounds=numpy.arange(ntimes + 1))
+    ilat = cmor.axis(table_entry='latitude', units='degrees_north',
+                     coord_vals=alats, cell_bounds=bnds_lat)
+    ilon = cmor.axis(table_entry='longitude', units='degrees_east',
+                     coord_vals=alons, cell_bounds=bnds_lon)
+    return [itim, ilat, ilon]
+
+
+def define_variable(name="tas", units="K", table="Tables/CMIP6_Amon.json",
+                    **kwargs):
+    cmor.load_table(table)
+    return cmor.variable(name, axis_ids=axes(**kwargs), units=units)
+
+
+def random_tas(ntimes):
+    return numpy.random.random((ntimes, nlat, nlon)) * 30. + 273.15
+
+
+class LatLonTestCase(unittest.TestCase):
+
+    netcdf_file_action = cmor.CMOR_REPLACE
+
+    def setUp(self, *args, **kwargs):
+        setup(self.netcdf_file_action)
+
+    def tearDown(self):
+        shutil.rmtree("./CMIP6")
@@ -0,0 +1,52 @@
+import cmor
+import glob
+import numpy
+import os
+import unittest
+
+# ==============================
+#  main thread
+# ==============================
+
+
+def run():
+    unittest.main()
+
+
+# CV, coordinate, grid and deliberately broken test tables are skipped
+skip = ("CV", "coordinate", "formula_terms", "grids", "bad", "missing",
+        "cf3hr_", "chunking")
+
+
+class TestCase(unittest.TestCase):
+
+    def setUp(self, *args, **kwargs):
+        cmor.setup(inpath='Tables', netcdf_file_action=cmor.CMOR_REPLACE)
+        cmor.dataset_json("Test/common_user_input.json")
+
+    def testLoadAllTables(self):
+        tables = [t for t in sorted(glob.glob("Tables/CMIP6_*.json"))
+                  if not any(s in os.path.basename(t) for s in skip)]
+        ids = [cmor.load_table(t) for t in tables]
+        self.assertGreater(len(ids), 30)
+        self.assertEqual(len(set(ids)), len(ids))
+
+        # entries of the first tables are still usable once all are loaded
+        cmor.set_table(ids[tables.index("Tables/CMIP6_Amon.json")])
+        ilat = cmor.axis(table_entry='latitude', units='degrees_north',
+                         coord_vals=[0.], cell_bounds=[-1., 1.])
+        ilon = cmor.axis(table_entry='longitude', units='degrees_east',
+                         coord_vals=[90.], cell_bounds=[89., 91.])
+        itim = cmor.axis(table_entry='time', units='days since 2010-1-1')
+        ivar = cmor.variable("tas", axis_ids=[itim, ilat, ilon], units="K")
+        cmor.write(ivar, numpy.array([280.]), time_vals=[15.5],
+                   time_bnds=[0., 31.])
+        cmor.close()
+
+    def tearDown(self):
+        import shutil
+        shutil.rmtree("./CMIP6")
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,64 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 3
+
+
+class TestCase(LatLonTestCase):
+
+    def testNoFill(self):
+        # default: no pre-fill, whole slabs from cmor.write
+        ivar = define_variable()
+        data = random_tas(ntimes)
+        cmor.write(ivar, data, time_vals=numpy.arange(ntimes) + .5,
+                   time_bnds=numpy.arange(ntimes + 1))
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertEqual(tas.shape, (ntimes, nlat, nlon))
+        self.assertTrue(numpy.allclose(tas, data, rtol=1.e-5))
+        f.close()
+
+    def testFillWithGap(self):
+        # with pre-fill on, a region left out reads back as missing
+        cmor.set_cur_dataset_attribute("_nofill", "0")
+        ivar = define_variable()
+        data = random_tas(1)
+        cmor.write(ivar, data[:, :20], time_vals=[.5], time_bnds=[0, 1.],
+                   start=[0, 0, 0])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas[:, :20], data[:, :20],
+                                       rtol=1.e-5))
+        self.assertTrue(tas.mask[:, 20:].all())
+        f.close()
+
+    def testRegionKeepsFill(self):
+        # cmor.write with start keeps the pre-fill unless asked not to
+        ivar = define_variable()
+        data = random_tas(1)
+        cmor.write(ivar, data[:, :, :30], time_vals=[.5], time_bnds=[0, 1.],
+                   start=[0, 0, 0])
+        cmor.write(ivar, data[:, :, :20], time_vals=[.5], time_bnds=[0, 1.],
+                   start=[0, 0, 0])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas[:, :, :30], data[:, :, :30],
+                                       rtol=1.e-5))
+        self.assertTrue(tas.mask[:, :, 30:].all())
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,28 @@
+import cmor
+import unittest
+import hashlib
+import os
+from test_python_latlon_common import *
+
+
+class TestCase(LatLonTestCase):
+
+    def setUp(self, *args, **kwargs):
+        LatLonTestCase.setUp(self)
+        cmor.set_cur_dataset_attribute("_output_checksum", "md5")
+
+    def testOutputChecksum(self):
+        ivar = define_variable()
+        cmor.write(ivar, random_tas(1), time_vals=[.5], time_bnds=[0, 1.])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        with open(path + ".md5") as f:
+            checksum, name = f.read().split()
+        with open(path, "rb") as f:
+            self.assertEqual(checksum, hashlib.md5(f.read()).hexdigest())
+        self.assertEqual(name, os.path.basename(path))
+
+
+if __name__ == '__main__':
+    run()
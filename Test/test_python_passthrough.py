@@ -0,0 +1,54 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 3
+
+
+class TestCase(LatLonTestCase):
+
+    def write(self, data):
+        # same units, order and no missing value: written without a copy
+        ivar = define_variable()
+        for i in range(ntimes):
+            cmor.write(ivar, data[i:i + 1], time_vals=[i + .5],
+                       time_bnds=[i, i + 1.])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        f.close()
+        return tas
+
+    def testSameType(self):
+        data = random_tas(ntimes).astype("f")
+        tas = self.write(data)
+        self.assertTrue(numpy.array_equal(numpy.array(tas), data))
+
+    def testNarrowing(self):
+        # doubles that fit a float are handed to netCDF to narrow
+        data = random_tas(ntimes)
+        tas = self.write(data)
+        self.assertTrue(numpy.array_equal(numpy.array(tas),
+                                          data.astype("f")))
+
+    def testNarrowingLong(self):
+        data = numpy.random.randint(250, 300, (ntimes, nlat, nlon)) \
+            .astype("l")
+        tas = self.write(data)
+        self.assertTrue(numpy.array_equal(numpy.array(tas),
+                                          data.astype("f")))
+
+    def testWidening(self):
+        data = numpy.random.randint(250, 300, (ntimes, nlat, nlon)) \
+            .astype("i")
+        tas = self.write(data)
+        self.assertTrue(numpy.array_equal(numpy.array(tas),
+                                          data.astype("f")))
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,29 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 8
+
+
+class TestCase(LatLonTestCase):
+
+    def testPreallocate(self):
+        ivar = define_variable()
+        data = random_tas(ntimes)
+        cmor.preallocate(ivar, 1)
+        for i in range(ntimes):
+            cmor.write(ivar, data[i:i + 1], time_vals=[i + .5],
+                       time_bnds=[i, i + 1.])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas, data, rtol=1.e-5))
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,91 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+import glob
+import os
+import shutil
+import struct
+import time
+from test_python_latlon_common import *
+
+cache_dir = "Test/table_cache"
+ntimes = 2
+
+
+class TestCase(unittest.TestCase):
+
+    def setUp(self, *args, **kwargs):
+        if os.path.exists(cache_dir):
+            shutil.rmtree(cache_dir)
+        os.mkdir(cache_dir)
+
+    def writeTas(self):
+        setup()
+        cmor.set_cur_dataset_attribute("_table_cache_dir", cache_dir)
+        ivar = define_variable()
+
+        data = random_tas(ntimes)
+        cmor.write(ivar, data, time_vals=[.5, 1.5],
+                   time_bnds=[0, 1., 2.])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        attributes = dict((name, str(value))
+                          for name, value in f.tas.attributes.items())
+        # the global attributes come from the CV, less the per file ones
+        for name, value in f.attributes.items():
+            if name not in ("tracking_id", "creation_date", "history"):
+                attributes[name] = str(value)
+        f.close()
+        self.assertTrue(numpy.allclose(tas, data, atol=1.e-4))
+        return attributes
+
+    def corruptCV(self):
+        # make the first CV node claim more items than the cache holds
+        path = glob.glob(os.path.join(cache_dir, "CMIP6_CV.json.*.cache"))[0]
+        cache = bytearray(open(path, "rb").read())
+        nrecords = struct.unpack_from("i", cache, 24)[0]
+        for i in range(nrecords):
+            offset = 32 + 40 * i
+            if struct.unpack_from("i", cache, offset)[0] == 7:
+                struct.pack_into("i", cache, offset + 20, 0x7fffffff)
+                break
+        open(path, "wb").write(cache)
+        return path
+
+    def testTableCache(self):
+        # the first run compiles the table and its companions
+        first = self.writeTas()
+        caches = sorted(glob.glob(os.path.join(cache_dir, "*.cache")))
+        self.assertEqual(len(caches), 4)
+
+        mtimes = [os.path.getmtime(c) for c in caches]
+
+        # the second run loads them from the cache, without rewriting it
+        time.sleep(1)
+        second = self.writeTas()
+        self.assertEqual(first, second)
+        self.assertEqual(
+            sorted(glob.glob(os.path.join(cache_dir, "*.cache"))), caches)
+        self.assertEqual([os.path.getmtime(c) for c in caches], mtimes)
+
+    def testCorruptCache(self):
+        # a corrupt cache is ignored, the table is read and compiled again
+        first = self.writeTas()
+        path = self.corruptCV()
+        mtime = os.path.getmtime(path)
+        time.sleep(1)
+        second = self.writeTas()
+        self.assertEqual(first, second)
+        self.assertNotEqual(os.path.getmtime(path), mtime)
+
+    def tearDown(self):
+        shutil.rmtree(cache_dir)
+        shutil.rmtree("./CMIP6")
+
+
+if __name__ == '__main__':
+    run()
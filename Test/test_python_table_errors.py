@@ -0,0 +1,67 @@
+import cmor
+import unittest
+import cdms2
+import os
+import shutil
+from test_python_latlon_common import *
+
+table_dir = "Test/table_errors"
+ntimes = 2
+
+
+class TestCase(unittest.TestCase):
+
+    def setUp(self, *args, **kwargs):
+        if os.path.exists(table_dir):
+            shutil.rmtree(table_dir)
+        os.mkdir(table_dir)
+        # the companion tables are looked up next to the table
+        for name in ("CMIP6_CV.json", "CMIP6_coordinate.json",
+                     "CMIP6_formula_terms.json"):
+            shutil.copy(os.path.join("Tables", name), table_dir)
+        self.amon = open("Tables/CMIP6_Amon.json").read()
+
+    def tearDown(self):
+        shutil.rmtree(table_dir)
+
+    def writeTable(self, text):
+        path = os.path.join(table_dir, "CMIP6_Amon.json")
+        open(path, "w").write(text)
+        return path
+
+    def writeTas(self, table):
+        ivar = define_variable(table=table)
+        cmor.write(ivar, random_tas(ntimes), time_vals=[.5, 1.5],
+                   time_bnds=[0, 1., 2.])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        long_name = f.tas.long_name
+        f.close()
+        return long_name
+
+    def testMalformedTable(self):
+        setup()
+        # cut the table in the middle of the variable entries
+        table = self.writeTable(self.amon[:len(self.amon) // 2])
+        self.assertRaises(Exception, cmor.load_table, table)
+        # the failed load leaves nothing behind
+        long_name = self.writeTas("Tables/CMIP6_Amon.json")
+        self.assertEqual(long_name, "Near-Surface Air Temperature")
+
+    def testDuplicateKey(self):
+        setup()
+        # an earlier "tas" entry is overridden by the one that follows
+        entry = self.amon.index('        "tas": {')
+        duplicate = self.amon[entry:self.amon.index('        "tasmax": {')]
+        duplicate = duplicate.replace("Near-Surface Air Temperature",
+                                      "Overridden Air Temperature")
+        table = self.writeTable(self.amon[:entry] + duplicate +
+                                self.amon[entry:])
+        long_name = self.writeTas(table)
+        self.assertEqual(long_name, "Near-Surface Air Temperature")
+
+
+if __name__ == '__main__':
+    run()
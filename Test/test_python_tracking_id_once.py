@@ -0,0 +1,37 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 6
+
+
+class TestCase(LatLonTestCase):
+
+    def setUp(self, *args, **kwargs):
+        LatLonTestCase.setUp(self)
+        cmor.set_cur_dataset_attribute("_tracking_id_once", "1")
+
+    def testTrackingIdOnce(self):
+        ivar = define_variable()
+        data = random_tas(ntimes)
+        for i in range(ntimes):
+            cmor.write(ivar, data[i], time_vals=[i + .5],
+                       time_bnds=[i, i + 1.])
+
+        # the tracking_id is only rewritten once, when the file is closed
+        tracking_id = cmor.get_cur_dataset_attribute("tracking_id")
+        path = cmor.close(ivar, True)
+        self.assertNotEqual(cmor.get_cur_dataset_attribute("tracking_id"),
+                            tracking_id)
+        cmor.close()
+
+        f = cdms2.open(path)
+        self.assertTrue(f.tracking_id.startswith("hdl:21.14100/"))
+        self.assertTrue(numpy.allclose(f("tas"), data, atol=1.e-4))
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
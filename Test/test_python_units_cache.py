@@ -0,0 +1,34 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 4
+
+
+class TestCase(LatLonTestCase):
+
+    def testUnitsCache(self):
+        # table units are degC, user units are K
+        ivar = define_variable("tos", "K", "Tables/CMIP6_Omon.json")
+
+        data = random_tas(ntimes)
+        for i in range(ntimes):
+            cmor.write(ivar, data[i:i + 1], time_vals=[i + .5],
+                       time_bnds=[i, i + 1.])
+
+        # units are only parsed on the first write
+        self.assertEqual(cmor.get_units_cache_hits(ivar), ntimes - 1)
+
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tos = f("tos")
+        self.assertTrue(numpy.allclose(tos, data - 273.15, atol=1.e-4))
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,75 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 8
+
+
+class TestCase(LatLonTestCase):
+
+    def testWriteAsync(self):
+        ivar = define_variable()
+        data = random_tas(ntimes)
+        # the same array is refilled while earlier slices are written
+        buf = numpy.empty((1, nlat, nlon))
+        for i in range(ntimes):
+            buf[:] = data[i]
+            cmor.write(ivar, buf, time_vals=[i + .5], time_bnds=[i, i + 1.],
+                       asynchronous=True)
+            if i == ntimes // 2:
+                cmor.wait(ivar)
+        cmor.flush()
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertTrue(numpy.allclose(tas, data, rtol=1.e-5))
+        f.close()
+
+    def testSyncAfterAsync(self):
+        ivar = define_variable()
+        data = random_tas(ntimes)
+        buf = numpy.empty((1, nlat, nlon), dtype=numpy.float32)
+        for i in range(ntimes):
+            buf[:] = data[i]
+            # later plain writes are synchronous again: buf goes
+            # straight to the file and is overwritten on return
+            cmor.write(ivar, buf, time_vals=[i + .5], time_bnds=[i, i + 1.],
+                       asynchronous=(i < ntimes // 2))
+            buf[:] = 0.
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        self.assertTrue(numpy.allclose(f("tas"), data, rtol=1.e-5))
+        f.close()
+
+    def testDefineWhilePending(self):
+        itas = define_variable()
+        tas = random_tas(ntimes)
+        for i in range(ntimes):
+            cmor.write(itas, tas[i:i + 1], time_vals=[i + .5],
+                       time_bnds=[i, i + 1.], asynchronous=True)
+        # tas slices are still queued while new axes and variables grow
+        # the registries
+        ipr = cmor.variable("pr", axis_ids=axes(), units="kg m-2 s-1")
+        pr = numpy.random.random((ntimes, nlat, nlon)) * 1.e-5
+        cmor.write(ipr, pr, time_vals=numpy.arange(ntimes) + .5,
+                   time_bnds=numpy.arange(ntimes + 1.))
+        tas_path = cmor.close(itas, True)
+        pr_path = cmor.close(ipr, True)
+        cmor.close()
+
+        f = cdms2.open(tas_path)
+        self.assertTrue(numpy.allclose(f("tas"), tas, rtol=1.e-5))
+        f.close()
+        f = cdms2.open(pr_path)
+        self.assertTrue(numpy.allclose(f("pr"), pr, rtol=1.e-5))
+        f.close()
+
+
+if __name__ == '__main__':
+    run()
@@ -0,0 +1,51 @@
+import cmor
+import numpy
+import unittest
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 2
+
+
+class TestCase(LatLonTestCase):
+
+    def testWriteRegion(self):
+        # north to south, CMOR reverts latitude on output
+        ivar = define_variable(north_to_south=True)
+        data = random_tas(ntimes)
+        # each time step is written as 3 x 2 tiles
+        lat_edges = [0, 15, 30, nlat]
+        lon_edges = [0, 40, nlon]
+        for i in range(ntimes):
+            for a, b in zip(lat_edges[:-1], lat_edges[1:]):
+                for c, d in zip(lon_edges[:-1], lon_edges[1:]):
+                    cmor.write(ivar, data[i:i + 1, a:b, c:d],
+                               time_vals=[i + .5], time_bnds=[i, i + 1.],
+                               start=[i, a, c])
+        path = cmor.close(ivar, True)
+        cmor.close()
+
+        f = cdms2.open(path)
+        tas = f("tas")
+        self.assertEqual(tas.shape, (ntimes, nlat, nlon))
+        self.assertTrue(numpy.allclose(tas, data[:, ::-1], rtol=1.e-5))
+        f.close()
+
+    def testBadBlock(self):
+        ivar = define_variable(north_to_south=True)
+        data = random_tas(1)
+        cmor.write(ivar, data, time_vals=[.5], time_bnds=[0, 1.],
+                   start=[0, 0, 0])
+        # one dimension short of the variable
+        self.assertRaises(Exception, cmor.write, ivar, data[0],
+                          time_vals=[.5], time_bnds=[0, 1.], start=[0, 0])
+        # a block running past the end of longitude
+        self.assertRaises(Exception, cmor.write, ivar, data[:, :, :20],
+                          time_vals=[.5], time_bnds=[0, 1.],
+                          start=[0, 0, nlon - 10])
+        cmor.close(ivar)
+        cmor.close()
+
+
+if __name__ == '__main__':
+    run()
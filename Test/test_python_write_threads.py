@@ -0,0 +1,55 @@
+import cmor
+import numpy
+import unittest
+import threading
+import cdms2
+from test_python_latlon_common import *
+
+ntimes = 6
+
+
+class TestCase(LatLonTestCase):
+
+    def setUp(self, *args, **kwargs):
+        LatLonTestCase.setUp(self)
+        cmor.set_cur_dataset_attribute("_write_threads", "2")
+
+    def testWriteThreads(self):
+        cmor.load_table("Tables/CMIP6_Amon.json")
+        axis_ids = axes()
+
+        # everything is defined up front, only writes run concurrently
+        names = ["tas", "ts", "psl"]
+        units = ["K", "K", "hPa"]
+        ivars = [cmor.variable(n, axis_ids=axis_ids, units=u)
+                 for n, u in zip(names, units)]
+        data = [random_tas(ntimes) for n in names]
+        paths = [None] * len(names)
+
+        def write(k):
+            for i in range(ntimes):
+                cmor.write(ivars[k], data[k][i:i + 1], time_vals=[i + .5],
+                           time_bnds=[i, i + 1.])
+            paths[k] = cmor.close(ivars[k], True)
+
+        threads = [threading.Thread(target=write, args=(k,))
+                   for k in range(len(names))]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        cmor.close()
+
+        for k, n in enumerate(names):
+            f = cdms2.open(paths[k])
+            values = f(n)
+            expected = data[k]
+            if n == "psl":
+                expected = expected * 100.
+            self.assertTrue(numpy.allclose(values, expected, rtol=1.e-5))
+            self.assertEqual(len(f.getAxis("time")), ntimes)
+            f.close()
+
+
+if __name__ == '__main__':
+    run()
@@ -1,6 +1,10 @@
 #ifndef CMOR_H
 #define CMOR_H
 
+#include <udunits2.h>
+#include <sys/types.h>
+#include <pthread.h>
+
 #define CMOR_VERSION_MAJOR 3
 #define CMOR_VERSION_MINOR 3
 #define CMOR_VERSION_PATCH 0
@@ -22,6 +26,27 @@
 #define CMOR_MAX_GRID_ATTRIBUTES 25
 #define CMOR_MAX_JSON_ARRAY 50
 #define CMOR_MAX_JSON_OBJECT 250
+#define CMOR_REORDER_TILE 4096
+#define CMOR_INTERN_BLOCK 65536
+#define CMOR_MAX_TRACEBACK 128
+#define CMOR_MAX_WRITE_THREADS 32
+#define CMOR_MAX_QUEUED_WRITES 4
+#define CMOR_MAX_FILTER_PARAMS 8
+
+#define CMOR_CHUNK_MAP 0
+#define CMOR_CHUNK_TIMESERIES 1
+#define CMOR_CHUNK_BALANCED 2
+#define CMOR_DEFAULT_CHUNK_SIZE 4194304
+#define CMOR_DEFAULT_HEADER_PAD 1024
+#define CMOR_MAX_CHUNK_CACHE 1073741824
+
+#ifdef __GNUC__
+#define CMOR_THREAD_LOCAL __thread
+#define CMOR_ATOMIC_INC(x) __sync_fetch_and_add(&(x), 1)
+#else
+#define CMOR_THREAD_LOCAL
+#define CMOR_ATOMIC_INC(x) ((x)++)
+#endif
 
 #define CMOR_QUIET 0
 
@@ -48,6 +73,14 @@
 #define CMOR_APPEND CMOR_APPEND_4
 #define CMOR_REPLACE CMOR_REPLACE_4
 
+/* -------------------------------------------------------------------- */
+/*      How cmor_move_file() took over a file to append to              */
+/* -------------------------------------------------------------------- */
+#define CMOR_MOVE_RENAME     1
+#define CMOR_MOVE_COPY_RANGE 2
+#define CMOR_MOVE_COPY       3
+#define CMOR_COPY_BUFFER     (1 << 20)
+
 #define CMOR_INPUTFILENAME       GLOBAL_INTERNAL"dataset_json"
 #define CV_INPUTFILENAME         GLOBAL_INTERNAL"CV"
 #define CV_CHECK_ERROR           GLOBAL_INTERNAL"CV_ERROR"
@@ -189,6 +222,16 @@
 #define GLOBAL_ATT_MIP_ERA            "mip_era"
 #define GLOBAL_CV_FILENAME            GLOBAL_INTERNAL"control_vocabulary_file"
 #define GLOBAL_IS_CMIP6               GLOBAL_INTERNAL"cmip6_option"
+#define GLOBAL_TRACKING_ID_ONCE       GLOBAL_INTERNAL"tracking_id_once"
+#define CMOR_TABLE_CACHE_DIR          GLOBAL_INTERNAL"table_cache_dir"
+#define CMOR_OUTPUT_CHECKSUM          GLOBAL_INTERNAL"output_checksum"
+#define CMOR_WRITE_THREADS            GLOBAL_INTERNAL"write_threads"
+#define CMOR_NOFILL                   GLOBAL_INTERNAL"nofill"
+#define CMOR_CHUNK_ACCESS             GLOBAL_INTERNAL"chunk_access"
+#define CMOR_CHUNK_SIZE               GLOBAL_INTERNAL"chunk_size"
+#define CMOR_HEADER_PAD               GLOBAL_INTERNAL"header_pad"
+#define CMOR_VAR_ALIGN                GLOBAL_INTERNAL"var_align"
+#define CMOR_CHUNK_CACHE              GLOBAL_INTERNAL"chunk_cache"
 
 #define NO_PARENT                     "no parent"
 #define NONE                          "none"
@@ -282,7 +325,37 @@ extern int cmor_nwarnings;
 
 extern char cmor_input_path[CMOR_MAX_STRING];
 
-extern char cmor_traceback_info[CMOR_MAX_STRING];
+extern CMOR_THREAD_LOCAL const char *cmor_traceback_stack[CMOR_MAX_TRACEBACK];
+extern CMOR_THREAD_LOCAL int cmor_traceback_depth;
+
+/* -------------------------------------------------------------------- */
+/*      A slice handed to a write worker; the worker frees data, or     */
+/*      releases its staging slot, once nc_put_vara has returned.       */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_write_job_ {
+    int ncid;
+    int var_id;
+    char type;
+    size_t starts[CMOR_MAX_DIMENSIONS + 1];
+    size_t counts[CMOR_MAX_DIMENSIONS + 1];
+    void *data;
+    int staging;		/* slot of data in the staging buffers, or -1 */
+    struct cmor_write_job_ *next;
+} cmor_write_job_t;
+
+typedef struct cmor_write_worker_ {
+    pthread_t thread;
+    pthread_cond_t queued;
+    cmor_write_job_t *first;
+    cmor_write_job_t *last;
+    int njobs;
+    int stop;
+} cmor_write_worker_t;
+
+extern pthread_mutex_t cmor_write_mutex;
+extern pthread_cond_t cmor_write_done;
+extern int cmor_nwrite_threads;
+extern CMOR_THREAD_LOCAL int cmor_lock_depth;
 
 typedef struct cmor_grid_ {
     int id;
@@ -307,16 +380,20 @@ typedef struct cmor_grid_ {
 
 extern cmor_grid_t cmor_grids[CMOR_MAX_GRIDS];
 
+/* -------------------------------------------------------------------- */
+/*      Table entries: strings point into the interned string arena     */
+/*      (see cmor_intern()), "" when unset; never write through them.  */
+/* -------------------------------------------------------------------- */
 typedef struct cmor_axis_def_ {
     int table_id;
     int climatology;
-    char id[CMOR_MAX_STRING];
-    char standard_name[CMOR_MAX_STRING];
-    char units[CMOR_MAX_STRING];
+    char *id;
+    char *standard_name;
+    char *units;
     char axis;
     char positive;
-    char long_name[CMOR_MAX_STRING];
-    char out_name[CMOR_MAX_STRING];
+    char *long_name;
+    char *out_name;
     char type;
     char stored_direction;
     double valid_min;
@@ -324,18 +401,18 @@ typedef struct cmor_axis_def_ {
     int n_requested;
     double *requested;
     char *crequested;
-    char cname[CMOR_MAX_STRING];
+    char *cname;
     int n_requested_bounds;
     double *requested_bounds;
     double tolerance;
     double value;
-    char cvalue[CMOR_MAX_STRING];
+    char *cvalue;
     double bounds_value[2];
-    char required[CMOR_MAX_STRING];
-    char formula[CMOR_MAX_STRING];
-    char convert_to[CMOR_MAX_STRING];
-    char z_factors[CMOR_MAX_STRING];
-    char z_bounds_factors[CMOR_MAX_STRING];
+    char *required;
+    char *formula;
+    char *convert_to;
+    char *z_factors;
+    char *z_bounds_factors;
     char index_only;
     int must_have_bounds;
     int must_call_cmor_grid;
@@ -362,8 +439,29 @@ typedef struct cmor_CV_def_ {
     int     anElements;
     int     nbObjects;
     struct cmor_CV_def_ *oValue;
+    int     order;          /* position in the tree walk, -1 if unindexed */
+    int     order_last;     /* order of the last node of this subtree */
+    struct cmor_CV_index_ *index;   /* of the tree, shared with its tables */
 } cmor_CV_def_t;
 
+/* -------------------------------------------------------------------- */
+/*      Key index over a table's CV tree.  Nodes are grouped by key     */
+/*      and kept in tree order within a key, so the first match below   */
+/*      a node is found by hashing the key and bisecting the orders.    */
+/*      The nodes point to it, so a CV shared by several tables is      */
+/*      searched the same way whichever table loaded it first.          */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_CV_index_ {
+    cmor_CV_def_t *root;        /* CV[0] of the tree */
+    int nnodes;
+    cmor_CV_def_t **nodes;      /* sorted by key, then order */
+    int *runs;                  /* number of nodes sharing nodes[i]'s key */
+    int nslots;                 /* power of 2 */
+    int *slots;                 /* first node of a key + 1, 0 when empty */
+    int nroot_slots;
+    int *root_slots;            /* top level CV entry + 1 */
+} cmor_CV_index_t;
+
 typedef struct cmor_axis_ {
     int ref_table_id;
     int ref_axis_id;
@@ -379,29 +477,30 @@ typedef struct cmor_axis_ {
     int revert;
     int offset;
     char type;
-    char attributes_values_char[CMOR_MAX_ATTRIBUTES][CMOR_MAX_STRING];
+    char *attributes_values_char[CMOR_MAX_ATTRIBUTES];	/* interned */
     double attributes_values_num[CMOR_MAX_ATTRIBUTES];
     char attributes_type[CMOR_MAX_ATTRIBUTES];	/*stores attributes type */
-    char attributes[CMOR_MAX_ATTRIBUTES][CMOR_MAX_STRING];	/*stores attributes names */
+    char *attributes[CMOR_MAX_ATTRIBUTES];	/*stores attributes names, interned */
     int nattributes;		/* number of character type attributes */
     int hybrid_in;
     int hybrid_out;
     int store_in_netcdf;
 } cmor_axis_t;
-extern cmor_axis_t cmor_axes[CMOR_MAX_AXES];
+extern cmor_axis_t *cmor_axes;
+extern int cmor_axes_allocated;
 
 typedef struct cmor_variable_def_ {
     int table_id;
-    char id[CMOR_MAX_STRING];
-    char standard_name[CMOR_MAX_STRING];
-    char units[CMOR_MAX_STRING];
-    char cell_methods[CMOR_MAX_STRING];
-    char cell_measures[CMOR_MAX_STRING];
+    char *id;
+    char *standard_name;
+    char *units;
+    char *cell_methods;
+    char *cell_measures;
     char positive;
-    char flag_values[CMOR_MAX_STRING];
-    char flag_meanings[CMOR_MAX_STRING];
-    char long_name[CMOR_MAX_STRING];
-    char comment[CMOR_MAX_STRING];
+    char *flag_values;
+    char *flag_meanings;
+    char *long_name;
+    char *comment;
     int ndims;
     int dimensions[CMOR_MAX_DIMENSIONS];
     char type;
@@ -409,14 +508,14 @@ typedef struct cmor_variable_def_ {
     float valid_max;
     float ok_min_mean_abs;
     float ok_max_mean_abs;
-    char chunking_dimensions[CMOR_MAX_STRING];
+    char *chunking_dimensions;
     int shuffle;
     int deflate;
     int deflate_level;
-    char required[CMOR_MAX_STRING];
-    char realm[CMOR_MAX_STRING];
-    char frequency[CMOR_MAX_STRING];
-    char out_name[CMOR_MAX_STRING];
+    char *required;
+    char *realm;
+    char *frequency;
+    char *out_name;
 } cmor_var_def_t;
 
 typedef struct cmor_var_ {
@@ -429,8 +528,8 @@ typedef struct cmor_var_ {
     int initialized;
     int error;
     int closed;
+    int tracking_id_pending;	/* file written to since tracking_id was set */
     int nc_var_id;
-    int nc_zfactors[CMOR_MAX_VARIABLES];
     int nzfactor;
     int ntimes_written;
     double last_time_written;
@@ -445,10 +544,10 @@ typedef struct cmor_var_ {
     int singleton_ids[CMOR_MAX_DIMENSIONS];
     int axes_ids[CMOR_MAX_DIMENSIONS];
     int original_order[CMOR_MAX_DIMENSIONS];
-    char attributes_values_char[CMOR_MAX_ATTRIBUTES][CMOR_MAX_STRING];
+    char *attributes_values_char[CMOR_MAX_ATTRIBUTES];	/* interned */
     double attributes_values_num[CMOR_MAX_ATTRIBUTES];
     char attributes_type[CMOR_MAX_ATTRIBUTES];	/*stores attributes type */
-    char attributes[CMOR_MAX_ATTRIBUTES][CMOR_MAX_STRING];	/*stores attributes names */
+    char *attributes[CMOR_MAX_ATTRIBUTES];	/*stores attributes names, interned */
     int nattributes;		/* number of  attributes */
     char type;
     char itype;
@@ -463,6 +562,11 @@ typedef struct cmor_var_ {
     int shuffle;
     int deflate;
     int deflate_level;
+    int fletcher32;
+    unsigned int filter_id;	/* HDF5 filter plugin, 0 for none */
+    int filter_nparams;
+    unsigned int filter_params[CMOR_MAX_FILTER_PARAMS];
+    int significant_digits;	/* bit grooming, 0 for lossless */
     int nomissing;
     char iunits[CMOR_MAX_STRING];
     char ounits[CMOR_MAX_STRING];
@@ -479,11 +583,74 @@ typedef struct cmor_var_ {
     char suffix[CMOR_MAX_STRING];
     int suffix_has_date;
     char frequency[CMOR_MAX_STRING];
+    int units_affine;		/* -1 not checked yet, 0 no, 1 yes */
+    double units_scale;
+    double units_offset;
+    ut_unit *cmor_units;	/* cached across writes */
+    ut_unit *user_units;
+    cv_converter *units_converter;
+    int units_cache_hits;
+    size_t chunk_cache;		/* bytes, set by cmor_size_chunk_cache() */
+    void *staging[2];		/* converted slices, reused across writes */
+    size_t staging_size[2];
+    int staging_busy[2];	/* queued for a write worker */
+    int write_error;		/* a write worker failed, until reported */
+    int next_staging;
+    double *time_staging;	/* converted times and bounds */
+    size_t time_staging_size;
+    int nofill;			/* file is in NC_NOFILL mode */
+    char *written;		/* time steps written whole ... */
+    int written_first;		/* ... from this time step on */
+    int written_size;
+    int *written_blocks;	/* start, count of each region write */
+    int nwritten_blocks;
+    int region;			/* set while cmor_write_region writes */
+    int async;			/* set while cmor_write_async writes */
+    int region_start[CMOR_MAX_DIMENSIONS];	/* in output order */
+    int region_count[CMOR_MAX_DIMENSIONS];
 } cmor_var_t;
 
-extern cmor_var_t cmor_vars[CMOR_MAX_VARIABLES];
+extern cmor_var_t *cmor_vars;
+extern int cmor_vars_allocated;
 extern cmor_var_t cmor_formula[CMOR_MAX_FORMULA];
 
+/* -------------------------------------------------------------------- */
+/*      Walks user data in output order, one contiguous run of at       */
+/*      most CMOR_REORDER_TILE elements at a time.                      */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_reorder_ {
+    int ndims;                          /* axes left after coalescing */
+    int length[CMOR_MAX_DIMENSIONS];    /* output extent of each axis */
+    long stride[CMOR_MAX_DIMENSIONS];   /* stride in the user array */
+    int revert[CMOR_MAX_DIMENSIONS];    /* 1 or -1 */
+    int first[CMOR_MAX_DIMENSIONS];     /* source index of output index 0 */
+    int index[CMOR_MAX_DIMENSIONS];     /* current output index (outer axes) */
+    int source[CMOR_MAX_DIMENSIONS];    /* current source index (outer axes) */
+    int segment;                        /* 0 before longitude wrap, 1 after */
+    int position;                       /* position inside current segment */
+    long nelements;
+    long done;
+} cmor_reorder_t;
+
+typedef struct cmor_block_stats_ {
+    double sum_abs;                     /* sum of |x| over valid values */
+    int nelts;                          /* number of valid values */
+    int n_lower_min;
+    int n_greater_max;
+    double vmin;
+    double vmax;
+} cmor_block_stats_t;
+
+/* -------------------------------------------------------------------- */
+/*      Hash index over the ids of one kind of table entry, built by    */
+/*      cmor_index_table(). Entries added since are scanned linearly.   */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_table_index_ {
+    int nslots;                         /* power of 2 */
+    int nindexed;                       /* entries 0..nindexed-1 hashed */
+    int *slots;                         /* entry + 1, 0 when empty */
+} cmor_table_index_t;
+
 typedef struct cmor_mappings_ {
     int nattributes;
     char id[CMOR_MAX_STRING];
@@ -496,6 +663,16 @@ typedef struct {
     char *value;
 } t_symstruct;
 
+/* -------------------------------------------------------------------- */
+/*      One block of the interned string arena, strings follow the      */
+/*      header.                                                         */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_intern_block_ {
+    struct cmor_intern_block_ *next;
+    size_t used;
+    size_t size;
+} cmor_intern_block_t;
+
 
 typedef struct cmor_table_ {
     int id;
@@ -510,14 +687,25 @@ typedef struct cmor_table_ {
     char Conventions[CMOR_MAX_STRING];
     char data_specs_version[CMOR_MAX_STRING];
     char szTable_id[CMOR_MAX_STRING];
-    char expt_ids[CMOR_MAX_ELEMENTS][CMOR_MAX_STRING];
-    char sht_expt_ids[CMOR_MAX_ELEMENTS][CMOR_MAX_STRING];
+    char **expt_ids;            /* interned, nexps + 1 of them */
+    char **sht_expt_ids;
     char date[CMOR_MAX_STRING];
-    cmor_axis_def_t axes[CMOR_MAX_ELEMENTS];
-    cmor_var_def_t vars[CMOR_MAX_ELEMENTS];
-    cmor_var_def_t formula[CMOR_MAX_FORMULA];
-    cmor_mappings_t mappings[CMOR_MAX_ELEMENTS];
+    cmor_axis_def_t *axes;      /* grown by cmor_grow_registry() */
+    cmor_var_def_t *vars;
+    cmor_var_def_t *formula;
+    cmor_mappings_t *mappings;
+    int axes_allocated;
+    int vars_allocated;
+    int formula_allocated;
+    int mappings_allocated;
+    int expts_allocated;
+    cmor_table_index_t axes_index;
+    cmor_table_index_t vars_index;
+    cmor_table_index_t out_names_index;
+    cmor_table_index_t formula_index;
     cmor_CV_def_t *CV;
+    cmor_CV_index_t *CV_index;
+    int CV_shared;              /* CV and CV_index owned by a companion */
     double missing_value;
     long    int_missing_value;
     double interval;
@@ -530,10 +718,83 @@ typedef struct cmor_table_ {
     char **forcings;
     int nforcings;
     unsigned char md5[16];
-    char generic_levels[CMOR_MAX_ELEMENTS][CMOR_MAX_STRING];
+    char **generic_levels;      /* interned */
+    int ngeneric_levels;
+    int generic_levels_allocated;
 } cmor_table_t;
 
-extern cmor_table_t cmor_tables[CMOR_MAX_TABLES];
+extern cmor_table_t *cmor_tables;
+extern int cmor_tables_allocated;
+
+/* -------------------------------------------------------------------- */
+/*      Companion table (coordinate, formula terms or CV file) parsed   */
+/*      once and handed to every table that loads the same version of   */
+/*      the file, see cmor_load_companion_table().                      */
+/* -------------------------------------------------------------------- */
+typedef struct cmor_companion_ {
+    char path[CMOR_MAX_STRING];
+    time_t mtime;
+    off_t size;
+    unsigned char md5[16];
+    int naxes;
+    cmor_axis_def_t *axes;
+    int nformula;
+    cmor_var_def_t *formula;
+    int table_naxes;            /* formula dimensions index these axes */
+    cmor_CV_def_t *CV;
+    cmor_CV_index_t *CV_index;
+} cmor_companion_t;
+
+/* -------------------------------------------------------------------- */
+/*      Compiled table cache, written to the _table_cache_dir by        */
+/*      cmor_write_table_cache() and memory mapped by                   */
+/*      cmor_load_table_cache(): a header, the records replaying the    */
+/*      JSON sections through the same setters, then the strings the    */
+/*      records point to.                                               */
+/* -------------------------------------------------------------------- */
+#define CMOR_TABLE_CACHE_MAGIC "CMORTC01"
+#define CMOR_TABLE_CACHE_SUFFIX ".cache"
+
+enum cmor_table_cache_kind {
+    CACHE_HEADER_ATT,           /* name, value */
+    CACHE_EXPERIMENT,           /* short name, long name */
+    CACHE_AXIS_ENTRY,           /* entry name, CACHE_ENTRY_ATT follow */
+    CACHE_VARIABLE_ENTRY,
+    CACHE_FORMULA_ENTRY,
+    CACHE_ENTRY_ATT,            /* attribute name, value */
+    CACHE_CV_ROOT,              /* nobjects - 1 top level node trees follow */
+    CACHE_CV_NODE,              /* key, szValue, nitems CV_ITEM follow, */
+                                /* then nobjects node trees for an object */
+    CACHE_CV_ITEM               /* one string of a CV_stringarray */
+};
+
+typedef struct cmor_table_cache_header_ {
+    char magic[8];
+    unsigned char md5[16];      /* of the JSON table */
+    int nrecords;
+    int strings_size;
+} cmor_table_cache_header_t;
+
+typedef struct cmor_table_cache_record_ {
+    int kind;
+    int name;                   /* offsets in the strings, -1 for "" */
+    int value;
+    int type;
+    int nobjects;
+    int nitems;
+    int nValue;
+    double dValue;
+} cmor_table_cache_record_t;
+
+typedef struct cmor_table_cache_builder_ {
+    cmor_table_cache_record_t *records;
+    int nrecords;
+    int records_allocated;
+    char *strings;
+    int strings_size;
+    int strings_allocated;
+    int error;
+} cmor_table_cache_builder_t;
 
 //extern const char cmor_tracking_prefix_project_filter[CMOR_MAX_TRACKING_PREFIX_PROJECT_FILTER][CMOR_MAX_STRING];
 
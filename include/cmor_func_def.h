@@ -11,10 +11,13 @@
 #include "json.h"
 
 extern void cmor_md5( FILE * inputfile, unsigned char checksum[16] );
+extern int cmor_md5_file( char *filename, unsigned char checksum[16] );
+extern int cmor_write_checksum( int var_id, char *filename );
 
 extern void cmor_is_setup( void );
-extern void cmor_add_traceback( char *name );
+extern void cmor_add_traceback( const char *name );
 extern void cmor_pop_traceback( void );
+extern void cmor_get_traceback( char *traceback, int size );
 extern int cmor_prep_units( char *uunits, char *cunits,
 			    ut_unit ** user_units, ut_unit ** cmor_units,
 			    cv_converter ** ut_cmor_converter );
@@ -26,6 +29,14 @@ extern void cmor_handle_error( char error_msg[CMOR_MAX_STRING],
 			       int level );
 extern void cmor_handle_error_var( char error_msg[CMOR_MAX_STRING], int level,
                                    int var_id );
+extern void cmor_reset_variable( int var_id );
+extern void cmor_reset_axis( int axis_id );
+extern void *cmor_grow_registry( void *registry, int *allocated, int n,
+                                 size_t size, int increment );
+extern int cmor_reserve_variable( int var_id );
+extern int cmor_reserve_axis( int axis_id );
+extern int cmor_reserve_table( int table_id );
+extern int cmor_get_free_variable( void );
 extern int cmor_setup( char *path, int *netcdf, int *verbosity, int *mode,
 		       char *logfile, int *cmor_create_subdirectories);
 
@@ -90,18 +101,48 @@ extern int cmor_define_zfactors_vars( int var_id, int ncid, int *nc_dim,
 extern int cmor_create_output_path( int var_id, char *outpath );
 extern double cmor_convert_interval_to_seconds( double val, char *units );
 extern int cmor_validateFilename(char *outname, char *suffix, int var_id);
-
+extern void cmor_set_nofill( int var_id, int ncid, int append );
+extern int cmor_enddef( int ncid );
+
+extern void cmor_lock( void );
+extern void cmor_unlock( void );
+extern void *cmor_write_worker( void *arg );
+extern int cmor_start_write_threads( int nmin );
+extern void cmor_stop_write_threads( void );
+extern cmor_write_worker_t *cmor_write_worker_of( int ncid );
+extern int cmor_queue_write( int ncid, cmor_var_t * avar, char mtype,
+                             size_t * starts, size_t * counts, void *data,
+                             int staging );
+extern void cmor_wait_writes( int ncid );
+extern int cmor_write_async( int var_id, void *data, char type,
+                             char *file_suffix, int ntimes_passed,
+                             double *time_vals, double *time_bounds,
+                             int *refvar );
+extern int cmor_write_region( int var_id, void *data, char type,
+                              char *file_suffix, int *start, int *count,
+                              double *time_vals, double *time_bounds );
+extern int cmor_wait( int var_id );
+extern int cmor_flush( void );
 extern int cmor_write( int var_id, void *data, char type, char *file_suffix,
 		       int ntimes_passed, double *time_vals,
 		       double *time_bounds, int *refvar );
+extern int cmor_write_internal( int var_id, void *data, char type,
+                                char *file_suffix, int ntimes_passed,
+                                double *time_vals, double *time_bounds,
+                                int *refvar );
+extern int cmor_valid_var_id( int var_id );
 extern int cmor_close_variable( int var_id, char *file_name,
 				int *preserve );
+extern int cmor_close_variable_internal( int var_id, char *file_name,
+                                         int *preserve );
 extern int cmor_close( void );
 
 extern int cmor_writeGblAttr(int var_id, int ncid, int ncafid);
 extern int cmor_setGblAttr( int );
 
 extern void cmor_generate_uuid( void );
+extern int cmor_tracking_id_once( void );
+extern int cmor_put_tracking_id( int var_id, int ncid );
 extern void cmor_define_dimensions(int var_id, int ncid,
                             int ncafid, double *time_bounds,
                             int *nc_dim,
@@ -116,7 +157,11 @@ extern void cmor_create_var_attributes(int var_id, int ncid, int ncafid,
                                        int *nc_vars_af, int *nc_associated_vars,
                                        int *nc_singletons, int *nc_singletons_bnds,
                                        int *nc_zfactors, int *zfactors, int nzfactors,
-                                       size_t *nc_dim_chunking, char *outname);
+                                       size_t *nc_dim_chunking, char *outname,
+                                       int ntimes_passed);
+extern int cmor_set_chunk_cache( size_t size );
+extern void cmor_size_chunk_cache( int var_id, int ncid, size_t * chunk,
+                                   int ntimes_passed );
 
 extern int cmor_grids_def(int var_id, int nGridID, int ncafid, int *nc_dim_af,
         int *nc_associated_vars);
@@ -128,6 +173,8 @@ extern void create_singleton_dimensions(int var_id, int ncid,
 
 
 extern int copyfile(const char *source, const char *dest);
+extern int copyfile_range(const char *to, const char *from);
+extern int cmor_move_file(const char *to, const char *from);
 
 /* ==================================================================== */
 /*      Control Vocabulary                                              */
@@ -158,12 +205,35 @@ extern void cmor_CV_print(cmor_CV_def_t *CV);
 extern void cmor_CV_printall( void );
 extern cmor_CV_def_t *cmor_CV_search_child_key(cmor_CV_def_t *CV, char *key);
 extern cmor_CV_def_t * cmor_CV_rootsearch(cmor_CV_def_t *CV, char *key);
+extern int cmor_CV_count_nodes(cmor_CV_def_t *CV);
+extern int cmor_CV_number_nodes(cmor_CV_def_t *CV, cmor_CV_def_t **nodes,
+                                int order);
+extern int cmor_CV_compare_nodes(const void *a, const void *b);
+extern void cmor_CV_build_index(cmor_table_t *table);
+extern void cmor_CV_free_index(cmor_CV_index_t **index);
+extern cmor_CV_def_t *cmor_CV_search_index(cmor_CV_index_t *index,
+                                           char *key, int first, int last);
 
 extern int cmor_CV_checkFurtherInfoURL(int var_id);
 extern int cmor_CV_checkGrids(cmor_CV_def_t *CV);
 extern int cmor_CV_setInstitution( cmor_CV_def_t *CV);
 
 extern int cmor_CV_set_entry(cmor_table_t* table, json_object *value);
+extern int cmor_CV_stream_att(cmor_CV_def_t *CV, char *szKey,
+                              json_tokener *tok, char *szValue, char *szEnd);
+extern int cmor_CV_stream_entry(cmor_table_t *table, json_tokener *tok,
+                                char *szValue);
+extern void cmor_CV_write_cache(cmor_table_cache_builder_t *cache,
+                                cmor_CV_def_t *CV);
+extern void cmor_CV_write_cache_root(cmor_table_cache_builder_t *cache,
+                                     cmor_CV_def_t *CV);
+extern int cmor_CV_check_cache(cmor_table_cache_record_t *records,
+                               int nrecords, int i);
+extern int cmor_CV_read_cache(cmor_CV_def_t *CV,
+                              cmor_table_cache_record_t *records,
+                              int nrecords, int i, char *strings);
+extern int cmor_CV_read_cache_root(cmor_table_cache_record_t *records,
+                                   int nrecords, int i, char *strings);
 extern int  cmor_CV_ValidateGblAttributes( char *name);
 extern int cmor_CV_ValidateAttribute(cmor_CV_def_t *CV, char *szValue);
 
@@ -240,6 +310,21 @@ extern int cmor_variable( int *var_id, char *name, char *units, int ndims,
 			  char *comment );
 extern int cmor_set_deflate( int var_id, int shuffle,
                              int deflate, int deflate_level );
+extern int cmor_set_compression( int var_id, int fletcher32,
+                                 unsigned int filter_id, int nparams,
+                                 unsigned int *params,
+                                 int significant_digits );
+extern void cmor_groom_floats( float *values, char *mask, int n, long first,
+                               int nsd );
+extern void cmor_groom_doubles( double *values, char *mask, int n,
+                                long first, int nsd );
+extern void cmor_chunk_shape( int ndims, size_t * length, char *axis,
+                              size_t elsize, size_t target, int access,
+                              size_t * chunk );
+extern int cmor_chunk_access_id( char *name );
+extern size_t cmor_chunk_cache_size( int ndims, size_t * length, char *axis,
+                                     size_t * chunk, size_t elsize,
+                                     int ntimes, size_t * nchunks );
 extern int cmor_set_chunking( int var_id, int nTableID,
 							    size_t nc_dim_chunking[]);
 
@@ -249,6 +334,38 @@ extern int cmor_set_var_def_att( cmor_var_def_t * var,
 extern int cmor_get_variable_time_length( int *var_id, int *length );
 extern int cmor_get_original_shape( int *var_id, int *shape_array,
 				    int *rank, int blank_time );
+extern void cmor_reorder_init( cmor_reorder_t * reorder, int ndims,
+                               int *length, long *stride, int *revert,
+                               int *offset );
+extern int cmor_reorder_contiguous( cmor_reorder_t * reorder );
+extern int cmor_passthrough_type( char itype, char otype );
+extern int cmor_passthrough_fits( void *data, char itype, char otype,
+                                  int n );
+extern int cmor_reorder_next( cmor_reorder_t * reorder, void *data,
+                              char itype, double *tile );
+extern void cmor_block_missing( double *tile, int n, double missing,
+                                double tolerance, char *mask );
+extern void cmor_block_stats( double *tile, int n, char *mask, double scale,
+                              double offset, double omissing,
+                              double valid_min, double valid_max,
+                              cmor_block_stats_t * stats );
+extern int cmor_affine_units( cv_converter * converter, double *scale,
+                              double *offset );
+extern void cmor_append_location( char *msg, cmor_var_t * avar, int *counter,
+                                  int i, double *time_vals );
+extern void cmor_free_units_cache( cmor_var_t * avar );
+extern int cmor_get_units_cache_hits( int *var_id, int *hits );
+extern int cmor_get_chunk_cache( int *var_id, size_t * size );
+extern void *cmor_staging_buffer( int var_id, size_t size, int *slot );
+extern double *cmor_time_buffer( cmor_var_t * avar, size_t n );
+extern int cmor_preallocate( int var_id, int ntimes );
+extern void cmor_free_staging( cmor_var_t * avar );
+extern void cmor_track_written( cmor_var_t * avar, size_t * starts,
+                                size_t * counts );
+extern int cmor_check_written( int var_id );
+extern void cmor_free_written( cmor_var_t * avar );
+extern int cmor_put_var_data( int ncid, cmor_var_t * avar, char mtype,
+                              size_t * starts, size_t * counts, void *data );
 extern int cmor_write_var_to_file( int ncid, cmor_var_t * avar, void *data,
 				   char itype, int ntimes_passed,
 				   double *time_vals,
@@ -285,6 +402,24 @@ extern int cmor_grid( int *grid_id, int ndims, int *axes_ids, char type,
 		      void *lat, void *lon, int nvertices, void *blat,
 		      void *blon );
 extern void cmor_init_table( cmor_table_t * table, int id );
+extern void cmor_free_table_entries( cmor_table_t * table );
+extern int cmor_reserve_experiment( cmor_table_t * table, int n );
+extern cmor_var_def_t *cmor_get_var_def( int table_id, int ref_var_id );
+extern cmor_axis_def_t *cmor_get_axis_def( int table_id, int axis_id );
+extern void cmor_build_index( cmor_table_index_t * index, char *entries,
+                              int n, size_t size, size_t offset );
+extern int cmor_search_index( cmor_table_index_t * index, char *entries,
+                              int n, size_t size, size_t offset,
+                              const char *key );
+extern void cmor_free_index( cmor_table_index_t * index );
+extern void cmor_index_table( cmor_table_t * table );
+extern int cmor_get_table_var_id( int table_id, const char *name );
+extern int cmor_get_table_out_name_id( int table_id, const char *name );
+extern int cmor_get_table_axis_id( int table_id, const char *name );
+extern int cmor_get_table_formula_id( int table_id, const char *name );
+extern unsigned int cmor_hash_string( const char *s );
+extern char *cmor_intern( const char *s );
+extern void cmor_free_interned_strings( void );
 extern int cmor_set_dataset_att( cmor_table_t * table,
 				 char att[CMOR_MAX_STRING],
 				 char val[CMOR_MAX_STRING] );
@@ -303,11 +438,58 @@ extern int cmor_set_variable_entry(cmor_table_t* table,
 extern int cmor_set_formula_entry(cmor_table_t* table,
                             char *variable_entry,
                             json_object *json);
+extern cmor_axis_def_t *cmor_add_axis_entry( cmor_table_t * table,
+                                             char *axis_entry );
+extern cmor_var_def_t *cmor_add_variable_entry( cmor_table_t * table,
+                                                char *variable_entry );
+extern cmor_var_def_t *cmor_add_formula_entry( cmor_table_t * table,
+                                               char *formula_entry );
 
 extern int cmor_set_table( int table );
 extern int cmor_load_table( char table[CMOR_MAX_STRING], int *table_id );
 extern int cmor_load_table_internal( char table[CMOR_MAX_STRING],
                                      int *table_id );
+extern int cmor_find_table_file( char *szTable, char *szPath,
+                                 time_t * mtime, off_t * size );
+extern void cmor_copy_axis_def( cmor_axis_def_t * dst,
+                                cmor_axis_def_t * src, int table_id );
+extern int cmor_attach_companion( cmor_table_t * table,
+                                  cmor_companion_t * companion );
+extern int cmor_load_companion_table( char szTable[CMOR_MAX_STRING],
+                                      int *table_id );
+extern void cmor_free_companions( void );
+extern cmor_table_cache_record_t *cmor_table_cache_add(
+                                  cmor_table_cache_builder_t * cache,
+                                  int kind, const char *name,
+                                  const char *value );
+extern char *cmor_table_cache_string( char *strings, int offset );
+extern int cmor_get_table_cache_path( char *szTable, char *szCache );
+extern int cmor_write_table_cache( char *szCache, unsigned char md5[16],
+                                   cmor_table_cache_builder_t * cache );
+extern int cmor_set_table_record( cmor_table_t * table, int kind,
+                                  char *name, char *value,
+                                  cmor_axis_def_t ** axis,
+                                  cmor_var_def_t ** var );
+extern void cmor_merge_duplicates( char *entries, char **twin, int n,
+                                   size_t size, size_t offset );
+extern void cmor_merge_table_duplicates( cmor_table_t * table,
+                                         cmor_table_t * saved );
+extern void cmor_rollback_table( cmor_table_t * table,
+                                 cmor_table_t * saved );
+extern int cmor_load_table_cache( char *szCache, unsigned char md5[16] );
+extern char *cmor_json_skip_space( char *p );
+extern char *cmor_json_skip_string( char *p );
+extern char *cmor_json_skip_value( char *p );
+extern int cmor_json_next_member( char **cursor, int *n,
+                                  char key[CMOR_MAX_STRING], char **value );
+extern json_object *cmor_json_parse_value( json_tokener * tok, char *start,
+                                           char *end, int *ierr );
+extern int cmor_stream_table_section( cmor_table_t * table,
+                                      json_tokener * tok, char *section,
+                                      int kind,
+                                      cmor_table_cache_builder_t * cache );
+extern int cmor_set_mapping_entry( cmor_table_t * table,
+                                   json_object * value );
 extern int cmor_search_table( char szTable[CMOR_MAX_STRING],
 								int *table_id);
 